@@ -38,6 +38,32 @@ using bool32 = i32;
 using std::vector;
 #include <string>
 using std::string;
+#include <new>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "jobs.h"
+#include "cpu_profiler.h"
+#include "occlusion.h"
+#include "instance_sort.h"
+#include "impostor.h"
+#include "orbit.h"
+#include "gpu_profiler.h"
+#include "gl_state.h"
+#include "ring_buffer.h"
+#include "frame_uniforms.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
+#include "gpu_barriers.h"
+#include "render_queue.h"
+#include "frame_stats.h"
+#include "benchmark.h"
+#include "micro_bench.h"
+#include "gl_intercept.h"
+#include "memory_tracker.h"
+#include "alloc_tracker.h"
+#include "headless_context.h"
 
 struct TemporalVertex
 {
@@ -68,10 +94,36 @@ struct PositionNormalTexcoordTangentBitangent
 
 using Vertex = PositionNormalTexcoordTangentBitangent;
 
+// What a model texture is for, interned when the model is imported. The shaders name the samplers
+// "texture_" + role + a 1-based number: "texture_diffuse1", "texture_specular2", ...
+enum TextureRole
+{
+	TEXTURE_DIFFUSE,
+	TEXTURE_SPECULAR,
+	TEXTURE_NORMAL,
+	TEXTURE_HEIGHT,
+	TEXTURE_ROLE_COUNT,
+};
+
+static const char* const g_TextureRoleNames[TEXTURE_ROLE_COUNT] =
+{
+	"diffuse",
+	"specular",
+	"normal",
+	"height",
+};
+
+// Each role gets this many samplers, interleaved: texture n of a role goes to unit
+// n * TEXTURE_ROLE_COUNT + role, whichever mesh it belongs to, so the first diffuse map is always
+// on unit 0 and the first specular map on unit 1
+#define TEXTURE_ROLE_SLOTS 4
+#define TEXTURE_UNIT_COUNT (TEXTURE_ROLE_COUNT * TEXTURE_ROLE_SLOTS)
+static_assert(TEXTURE_UNIT_COUNT <= GL_STATE_TEXTURE_UNITS, "Texture units not tracked by the GL state cache");
+
 struct Texture
 {
 	u32 id;
-	string type;
+	TextureRole role;
 	string path;
 };
 
@@ -189,6 +241,211 @@ float lastFrame = 0.0f;
 bool32 blinnModel = false;
 bool32 blinnKeyPressed = false;
 
+bool32 occlusionCulling = true;
+bool32 occlusionKeyPressed = false;
+
+bool32 frontToBackSorting = false;
+bool32 sortingKeyPressed = false;
+
+bool32 impostorsEnabled = true;
+bool32 impostorKeyPressed = false;
+
+bool32 orbitalAnimation = false;
+bool32 orbitKeyPressed = false;
+
+bool32 memoryReportKeyPressed = false;
+
+JobSystem g_Jobs;
+OcclusionBuffer g_OcclusionBuffer;
+RingBuffer g_FrameRing;
+BarrierTracker g_Barriers;
+GpuProfiler g_GpuProfiler;
+CpuProfiler g_CpuProfiler;
+FrameStats g_FrameStats;
+GLIntercept g_GLIntercept;
+MemoryTracker g_MemoryTracker;
+AllocTracker g_AllocTracker;
+FrameArena g_FrameArena;
+GLStateCache g_GLState;
+ProgramCache g_ProgramCache;
+
+// Seconds since main() started the CPU profiler, on the steady clock. Stands in for getElapsedSeconds(),
+// GLFW isn't initialized at all in --headless runs.
+static inline double getElapsedSeconds()
+{
+	return double(getCpuProfilerNs() - g_CpuProfiler.originNs) / 1e9;
+}
+
+#if ALLOC_TRACKER
+// Every operator new of the program, the standard library's included, is counted on its way to
+// malloc: the throwing, nothrow and aligned forms all go through here
+static inline void* allocateTracked(size_t size)
+{
+	recordAllocation(g_AllocTracker, size);
+	return malloc(size ? size : 1);
+}
+
+// Out of line, or GCC inlines the operators into every delete expression and then warns that
+// memory from operator new goes to free()
+#if defined(_MSC_VER)
+#define ALLOC_TRACKER_NOINLINE __declspec(noinline)
+#else
+#define ALLOC_TRACKER_NOINLINE __attribute__((noinline))
+#endif
+
+ALLOC_TRACKER_NOINLINE static void deallocateTracked(void* memory)
+{
+	free(memory);
+}
+
+void* operator new(size_t size)
+{
+	void* memory = allocateTracked(size);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateTracked(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateTracked(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	deallocateTracked(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	deallocateTracked(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	deallocateTracked(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	deallocateTracked(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	deallocateTracked(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	deallocateTracked(memory);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types. These blocks come from the aligned allocator and go back to it, which on
+// Windows isn't free().
+static inline void* allocateTrackedAligned(size_t size, std::align_val_t alignment)
+{
+	recordAllocation(g_AllocTracker, size);
+#if defined(_WIN32)
+	return _aligned_malloc(size ? size : 1, size_t(alignment));
+#else
+	void* memory;
+	return posix_memalign(&memory, max(size_t(alignment), sizeof(void*)), size ? size : 1) == 0 ? memory : nullptr;
+#endif
+}
+
+ALLOC_TRACKER_NOINLINE static void deallocateTrackedAligned(void* memory)
+{
+#if defined(_WIN32)
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* memory = allocateTrackedAligned(size, alignment);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateTrackedAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateTrackedAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateTrackedAligned(memory);
+}
+#endif
+#endif
+
+// Vertex buffer binding points of the per-instance streams of the rock meshes
+#define ASTEROID_MATRIX_BINDING 3
+#define ASTEROID_FADE_BINDING 4
+
+// Streams this frame's FrameUniforms through the frame ring and binds them for every program
+static inline void bindFrameUniforms(const mat4& view, const mat4& proj, const vec3& cameraPosition, float time)
+{
+	FrameUniforms frameUniforms;
+	initFrameUniforms(frameUniforms, view, proj, cameraPosition, time);
+	RingAllocation frameRange = pushRing(g_FrameRing, &frameUniforms, sizeof(frameUniforms));
+	bindRingAllocation(g_FrameRing, GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frameRange);
+}
+
 static inline mat4 getViewMatrix()
 {
 	return lookAt(g_Camera.position, g_Camera.position + g_Camera.front, g_Camera.up);
@@ -227,11 +484,61 @@ void processInput(GLFWwindow* window)
 	{
 		blinnKeyPressed = false;
 	}
+
+	if ((glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) && !occlusionKeyPressed)
+	{
+		occlusionCulling = !occlusionCulling;
+		occlusionKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE)
+	{
+		occlusionKeyPressed = false;
+	}
+
+	if ((glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) && !sortingKeyPressed)
+	{
+		frontToBackSorting = !frontToBackSorting;
+		sortingKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE)
+	{
+		sortingKeyPressed = false;
+	}
+
+	if ((glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) && !impostorKeyPressed)
+	{
+		impostorsEnabled = !impostorsEnabled;
+		impostorKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_I) == GLFW_RELEASE)
+	{
+		impostorKeyPressed = false;
+	}
+
+	if ((glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) && !orbitKeyPressed)
+	{
+		orbitalAnimation = !orbitalAnimation;
+		orbitKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE)
+	{
+		orbitKeyPressed = false;
+	}
+
+	if ((glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) && !memoryReportKeyPressed)
+	{
+		printMemoryReport(g_MemoryTracker);
+		memoryReportKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE)
+	{
+		memoryReportKeyPressed = false;
+	}
 }
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	setGLViewport(g_GLState, 0, 0, width, height);
 }
 
 void mouseCallback(GLFWwindow* window, double xPosition, double yPosition)
@@ -324,11 +631,8 @@ bool32 checkForLinkingSuccess(u32 shaderProgram)
 	}
 }
 
-u32 createShader(const char* shaderPath, u32 shaderType)
+u32 createShaderFromSource(const char* shaderRawString, u32 shaderType)
 {
-	string shaderString = readFileBloated(shaderPath);
-	const char* shaderRawString = shaderString.c_str();
-
 	u32 shader = glCreateShader(shaderType);
 
 	glShaderSource(shader, 1, &shaderRawString, nullptr);
@@ -340,6 +644,12 @@ u32 createShader(const char* shaderPath, u32 shaderType)
 	return shader;
 }
 
+u32 createShader(const char* shaderPath, u32 shaderType)
+{
+	string shaderString = readFileBloated(shaderPath);
+	return createShaderFromSource(shaderString.c_str(), shaderType);
+}
+
 u32 createShaderProgram(u32 vertexShader, u32 fragmentShader)
 {
 	u32 shaderProgram = glCreateProgram();
@@ -354,7 +664,7 @@ u32 createShaderProgram(u32 vertexShader, u32 fragmentShader)
 	return shaderProgram;
 }
 
-#define MAX_SHADER_TYPES 3
+#define MAX_SHADER_TYPES 4
 
 struct ShaderNames
 {
@@ -371,21 +681,170 @@ enum ShaderType
 	VERTEX_SHADER,
 	FRAGMENT_SHADER,
 	GEOMETRY_SHADER,
+	// A program with a compute stage has no other stage
+	COMPUTE_SHADER,
+};
+
+// FNV-1a. constexpr so that names written as _u literals are hashed by the compiler
+static constexpr u32 hashUniformName(const char* name)
+{
+	u32 hash = 2166136261u;
+	for (; *name; name++)
+	{
+		hash = (hash ^ u8(*name)) * 16777619u;
+	}
+	return hash;
+}
+
+// Literal names are written "name"_u. Names only known at run time, e.g. built with snprintf,
+// have to go through the explicit constructor, so hashing at run time never happens by accident.
+struct UniformName
+{
+	u32 hash;
+
+	explicit UniformName(const char* name) : hash(hashUniformName(name)) {}
+	explicit constexpr UniformName(u32 hash_) : hash(hash_) {}
+};
+
+static constexpr UniformName operator"" _u(const char* name, size_t)
+{
+	return UniformName(hashUniformName(name));
+}
+
+struct ShaderUniform
+{
+	u32 nameHash;
+	int location;
+	u32 type;
+	int arraySize;
+};
+
+struct ShaderUniformBlock
+{
+	u32 nameHash;
+	u32 index;
+	int dataSize;
+};
+
+// Resolved once with Shader::getUniform(), then set without touching the name again
+template <typename T>
+struct UniformHandle
+{
+	int location;
 };
 
+static inline bool32 uniformTypeMatches(u32 type, const float*)
+{
+	return type == GL_FLOAT;
+}
+
+static inline bool32 uniformTypeMatches(u32 type, const vec3*)
+{
+	return type == GL_FLOAT_VEC3;
+}
+
+static inline bool32 uniformTypeMatches(u32 type, const mat4*)
+{
+	return type == GL_FLOAT_MAT4;
+}
+
+static inline bool32 uniformTypeMatches(u32 type, const u32*)
+{
+	return type == GL_UNSIGNED_INT;
+}
+
+// Samplers and image units are set through int handles as well
+static inline bool32 uniformTypeMatches(u32 type, const int*)
+{
+	return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_SHADOW ||
+		type == GL_IMAGE_2D || type == GL_IMAGE_2D_ARRAY || type == GL_IMAGE_3D || type == GL_IMAGE_BUFFER;
+}
+
 struct Shader
 {
 	u32 shaders[MAX_SHADER_TYPES];
 	bool32 activeShaders[MAX_SHADER_TYPES];
 	u32 program;
 
-	Shader(const ShaderNames& names)
+	// Open addressing on the name hash, the size is a power of two and never more than half full
+	vector<ShaderUniform> uniforms;
+	vector<ShaderUniformBlock> uniformBlocks;
+
+	// A single stage linked on its own, to be mixed with other stages in a ShaderPipeline
+	bool32 separable;
+	// local_size_x/y/z of a compute program
+	u32 workGroupSize[3];
+
+	// Build state. A program submitted through a ShaderBuildQueue can't be used until ready is set.
+	bool32 ready;
+	bool32 warm;
+	u64 cacheKey;
+	double buildStart;
+
+	// Builds the program before returning
+	Shader(const ShaderNames& names, const ShaderDefines* defines = nullptr, bool32 separable_ = false)
+	{
+		separable = separable_;
+		submitBuild(names, defines);
+		if (!ready)
+		{
+			finishBuild();
+		}
+	}
+
+	// Only submits the work, finishBuild() has to be called before the program is used unless
+	// ready is already set. Programs built this way are owned by a ShaderVariantCache and
+	// finished through its ShaderBuildQueue.
+	Shader(const ShaderNames& names, const ShaderDefines* defines, bool32 separable_, bool32 submitOnly)
+	{
+		separable = separable_;
+		submitBuild(names, defines);
+		if (!ready && !submitOnly)
+		{
+			finishBuild();
+		}
+	}
+
+	// Hands every compile and the link to the driver without asking for any status back, so a
+	// driver with parallel compilation can work on them in the background
+	void submitBuild(const ShaderNames& names, const ShaderDefines* defines)
 	{
+		CPU_ZONE("Shader compile");
+		buildStart = getElapsedSeconds();
+		ready = false;
+
+		ShaderSource sources[MAX_SHADER_TYPES];
+		const char* sourcePointers[MAX_SHADER_TYPES];
+		for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+		{
+			activeShaders[i] = *(names.value[i]) != '\0';
+			if (activeShaders[i])
+			{
+				preprocessShader(sources[i], names.value[i], defines);
+			}
+			sourcePointers[i] = activeShaders[i] ? sources[i].text.c_str() : nullptr;
+		}
+
+		program = glCreateProgram();
+		// Includes are already expanded in the sources, so editing a header misses the cache too
+		cacheKey = getProgramCacheKey(g_ProgramCache, sourcePointers, MAX_SHADER_TYPES, defines ? defines->text : nullptr);
+		cacheKey = hashProgramBytes(cacheKey, &separable, sizeof(separable));
+		glProgramParameteri(program, GL_PROGRAM_SEPARABLE, separable);
+		warm = loadProgramBinary(g_ProgramCache, program, cacheKey);
+		if (warm)
+		{
+			finishBuild();
+			return;
+		}
+
+		// A rejected binary can leave the program in a failed state, start over with a fresh one
+		deleteGLProgram(g_GLState, program);
+		program = glCreateProgram();
+		glProgramParameteri(program, GL_PROGRAM_SEPARABLE, separable);
 		for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
 		{
-			if (*(names.value[i]) == '\0')
+			if (!activeShaders[i])
 			{
-				activeShaders[i] = false;
 				continue;
 			}
 
@@ -404,608 +863,3489 @@ struct Shader
 				{
 					shaderType = GL_GEOMETRY_SHADER;
 				} break;
+				case (COMPUTE_SHADER):
+				{
+					shaderType = GL_COMPUTE_SHADER;
+				} break;
 			}
-			shaders[i] = createShader(names.value[i], shaderType);
-			activeShaders[i] = true;
+			shaders[i] = glCreateShader(shaderType);
+			glShaderSource(shaders[i], 1, &sourcePointers[i], nullptr);
+			glCompileShader(shaders[i]);
+			glAttachShader(program, shaders[i]);
 		}
-		program = glCreateProgram();
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program);
+	}
 
-		for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+	// Blocks until the driver is done if it isn't yet
+	void finishBuild()
+	{
+		CPU_ZONE("Shader link");
+		if (!warm)
 		{
-			if (activeShaders[i])
+			bool32 linked = checkForLinkingSuccess(program);
+			for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
 			{
-				glAttachShader(program, shaders[i]);
+				if (activeShaders[i])
+				{
+					// Only worth asking for the compile logs when the link failed
+					if (!linked)
+					{
+						checkForCompilationSuccess(shaders[i]);
+					}
+					glDetachShader(program, shaders[i]);
+					glDeleteShader(shaders[i]);
+				}
 			}
+			assert(linked);
+			saveProgramBinary(g_ProgramCache, program, cacheKey);
 		}
-		glLinkProgram(program);
-		checkForLinkingSuccess(program);
-		for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+
+		double buildMs = (getElapsedSeconds() - buildStart) * 1000.0;
+		if (warm)
 		{
-			if (activeShaders[i])
+			g_ProgramCache.warmPrograms++;
+			g_ProgramCache.warmMs += buildMs;
+		}
+		else
+		{
+			g_ProgramCache.coldPrograms++;
+			g_ProgramCache.coldMs += buildMs;
+		}
+
+		reflectUniforms();
+
+		if (activeShaders[COMPUTE_SHADER])
+		{
+			int localSize[3];
+			glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, localSize);
+			for (u32 i = 0; i < 3; i++)
 			{
-				glDeleteProgram(shaders[i]);
+				workGroupSize[i] = u32(localSize[i]);
 			}
 		}
+
+		const ShaderUniformBlock* frameBlock = findUniformBlock("FrameUniforms"_u);
+		if (frameBlock)
+		{
+			glUniformBlockBinding(program, frameBlock->index, FRAME_UNIFORMS_BINDING);
+		}
+		ready = true;
 	}
 
-	void use()
+	// Two names with one hash would silently share a location, so a collision stops the program in
+	// any build. 0 marks an empty slot, a name hashing to it collides with every empty slot.
+	void insertUniform(const char* name, int location, u32 type, int arraySize)
 	{
-		glUseProgram(program);
+		u32 nameHash = hashUniformName(name);
+		if (!nameHash)
+		{
+			printf("Uniform \"%s\" hashes to 0, rename it\n", name);
+			abort();
+		}
+		u32 mask = u32(uniforms.size()) - 1;
+		for (u32 slot = nameHash & mask;; slot = (slot + 1) & mask)
+		{
+			ShaderUniform& uniform = uniforms[slot];
+			if (!uniform.nameHash)
+			{
+				uniform.nameHash = nameHash;
+				uniform.location = location;
+				uniform.type = type;
+				uniform.arraySize = arraySize;
+				return;
+			}
+			if (uniform.nameHash == nameHash)
+			{
+				printf("Uniform name hash collision: \"%s\" has the hash 0x%08x of another uniform of program %u, rename one of them\n", name, nameHash, program);
+				abort();
+			}
+		}
 	}
 
-	void setInt(const char* objectName, int value) const
+	// Every active uniform outside of a block, arrays also under their name without the "[0]"
+	void reflectUniforms()
 	{
-		glUniform1i(glGetUniformLocation(program, objectName), value);
+		int uniformCount = 0;
+		glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+		u32 tableSize = 16;
+		while (tableSize < u32(uniformCount) * 4)
+		{
+			tableSize *= 2;
+		}
+		ShaderUniform emptyUniform = { 0, -1, 0, 0 };
+		uniforms.assign(tableSize, emptyUniform);
+
+		const u32 properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+		for (int i = 0; i < uniformCount; i++)
+		{
+			int values[ARRAYSIZE(properties)];
+			glGetProgramResourceiv(program, GL_UNIFORM, i, ARRAYSIZE(properties), properties, ARRAYSIZE(values), nullptr, values);
+			if (values[0] < 0)
+			{
+				continue;
+			}
+
+			char name[256];
+			int nameLength;
+			glGetProgramResourceName(program, GL_UNIFORM, i, sizeof(name), &nameLength, name);
+			insertUniform(name, values[0], values[1], values[2]);
+
+			if (nameLength > 3 && strcmp(name + nameLength - 3, "[0]") == 0)
+			{
+				name[nameLength - 3] = '\0';
+				insertUniform(name, values[0], values[1], values[2]);
+			}
+		}
+
+		int blockCount = 0;
+		glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &blockCount);
+		uniformBlocks.resize(blockCount);
+		for (int i = 0; i < blockCount; i++)
+		{
+			char name[256];
+			glGetProgramResourceName(program, GL_UNIFORM_BLOCK, i, sizeof(name), nullptr, name);
+			const u32 dataSizeProperty = GL_BUFFER_DATA_SIZE;
+			uniformBlocks[i].nameHash = hashUniformName(name);
+			uniformBlocks[i].index = u32(i);
+			glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, i, 1, &dataSizeProperty, 1, nullptr, &uniformBlocks[i].dataSize);
+		}
 	}
 
-	void setFloat(const char* objectName, float value) const
+	const ShaderUniform* findUniform(UniformName name) const
 	{
-		glUniform1f(glGetUniformLocation(program, objectName), value);
+		u32 mask = u32(uniforms.size()) - 1;
+		for (u32 slot = name.hash & mask;; slot = (slot + 1) & mask)
+		{
+			const ShaderUniform& uniform = uniforms[slot];
+			if (uniform.nameHash == name.hash)
+			{
+				return &uniform;
+			}
+			if (!uniform.nameHash)
+			{
+				return nullptr;
+			}
+		}
 	}
 
-	void setVec3(const char* objectName, const vec3& value)
+	// -1 for names that are not active in the program, which glProgramUniform* silently ignores,
+	// the same as glGetUniformLocation
+	int getUniformLocation(UniformName name) const
 	{
-		glUniform3fv(glGetUniformLocation(program, objectName), 1, &value[0]);
+		const ShaderUniform* uniform = findUniform(name);
+		return uniform ? uniform->location : -1;
 	}
-	void setVec3(const char* objectName, float x, float y, float z) const
+
+	const ShaderUniformBlock* findUniformBlock(UniformName name) const
 	{
-		glUniform3f(glGetUniformLocation(program, objectName), x, y, z);
+		for (const ShaderUniformBlock& block : uniformBlocks)
+		{
+			if (block.nameHash == name.hash)
+			{
+				return &block;
+			}
+		}
+		return nullptr;
 	}
-	void setMat4(const char* objectName, const mat4& value)
+
+	template <typename T>
+	UniformHandle<T> getUniform(UniformName name) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(program, objectName), 1, GL_FALSE, &value[0][0]);
+		const ShaderUniform* uniform = findUniform(name);
+		assert(!uniform || uniformTypeMatches(uniform->type, (const T*)nullptr));
+		UniformHandle<T> handle = { uniform ? uniform->location : -1 };
+		return handle;
 	}
-};
 
-
-struct Mesh
+	void use()
+	{
+		setGLProgram(g_GLState, program);
+	}
+
+	// Uniforms go straight to the program, so these work the same for a separable stage that is
+	// only ever bound through a ShaderPipeline
+	void set(UniformHandle<int> handle, int value) const
+	{
+		glProgramUniform1i(program, handle.location, value);
+	}
+
+	void set(UniformHandle<u32> handle, u32 value) const
+	{
+		glProgramUniform1ui(program, handle.location, value);
+	}
+
+	void set(UniformHandle<float> handle, float value) const
+	{
+		glProgramUniform1f(program, handle.location, value);
+	}
+
+	void set(UniformHandle<vec3> handle, const vec3& value) const
+	{
+		glProgramUniform3fv(program, handle.location, 1, &value[0]);
+	}
+
+	void set(UniformHandle<mat4> handle, const mat4& value) const
+	{
+		glProgramUniformMatrix4fv(program, handle.location, 1, GL_FALSE, &value[0][0]);
+	}
+
+	void setInt(UniformName name, int value) const
+	{
+		glProgramUniform1i(program, getUniformLocation(name), value);
+	}
+
+	void setFloat(UniformName name, float value) const
+	{
+		glProgramUniform1f(program, getUniformLocation(name), value);
+	}
+
+	void setVec3(UniformName name, const vec3& value) const
+	{
+		glProgramUniform3fv(program, getUniformLocation(name), 1, &value[0]);
+	}
+	void setVec3(UniformName name, float x, float y, float z) const
+	{
+		glProgramUniform3f(program, getUniformLocation(name), x, y, z);
+	}
+	void setMat4(UniformName name, const mat4& value) const
+	{
+		glProgramUniformMatrix4fv(program, getUniformLocation(name), 1, GL_FALSE, &value[0][0]);
+	}
+};
+
+// Every permutation of a program that has been asked for, keyed by its stage files and defines.
+// A variant is compiled the first time it's requested and shared by every later request.
+struct ShaderVariant
+{
+	u64 key;
+	Shader* shader;
+};
+
+struct ShaderVariantCache
+{
+	vector<ShaderVariant> variants;
+	u32 builtVariants;
+	u32 cachedLookups;
+};
+
+static inline void initShaderVariantCache(ShaderVariantCache& cache)
+{
+	cache.variants.clear();
+	cache.builtVariants = 0;
+	cache.cachedLookups = 0;
+}
+
+static inline u64 getShaderVariantKey(const ShaderNames& names, const ShaderDefines* defines, bool32 separable)
+{
+	u64 hash = 14695981039346656037ULL;
+	for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+	{
+		hash = hashProgramString(hash, names.value[i]);
+	}
+	hash = hashProgramBytes(hash, &separable, sizeof(separable));
+	return hashProgramString(hash, defines ? defines->text : "");
+}
+
+// Programs whose compile and link have been submitted but not checked yet. Asking for
+// GL_COMPILE_STATUS or GL_LINK_STATUS blocks until the driver is done, so with
+// GL_KHR_parallel_shader_compile (or the ARB version) the queue polls GL_COMPLETION_STATUS_KHR
+// and only finishes the programs that are already built. Without it a program is finished as
+// soon as it's polled, which is no worse than building it synchronously.
+//
+// The programs belong to the variant cache the queue was created for, pending holds their
+// indices in it. Variants are never removed or moved before the cache is destroyed, so an index
+// stays valid for as long as the queue.
+struct ShaderBuildQueue
+{
+	ShaderVariantCache* variants;
+	vector<u32> pending;
+	bool32 parallelCompile;
+};
+
+static inline void initShaderBuildQueue(ShaderBuildQueue& queue, ShaderVariantCache& variants)
+{
+	queue.variants = &variants;
+	queue.pending.clear();
+	queue.parallelCompile = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+	if (GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+}
+
+static inline Shader* getPendingShader(ShaderBuildQueue& queue, u32 pendingIndex)
+{
+	return queue.variants->variants[queue.pending[pendingIndex]].shader;
+}
+
+static inline void removePendingShader(ShaderBuildQueue& queue, u32 pendingIndex)
+{
+	queue.pending[pendingIndex] = queue.pending.back();
+	queue.pending.pop_back();
+}
+
+// Finishes the programs the driver is done with and returns how many are still pending
+static inline u32 pollShaderBuilds(ShaderBuildQueue& queue)
+{
+	for (u32 i = 0; i < queue.pending.size();)
+	{
+		Shader* shader = getPendingShader(queue, i);
+		int complete = GL_TRUE;
+		if (queue.parallelCompile)
+		{
+			glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &complete);
+		}
+
+		if (complete)
+		{
+			shader->finishBuild();
+			removePendingShader(queue, i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	return u32(queue.pending.size());
+}
+
+static inline void waitForShader(ShaderBuildQueue& queue, const Shader* shader)
+{
+	for (u32 i = 0; i < queue.pending.size(); i++)
+	{
+		Shader* pendingShader = getPendingShader(queue, i);
+		if (pendingShader == shader)
+		{
+			pendingShader->finishBuild();
+			removePendingShader(queue, i);
+			break;
+		}
+	}
+	assert(shader->ready);
+}
+
+static inline void finishShaderBuilds(ShaderBuildQueue& queue)
+{
+	for (u32 i = 0; i < queue.pending.size(); i++)
+	{
+		getPendingShader(queue, i)->finishBuild();
+	}
+	queue.pending.clear();
+}
+
+// With a queue the variant is only submitted, check Shader::ready before drawing with it.
+// Without one it's built before returning.
+static inline Shader* getShaderVariant(ShaderVariantCache& cache, const ShaderNames& names, const ShaderDefines* defines, ShaderBuildQueue* queue = nullptr, bool32 separable = false)
+{
+	u64 key = getShaderVariantKey(names, defines, separable);
+	// A program only ever has a handful of permutations, a linear search beats anything fancier
+	for (const ShaderVariant& variant : cache.variants)
+	{
+		if (variant.key == key)
+		{
+			cache.cachedLookups++;
+			return variant.shader;
+		}
+	}
+
+	ShaderVariant variant;
+	variant.key = key;
+	variant.shader = new Shader(names, defines, separable, queue != nullptr);
+	if (queue && !variant.shader->ready)
+	{
+		assert(queue->variants == &cache);
+		queue->pending.push_back(u32(cache.variants.size()));
+	}
+	cache.variants.push_back(variant);
+	cache.builtVariants++;
+	return variant.shader;
+}
+
+static inline void destroyShaderVariantCache(ShaderVariantCache& cache)
+{
+	for (ShaderVariant& variant : cache.variants)
+	{
+		deleteGLProgram(g_GLState, variant.shader->program);
+		delete variant.shader;
+	}
+	cache.variants.clear();
+}
+
+// One separable stage, shared by every pipeline it's part of
+static inline Shader* getShaderStage(ShaderVariantCache& cache, ShaderType type, const char* path, const ShaderDefines* defines, ShaderBuildQueue* queue = nullptr)
+{
+	ShaderNames names;
+	initShaderNames(&names);
+	strcpy(names.value[type], path);
+	return getShaderVariant(cache, names, defines, queue, true);
+}
+
+// Separable stages mixed at bind time. Each stage is compiled and linked once however many
+// pipelines use it, so N vertex and M fragment permutations cost N + M links instead of N * M,
+// and a new pipeline is only a handful of glUseProgramStages calls.
+struct ShaderPipeline
+{
+	u32 pipeline;
+	Shader* stages[MAX_SHADER_TYPES];
+
+	void use() const
+	{
+		// A program bound with glUseProgram takes precedence over the bound pipeline
+		setGLProgram(g_GLState, 0);
+		setGLProgramPipeline(g_GLState, pipeline);
+	}
+};
+
+struct ShaderPipelineEntry
+{
+	u64 key;
+	ShaderPipeline* pipeline;
+};
+
+struct ShaderPipelineCache
+{
+	vector<ShaderPipelineEntry> pipelines;
+	u32 builtPipelines;
+	u32 cachedLookups;
+};
+
+static inline void initShaderPipelineCache(ShaderPipelineCache& cache)
+{
+	cache.pipelines.clear();
+	cache.builtPipelines = 0;
+	cache.cachedLookups = 0;
+}
+
+static inline u32 getShaderStageBit(u32 type)
+{
+	switch (type)
+	{
+		case (VERTEX_SHADER):
+		{
+			return GL_VERTEX_SHADER_BIT;
+		} break;
+		case (FRAGMENT_SHADER):
+		{
+			return GL_FRAGMENT_SHADER_BIT;
+		} break;
+		case (GEOMETRY_SHADER):
+		{
+			return GL_GEOMETRY_SHADER_BIT;
+		} break;
+		case (COMPUTE_SHADER):
+		{
+			return GL_COMPUTE_SHADER_BIT;
+		} break;
+	}
+	assert(!"Unknown shader stage");
+	return 0;
+}
+
+// Separable stages are matched by location. Every user-defined varying on either side has to be
+// location qualified, or the stages fall back to matching by name and an output the consumer
+// doesn't declare leaves the rest undefined. Each input then has to be written at its location
+// with the same type; outputs nobody reads are allowed. Stages linked together get this checked
+// by the linker, separable ones only at draw time if at all, where a mismatch shows up as
+// undefined values rather than an error.
+static inline bool32 validateShaderInterface(const Shader& producer, const Shader& consumer)
+{
+	const u32 properties[2] = { GL_LOCATION, GL_TYPE };
+	bool32 valid = true;
+
+	int outputCount = 0;
+	glGetProgramInterfaceiv(producer.program, GL_PROGRAM_OUTPUT, GL_ACTIVE_RESOURCES, &outputCount);
+	for (int i = 0; i < outputCount; i++)
+	{
+		char name[256];
+		glGetProgramResourceName(producer.program, GL_PROGRAM_OUTPUT, i, sizeof(name), nullptr, name);
+		int location;
+		glGetProgramResourceiv(producer.program, GL_PROGRAM_OUTPUT, i, 1, properties, 1, nullptr, &location);
+		if (strncmp(name, "gl_", 3) != 0 && location < 0)
+		{
+			printf("Shader pipeline: output \"%s\" has no location\n", name);
+			valid = false;
+		}
+	}
+
+	int inputCount = 0;
+	glGetProgramInterfaceiv(consumer.program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputCount);
+	for (int i = 0; i < inputCount; i++)
+	{
+		char name[256];
+		glGetProgramResourceName(consumer.program, GL_PROGRAM_INPUT, i, sizeof(name), nullptr, name);
+		if (strncmp(name, "gl_", 3) == 0)
+		{
+			continue;
+		}
+
+		int input[2];
+		glGetProgramResourceiv(consumer.program, GL_PROGRAM_INPUT, i, 2, properties, 2, nullptr, input);
+		if (input[0] < 0)
+		{
+			printf("Shader pipeline: input \"%s\" has no location\n", name);
+			valid = false;
+			continue;
+		}
+
+		bool32 written = false;
+		for (int j = 0; j < outputCount && !written; j++)
+		{
+			int output[2];
+			glGetProgramResourceiv(producer.program, GL_PROGRAM_OUTPUT, j, 2, properties, 2, nullptr, output);
+			if (output[0] != input[0])
+			{
+				continue;
+			}
+
+			written = true;
+			if (output[1] != input[1])
+			{
+				printf("Shader pipeline: location %d (\"%s\") is written as type 0x%x but read as type 0x%x\n", input[0], name, output[1], input[1]);
+				valid = false;
+			}
+		}
+		if (!written)
+		{
+			printf("Shader pipeline: input \"%s\" at location %d is not written by the previous stage\n", name, input[0]);
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+// Stages have to be ready. geometry may be nullptr.
+static inline ShaderPipeline* getShaderPipeline(ShaderPipelineCache& cache, Shader* vertex, Shader* fragment, Shader* geometry = nullptr)
+{
+	Shader* stages[MAX_SHADER_TYPES] = {};
+	stages[VERTEX_SHADER] = vertex;
+	stages[FRAGMENT_SHADER] = fragment;
+	stages[GEOMETRY_SHADER] = geometry;
+
+	// The stage cache keys already cover the sources, the defines and the driver
+	u64 key = 14695981039346656037ULL;
+	for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+	{
+		u64 stageKey = stages[i] ? stages[i]->cacheKey : 0;
+		key = hashProgramBytes(key, &stageKey, sizeof(stageKey));
+	}
+	for (const ShaderPipelineEntry& entry : cache.pipelines)
+	{
+		if (entry.key == key)
+		{
+			cache.cachedLookups++;
+			return entry.pipeline;
+		}
+	}
+
+	ShaderPipeline* pipeline = new ShaderPipeline;
+	glGenProgramPipelines(1, &pipeline->pipeline);
+	for (u32 i = 0; i < MAX_SHADER_TYPES; i++)
+	{
+		pipeline->stages[i] = stages[i];
+		if (stages[i])
+		{
+			assert(stages[i]->ready && stages[i]->separable && stages[i]->activeShaders[i]);
+			glUseProgramStages(pipeline->pipeline, getShaderStageBit(i), stages[i]->program);
+		}
+	}
+
+	const Shader* lastStage = vertex;
+	bool32 interfaceValid = true;
+	if (geometry)
+	{
+		interfaceValid &= validateShaderInterface(*vertex, *geometry);
+		lastStage = geometry;
+	}
+	interfaceValid &= validateShaderInterface(*lastStage, *fragment);
+	assert(interfaceValid && "Shader pipeline stages don't agree on their interface");
+
+	// Catches what the interface check can't, e.g. a missing stage. It also looks at the current
+	// state, so a failure here is reported rather than treated as fatal.
+	glValidateProgramPipeline(pipeline->pipeline);
+	int validated = 0;
+	glGetProgramPipelineiv(pipeline->pipeline, GL_VALIDATE_STATUS, &validated);
+	if (!validated)
+	{
+		char infoLog[512];
+		glGetProgramPipelineInfoLog(pipeline->pipeline, sizeof(infoLog), nullptr, infoLog);
+		printf("Shader pipeline validation: %s\n", infoLog);
+	}
+
+	ShaderPipelineEntry entry = { key, pipeline };
+	cache.pipelines.push_back(entry);
+	cache.builtPipelines++;
+	return pipeline;
+}
+
+static inline void destroyShaderPipelineCache(ShaderPipelineCache& cache)
+{
+	for (ShaderPipelineEntry& entry : cache.pipelines)
+	{
+		deleteGLProgramPipeline(g_GLState, entry.pipeline->pipeline);
+		delete entry.pipeline;
+	}
+	cache.pipelines.clear();
+}
+
+struct ComputeGroups
+{
+	u32 x;
+	u32 y;
+	u32 z;
+};
+
+// The layout glDispatchComputeIndirect reads, for shaders that size the next dispatch themselves
+struct DispatchIndirectCommand
+{
+	u32 groupsX;
+	u32 groupsY;
+	u32 groupsZ;
+};
+
+// Enough work groups of the program's local size to cover the invocations, the shader is expected
+// to skip the ones past the end
+static inline ComputeGroups getComputeGroups(const Shader& shader, u32 invocationsX, u32 invocationsY = 1, u32 invocationsZ = 1)
+{
+	assert(shader.ready && shader.activeShaders[COMPUTE_SHADER]);
+	ComputeGroups groups;
+	groups.x = (invocationsX + shader.workGroupSize[0] - 1) / shader.workGroupSize[0];
+	groups.y = (invocationsY + shader.workGroupSize[1] - 1) / shader.workGroupSize[1];
+	groups.z = (invocationsZ + shader.workGroupSize[2] - 1) / shader.workGroupSize[2];
+	return groups;
+}
+
+// Binding helpers for the resources the next dispatch or draw touches. Reads wait for earlier
+// shader writes to the same resource, writes are tracked for whoever reads them next.
+static inline void bindStorageBuffer(BarrierTracker& tracker, u32 index, u32 buffer, ShaderAccess access)
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buffer);
+	u64 key = getBufferBarrierKey(buffer);
+	// Write after write needs the barrier as well, only write after read is ordered already
+	requireBarrier(tracker, key, GL_SHADER_STORAGE_BARRIER_BIT);
+	if (access & SHADER_WRITE)
+	{
+		trackShaderWrite(tracker, key);
+	}
+}
+
+static inline void bindStorageImage(BarrierTracker& tracker, u32 unit, u32 texture, int level, ShaderAccess access, u32 format)
+{
+	const u32 imageAccess[] = { 0, GL_READ_ONLY, GL_WRITE_ONLY, GL_READ_WRITE };
+	glBindImageTexture(unit, texture, level, GL_TRUE, 0, imageAccess[access], format);
+	u64 key = getTextureBarrierKey(texture);
+	requireBarrier(tracker, key, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	if (access & SHADER_WRITE)
+	{
+		trackShaderWrite(tracker, key);
+	}
+}
+
+static inline void dispatchCompute(BarrierTracker& tracker, const Shader& shader, ComputeGroups groups)
+{
+	assert(shader.ready && shader.activeShaders[COMPUTE_SHADER]);
+	setGLProgram(g_GLState, shader.program);
+	flushBarriers(tracker);
+	glDispatchCompute(groups.x, groups.y, groups.z);
+	commitShaderWrites(tracker);
+}
+
+// buffer holds a DispatchIndirectCommand at offset
+static inline void dispatchComputeIndirect(BarrierTracker& tracker, const Shader& shader, u32 buffer, u64 offset)
+{
+	assert(shader.ready && shader.activeShaders[COMPUTE_SHADER]);
+	assert(offset % 4 == 0);
+	setGLProgram(g_GLState, shader.program);
+	setGLBuffer(g_GLState, GL_DISPATCH_INDIRECT_BUFFER, buffer);
+	requireBarrier(tracker, getBufferBarrierKey(buffer), GL_COMMAND_BARRIER_BIT);
+	flushBarriers(tracker);
+	glDispatchComputeIndirect(GLintptr(offset));
+	commitShaderWrites(tracker);
+}
+
+// Points every "texture_<role><n>" sampler the shader has at the unit meshes bind that texture
+// to. The units don't depend on the mesh, so this runs once per program rather than per draw.
+static inline void assignTextureRoleSamplers(const Shader& shader)
+{
+	char name[32];
+	for (u32 role = 0; role < TEXTURE_ROLE_COUNT; role++)
+	{
+		for (u32 slot = 0; slot < TEXTURE_ROLE_SLOTS; slot++)
+		{
+			snprintf(name, sizeof(name), "texture_%s%u", g_TextureRoleNames[role], slot + 1);
+			UniformName samplerName(name);
+			if (shader.findUniform(samplerName))
+			{
+				shader.setInt(samplerName, int(slot * TEXTURE_ROLE_COUNT + role));
+			}
+		}
+	}
+}
+
+struct Mesh
 {
 	vector<Vertex> vertices;
 	vector<u32> indices;
 	vector<Texture> textures;
+	// The texture of each unit, 0 where the mesh has none, all bound by one glBindTextures
+	u32 unitTextures[TEXTURE_UNIT_COUNT];
+	u32 unitTargets[TEXTURE_UNIT_COUNT];
+	u32 unitCount;
 
 	u32 vertexArray;
 	u32 vertexBuffer;
 	u32 elementBuffer;
+	// The asset its buffers and CPU copies are accounted to
+	u32 memoryAsset;
+
+	void setupMesh()
+	{
+		glGenVertexArrays(1, &vertexArray);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &elementBuffer);
+
+		setGLVertexArray(g_GLState, vertexArray);
+
+		setGLBuffer(g_GLState, GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+		setGLBuffer(g_GLState, GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u32), indices.data(), GL_STATIC_DRAW);
+
+		// vertices and indices stay around for the occluders and the draw counts, under the name
+		// of the vertex buffer
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, vertexBuffer, memoryAsset, MEMORY_VERTEX_BUFFER, vertices.size() * sizeof(Vertex));
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, elementBuffer, memoryAsset, MEMORY_INDEX_BUFFER, indices.size() * sizeof(u32));
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, vertexBuffer, memoryAsset, MEMORY_CPU_GEOMETRY, vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(u32));
+
+		// vertex positions
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		// vertex normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+		// vertex texture coords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+		// vertex tangent
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+
+		setGLVertexArray(g_GLState, 0);
+	}
+
+	void setupTextureUnits()
+	{
+		u32 roleCounts[TEXTURE_ROLE_COUNT] = {};
+		memset(unitTextures, 0, sizeof(unitTextures));
+		// The first unit of every role is always bound, 0 if the mesh has no such texture, so its
+		// sampler never sees the texture of the mesh drawn before
+		unitCount = TEXTURE_ROLE_COUNT;
+		for (const Texture& texture : textures)
+		{
+			u32 slot = roleCounts[texture.role]++;
+			if (slot == TEXTURE_ROLE_SLOTS)
+			{
+				printf("Mesh has more than %u %s textures, the rest are left out\n", TEXTURE_ROLE_SLOTS, g_TextureRoleNames[texture.role]);
+			}
+			if (slot >= TEXTURE_ROLE_SLOTS)
+			{
+				continue;
+			}
+
+			u32 unit = slot * TEXTURE_ROLE_COUNT + texture.role;
+			unitTextures[unit] = texture.id;
+			unitCount = max(unitCount, unit + 1);
+		}
+		for (u32 unit = 0; unit < TEXTURE_UNIT_COUNT; unit++)
+		{
+			unitTargets[unit] = GL_TEXTURE_2D;
+		}
+	}
+
+	Mesh(const vector<Vertex>& vertices_, const vector<u32>& indices_, const vector<Texture>& textures_, u32 memoryAsset_)
+		: vertices(vertices_), indices(indices_), textures(textures_), memoryAsset(memoryAsset_)
+	{
+		setupMesh();
+		setupTextureUnits();
+	}
+
+	// The samplers have to point at the units of their roles, see assignTextureRoleSamplers()
+	void draw()
+	{
+		setGLTextures(g_GLState, 0, unitCount, unitTargets, unitTextures);
+
+		// Left bound, the next draw binds its own and the state cache drops the repeats
+		setGLVertexArray(g_GLState, vertexArray);
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	}
+};
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+// The vertex and index half of Model::processMesh(), on its own so --micro-bench can time it
+void convertMeshGeometry(const aiMesh* mesh, vector<Vertex>& vertices, vector<u32>& indices)
+{
+	vertices.reserve(vertices.size() + mesh->mNumVertices);
+	indices.reserve(indices.size() + mesh->mNumFaces * 3);
+	for (u32 i = 0; i < mesh->mNumVertices; i++)
+	{
+		Vertex vertex;
+		vec3 vector;
+		vector.x = mesh->mVertices[i].x;
+		vector.y = mesh->mVertices[i].y;
+		vector.z = mesh->mVertices[i].z;
+		vertex.position = vector;
+
+		vector.x = mesh->mNormals[i].x;
+		vector.y = mesh->mNormals[i].y;
+		vector.z = mesh->mNormals[i].z;
+		vertex.normal = vector;
+
+		if (mesh->mTextureCoords[0])
+		{
+			vec2 texCoord;
+			texCoord.x = mesh->mTextureCoords[0][i].x;
+			texCoord.y = mesh->mTextureCoords[0][i].y;
+			vertex.texCoord = texCoord;
+		}
+		else
+		{
+			vertex.texCoord = vec2(0.0f, 0.0f);
+		}
+
+		vector.x = mesh->mTangents[i].x;
+		vector.y = mesh->mTangents[i].y;
+		vector.z = mesh->mTangents[i].z;
+		vertex.tangent = vector;
+
+		vector.x = mesh->mBitangents[i].x;
+		vector.y = mesh->mBitangents[i].y;
+		vector.z = mesh->mBitangents[i].z;
+		vertex.bitangent = vector;
+
+		vertices.push_back(vertex);
+	}
+
+	for (u32 i = 0; i < mesh->mNumFaces; i++)
+	{
+		const aiFace& face = mesh->mFaces[i];
+		for (u32 j = 0; j < face.mNumIndices; j++)
+		{
+			indices.push_back(face.mIndices[j]);
+		}
+	}
+}
+
+struct Model
+{
+	vector<Texture> loadedTextures;
+	vector<Mesh> meshes;
+	string directory;
+	bool32 gammaCorrection;
+	// Everything the model allocates is accounted to its path
+	u32 memoryAsset;
+	//void processNode()
+	Model(const char* path, bool32 gammaCorrection = false)
+	{
+		load(path);
+	}
+
+	void processNode(aiNode* node, const aiScene* scene)
+	{
+		for (u32 i = 0; i < node->mNumMeshes; i++)
+		{
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			meshes.push_back(processMesh(mesh, scene));
+		}
+
+		for (u32 i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(node->mChildren[i], scene);
+		}
+	}
+
+	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+	{
+		vector<Vertex> vertices;
+		vector<u32> indices;
+		vector<Texture> textures;
+
+		convertMeshGeometry(mesh, vertices, indices);
+
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+
+		// 1. Diffuse maps
+		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TEXTURE_DIFFUSE);
+		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+		// 2. Specular maps
+		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TEXTURE_SPECULAR);
+		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		// 3. Normal maps
+		vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TEXTURE_NORMAL);
+		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+		// 4. Height maps
+		vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, TEXTURE_HEIGHT);
+		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+
+		return Mesh(vertices, indices, textures, memoryAsset);
+	}
+
+	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, TextureRole role)
+	{
+		vector<Texture> textures;
+		for (u32 i = 0; i < mat->GetTextureCount(type); i++)
+		{
+			aiString str;
+			mat->GetTexture(type, i, &str);
+			bool skip = false;
+			for (u32 j = 0; j < loadedTextures.size(); j++)
+			{
+				if (strcmp(loadedTextures[j].path.data(), str.C_Str()) == 0)
+				{
+					// The same file may serve another role in this material
+					Texture texture = loadedTextures[j];
+					texture.role = role;
+					textures.push_back(texture);
+					skip = true;
+					break;
+				}
+			}
+
+			if (!skip)
+			{
+				Texture texture;
+				texture.id = textureFromFile(str.C_Str());
+				texture.role = role;
+				texture.path = str.C_Str();
+				textures.push_back(texture);
+				loadedTextures.push_back(texture);
+			}
+		}
+
+		return textures;
+	}
+
+	u32 textureFromFile(const char* textureName)
+	{
+		string texturePath = directory + '/' + textureName;
+		u32 texture;
+		const u32 textureType = GL_TEXTURE_2D;
+		// TEXTURE 1
+		glGenTextures(1, &texture);
+		
+		int width, height, channelCount;
+		stbi_set_flip_vertically_on_load(true);
+
+		u8* data;
+		{
+			CPU_ZONE("Texture decode");
+			data = stbi_load(texturePath.c_str(), &width, &height, &channelCount, 0);
+		}
+		assert(data);
+
+		u32 format = 0;
+		switch (channelCount)
+		{
+			case (1):
+			{
+				format = GL_RED;
+			} break;
+			case (3):
+			{
+				format = GL_RGB;
+			} break;
+			case (4):
+			{
+				format = GL_RGBA;
+			} break;
+			default:
+			{
+				format = 0;
+				assert(channelCount != 3 && !(channelCount > 4) && "Error: Format not supported");
+			} break;
+		}
+
+		setGLTexture(g_GLState, textureType, texture);
+
+		glTexImage2D(textureType, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, texture, memoryAsset, MEMORY_TEXTURE, getTextureBytes(format, width, height, 1, getMipCount(width, height)));
+
+		glTexParameteri(textureType, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(textureType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(data);
+
+		return texture;
+	}
+
+	void load(string const& path)
+	{
+		CPU_ZONE("Model load");
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+
+		assert(scene && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) && (scene->mRootNode));
+
+		directory = path.substr(0, path.find_last_of('/'));
+
+		memoryAsset = getMemoryAsset(g_MemoryTracker, path.c_str());
+		processNode(scene->mRootNode, scene);
+	}
+
+	void draw()
+	{
+		for (Mesh& mesh : meshes)
+		{
+			mesh.draw();
+		}
+	}
+};
+
+// Deletes the vertex arrays, buffers and textures of the model and drops them and its CPU copies
+// from the memory tracker, leaving it empty
+void destroyModel(Model& model)
+{
+	for (Mesh& mesh : model.meshes)
+	{
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, mesh.vertexBuffer);
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, mesh.elementBuffer);
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, mesh.vertexBuffer);
+		deleteGLVertexArray(g_GLState, mesh.vertexArray);
+		deleteGLBuffer(g_GLState, mesh.vertexBuffer);
+		deleteGLBuffer(g_GLState, mesh.elementBuffer);
+	}
+	// Meshes share their textures through loadedTextures, which holds each of them once
+	for (const Texture& texture : model.loadedTextures)
+	{
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, texture.id);
+		deleteGLTextures(g_GLState, 1, &texture.id);
+	}
+	model.meshes.clear();
+	model.loadedTextures.clear();
+}
+
+// One packet per mesh on top of base, which holds the program and whatever the draws share. The
+// packets carry the first texture of each role on the mesh's units, so assignTextureRoleSamplers()
+// has to have run on the stage that owns the samplers.
+void recordModelPackets(RenderCommandBuffer& commands, const Model& model, const RenderPacket& base, RenderPass pass, float depth)
+{
+	for (const Mesh& mesh : model.meshes)
+	{
+		RenderPacket packet = base;
+		packet.vertexArray = mesh.vertexArray;
+		for (u32 unit = 0; unit < mesh.unitCount && unit < RENDER_PACKET_TEXTURES; unit++)
+		{
+			addRenderPacketTexture(packet, mesh.unitTargets[unit], mesh.unitTextures[unit]);
+		}
+		packet.indexed = true;
+		packet.elementCount = u32(mesh.indices.size());
+
+		u32 material = mesh.unitTextures[0];
+		recordRenderPacket(commands, packet, makeRenderKey(commands, pass, false, packet, material, depth));
+	}
+}
+
+OcclusionMesh buildOcclusionMesh(const Model& model)
+{
+	OcclusionMesh occlusionMesh;
+	initOcclusionMesh(occlusionMesh);
+	for (const Mesh& mesh : model.meshes)
+	{
+		appendOcclusionGeometry(occlusionMesh, &mesh.vertices[0].position, sizeof(Vertex), u32(mesh.vertices.size()), mesh.indices.data(), u32(mesh.indices.size()));
+	}
+
+	return occlusionMesh;
+}
+
+// Renders every variant from the IMPOSTOR_FRAMES x IMPOSTOR_FRAMES octahedral directions into
+// its own layer of a texture array. Each frame is an orthographic view of the bounding sphere.
+u32 bakeImpostorAtlas(Model* variants, u32 variantCount, const ImpostorField& field, Shader& bakeShader)
+{
+	const u32 mipCount = 4;
+	u32 atlas;
+	glGenTextures(1, &atlas);
+	setGLTexture(g_GLState, GL_TEXTURE_2D_ARRAY, atlas);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipCount, GL_RGBA8, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, variantCount);
+	u32 memoryAsset = getMemoryAsset(g_MemoryTracker, "impostor atlas");
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, atlas, memoryAsset, MEMORY_TEXTURE, getTextureBytes(GL_RGBA8, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, variantCount, mipCount));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+
+	u32 framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	setGLFramebuffer(g_GLState, framebuffer);
+
+	u32 depthBuffer;
+	glGenRenderbuffers(1, &depthBuffer);
+	setGLRenderbuffer(g_GLState, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, depthBuffer, memoryAsset, MEMORY_RENDER_TARGET, getTextureBytes(GL_DEPTH_COMPONENT24, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 1, 1));
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	bakeShader.use();
+	assignTextureRoleSamplers(bakeShader);
+	for (u32 variantIndex = 0; variantIndex < variantCount; variantIndex++)
+	{
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, atlas, 0, variantIndex);
+		assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+		setGLViewport(g_GLState, 0, 0, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+		setGLClearColor(g_GLState, 0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		const ImpostorVariant& variant = field.variants[variantIndex];
+		const float radius = variant.radius;
+		mat4 proj = ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+		bakeShader.setMat4("proj"_u, proj);
+
+		for (u32 frameY = 0; frameY < IMPOSTOR_FRAMES; frameY++)
+		{
+			for (u32 frameX = 0; frameX < IMPOSTOR_FRAMES; frameX++)
+			{
+				vec3 direction = getImpostorFrameDirection(frameX, frameY);
+				vec3 frameRight;
+				vec3 frameUp;
+				getImpostorFrameBasis(direction, frameRight, frameUp);
+
+				mat4 view = lookAt(variant.center + direction * 2.0f * radius, variant.center, frameUp);
+				bakeShader.setMat4("view"_u, view);
+
+				setGLViewport(g_GLState, frameX * IMPOSTOR_FRAME_SIZE, frameY * IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+				variants[variantIndex].draw();
+			}
+		}
+	}
+
+	setGLTexture(g_GLState, GL_TEXTURE_2D_ARRAY, atlas);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	setGLFramebuffer(g_GLState, 0);
+	deleteGLFramebuffer(g_GLState, framebuffer);
+	deleteGLRenderbuffer(g_GLState, depthBuffer);
+	untrackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, depthBuffer);
+	setGLViewport(g_GLState, viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	return atlas;
+}
+
+int queryMaxNAttributes()
+{
+	// query for n of attributes
+	int numberOfAttributes;
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numberOfAttributes);
+	printf("MAXIMUM NUMBER OF ATTRIBUTES SUPPORTED: %d\n", numberOfAttributes);
+	return numberOfAttributes;
+}
+
+u32 createBuffer(u32 bufferType, const void* data, size_t dataSize, u32 usage, u32 memoryAsset, MemoryCategory memoryCategory)
+{
+	u32 buffer;
+	glGenBuffers(1, &buffer);
+	setGLBuffer(g_GLState, bufferType, buffer);
+	glBufferData(bufferType, dataSize, data, usage);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, buffer, memoryAsset, memoryCategory, dataSize);
+
+	return buffer;
+}
+
+u32 createVertexArray()
+{
+	u32 vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+
+	return vertexArray;
+}
+
+struct VertexFeature
+{
+	u32 elementCount;
+	u32 elementSize;
+	u32 elementType;
+	bool32 normalized = false;
+};
+
+void setAttributes(const VertexFeature* vertexFeatures, size_t vertexFeatureCount, size_t vertexSize)
+{
+#ifdef _DEBUG
+	size_t sizeCount = 0;
+	for (u32 i = 0; i < vertexFeatureCount; i++)
+	{
+		VertexFeature const& feature = vertexFeatures[i];
+		sizeCount += feature.elementCount * feature.elementSize;
+	}
+	size_t sizeOfVertex = sizeof(Vertex);
+	if (sizeOfVertex != sizeCount)
+	{
+		assert(!"Vertex sizes differ. Check padding and vertex layout, maybe a bug made of copypasta origins");
+	}
+	assert(sizeCount == sizeof(Vertex));
+#endif
+
+	u64 stride = 0;
+	for (u32 i = 0; i < vertexFeatureCount; i++)
+	{
+		VertexFeature const& feature = vertexFeatures[i];
+		glVertexAttribPointer(i, feature.elementCount, feature.elementType, feature.normalized, (GLsizei)vertexSize, (void*)(stride));
+		glEnableVertexAttribArray(i);
+		stride += feature.elementCount * feature.elementSize;
+	}
+}
+
+u32 createTexture(const char* texturePath)
+{
+	u32 texture;
+	const u32 textureType = GL_TEXTURE_2D;
+	// TEXTURE 1
+	glGenTextures(1, &texture);
+	setGLTexture(g_GLState, textureType, texture);
+	
+	glTexParameteri(textureType, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(textureType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	
+	glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	int width, height, channelCount;
+	stbi_set_flip_vertically_on_load(true);
+
+	u8* data;
+	{
+		CPU_ZONE("Texture decode");
+		data = stbi_load(texturePath, &width, &height, &channelCount, 0);
+	}
+	assert(data);
+
+	u32 format;
+	switch (channelCount)
+	{
+		case (1):
+		{
+			format = GL_RED;
+		} break;
+		case (3):
+		{
+			format = GL_RGB;
+		} break;
+		case (4):
+		{
+			format = GL_RGBA;
+		} break;
+		default:
+		{
+			assert(channelCount != 3 && !(channelCount > 4) && "Error: Format not supported");
+		} break;
+	}
+
+	glTexImage2D(textureType, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, texture, getMemoryAsset(g_MemoryTracker, texturePath), MEMORY_TEXTURE, getTextureBytes(format, width, height, 1, getMipCount(width, height)));
+
+	stbi_image_free(data);
+
+	return texture;
+}
+
+void generateAsteroidField(mat4* modelMatrices, u32 asteroidCount)
+{
+	float radius = 150.0f;
+	float offset = 25.0f;
+
+	for (u32 i = 0; i < asteroidCount; i++)
+	{
+		mat4 world = mat4(1.0f);
+		float angle = float(i) / float(asteroidCount) * 360.0f;
+		float displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
+		float x = glm::sin(angle) * radius + displacement;
+		displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
+		float y = displacement * 0.4f;
+		displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
+		float z = cos(angle) * radius + displacement;
+		world = translate(world, vec3(x, y, z));
+
+		float scaleBy = (rand() % 20) / 100.0f + 0.05f;
+		world = scale(world, vec3(scaleBy));
+
+		float rotationAngle = (rand() % 360);
+		world = rotate(world, rotationAngle, vec3(0.4f, 0.6f, 0.8f));
+
+		modelMatrices[i] = world;
+	}
+}
+
+// Writes the matrices of the visible instances among draw positions [begin, end) (visibility ==
+// nullptr means all) in the given order (order == nullptr means generation order) and returns
+// how many were written. With instanceFades, the fade of each written instance goes to fades.
+// The outputs have to have room for end - begin instances.
+u32 gatherInstanceRange(mat4* matrices, float* fades, const mat4* modelMatrices, const float* instanceFades, u32 begin, u32 end, const u32* order, const u8* visibility)
+{
+	u32 outputCount = 0;
+	for (u32 i = begin; i < end; i++)
+	{
+		u32 instance = order ? order[i] : i;
+		if (!visibility || visibility[instance])
+		{
+			if (instanceFades)
+			{
+				fades[outputCount] = instanceFades[instance];
+			}
+			matrices[outputCount++] = modelMatrices[instance];
+		}
+	}
+
+	return outputCount;
+}
+
+// How many instances gatherInstanceRange() would write for the same range
+u32 countInstanceRange(u32 begin, u32 end, const u32* order, const u8* visibility)
+{
+	if (!visibility)
+	{
+		return end - begin;
+	}
+
+	u32 outputCount = 0;
+	for (u32 i = begin; i < end; i++)
+	{
+		outputCount += visibility[order ? order[i] : i] ? 1 : 0;
+	}
+	return outputCount;
+}
+
+u32 gatherInstanceMatrices(mat4* output, const mat4* modelMatrices, u32 instanceCount, const u32* order, const u8* visibility)
+{
+	return gatherInstanceRange(output, nullptr, modelMatrices, nullptr, 0, instanceCount, order, visibility);
+}
+
+// --bench-sort: flies a fixed camera path along the inside of the ring, where the field is the
+// densest, once in generation order and once sorted front to back. Overdraw is the number of
+// samples that passed the depth test divided by the samples that survive to the final image.
+void runSortBenchmark(GLFWwindow* window, const ShaderPipeline& asteroidPipeline, Model& rock, u32 instanceBuffer)
+{
+	const u32 instanceCounts[] = { 100000, 1000000 };
+	const u32 frameCount = 120;
+	const mat4 proj = perspective(radians(45.0f), ASPECT_RATIO, 0.1f, 1000.0f);
+
+	u32 samplesQuery;
+	glGenQueries(1, &samplesQuery);
+
+	printf("%-10s %-14s %16s %10s %14s %14s\n", "instances", "order", "shaded/frame", "overdraw", "first sort ms", "avg sort ms");
+	for (u32 countIndex = 0; countIndex < ARRAYSIZE(instanceCounts); countIndex++)
+	{
+		const u32 count = instanceCounts[countIndex];
+		vector<mat4> matrices(count);
+		vector<mat4> sortedMatrices(count);
+		srand(1234);
+		generateAsteroidField(matrices.data(), count);
+
+		setGLBuffer(g_GLState, GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(mat4), nullptr, GL_DYNAMIC_DRAW);
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, instanceBuffer, getMemoryAsset(g_MemoryTracker, "asteroid field"), MEMORY_INSTANCE_BUFFER, count * sizeof(mat4));
+
+		for (u32 sorted = 0; sorted < 2; sorted++)
+		{
+			InstanceSorter sorter;
+			initInstanceSorter(sorter, count, 0.1f, 1000.0f);
+
+			u64 shadedSamples = 0;
+			u64 visibleSamples = 0;
+			double firstSortTime = 0.0;
+			double sortTime = 0.0;
+
+			for (u32 frame = 0; frame < frameCount; frame++)
+			{
+				float angle = radians(frame * 0.25f);
+				vec3 eye(sin(angle) * 140.0f, 1.0f, cos(angle) * 140.0f);
+				vec3 tangent(cos(angle), 0.0f, -sin(angle));
+				mat4 view = lookAt(eye, eye + tangent, vec3(0.0f, 1.0f, 0.0f));
+
+				const mat4* uploadedMatrices = matrices.data();
+				if (sorted)
+				{
+					double start = getElapsedSeconds();
+					updateInstanceDepthKeys(sorter, g_Jobs, view, matrices.data(), nullptr);
+					sortInstancesFrontToBack(sorter, g_Jobs);
+					double elapsed = (getElapsedSeconds() - start) * 1000.0;
+					if (frame == 0)
+					{
+						firstSortTime = elapsed;
+					}
+					else
+					{
+						sortTime += elapsed;
+					}
+
+					gatherInstanceMatrices(sortedMatrices.data(), matrices.data(), count, sorter.order.data(), nullptr);
+					uploadedMatrices = sortedMatrices.data();
+				}
+				setGLBuffer(g_GLState, GL_ARRAY_BUFFER, instanceBuffer);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(mat4), uploadedMatrices);
+
+				setGLClearColor(g_GLState, 0.1f, 0.1f, 0.1f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				beginRingFrame(g_FrameRing);
+				bindFrameUniforms(view, proj, eye, float(frame));
+
+				asteroidPipeline.use();
+				asteroidPipeline.stages[FRAGMENT_SHADER]->setInt("texture_diffuse1"_u, 0);
+				setGLTexture(g_GLState, 0, GL_TEXTURE_2D, rock.loadedTextures[0].id);
+
+				// Pass 1 counts every sample that got shaded, pass 2 only the ones left in the depth buffer
+				for (u32 pass = 0; pass < 2; pass++)
+				{
+					if (pass == 1)
+					{
+						glDepthFunc(GL_EQUAL);
+						glDepthMask(GL_FALSE);
+						glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+					}
+
+					glBeginQuery(GL_SAMPLES_PASSED, samplesQuery);
+					for (u32 i = 0; i < rock.meshes.size(); i++)
+					{
+						setGLVertexArray(g_GLState, rock.meshes[i].vertexArray);
+						glDrawElementsInstanced(GL_TRIANGLES, rock.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, count);
+					}
+					glEndQuery(GL_SAMPLES_PASSED);
+
+					u64 samples;
+					glGetQueryObjectui64v(samplesQuery, GL_QUERY_RESULT, &samples);
+					(pass == 0 ? shadedSamples : visibleSamples) += samples;
+				}
+
+				glDepthFunc(GL_LESS);
+				glDepthMask(GL_TRUE);
+				glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+				endRingFrame(g_FrameRing);
+				// Headless runs have no window, the samples are counted all the same
+				if (window)
+				{
+					glfwSwapBuffers(window);
+					glfwPollEvents();
+				}
+			}
+
+			printf("%-10u %-14s %16llu %10.3f %14.3f %14.3f\n", count, sorted ? "front-to-back" : "generation",
+				(unsigned long long)(shadedSamples / frameCount),
+				visibleSamples ? double(shadedSamples) / double(visibleSamples) : 0.0,
+				firstSortTime, sortTime / (frameCount - 1));
+		}
+	}
+
+	glDeleteQueries(1, &samplesQuery);
+}
+
+// The programs of the planet and the asteroid ring. Only the fallback ones are built right away,
+// the others are submitted to the build queue and picked up by resolveAsteroidScenePrograms()
+// once they're all built; until then the scene draws with the fallback programs.
+struct AsteroidScenePrograms
+{
+	Shader* fallback[2];
+	UniformHandle<mat4> fallbackWorld;
+
+	Shader* planetVertex;
+	Shader* asteroidVertex;
+	// With the dithered cross-fade towards the impostors and without it. The planet and the
+	// frames that draw every rock as a mesh share the one without.
+	Shader* asteroidFragment[2];
+	Shader* impostorBake;
+	Shader* impostor;
+	Shader* orbit;
+
+	// Set by resolveAsteroidScenePrograms()
+	bool32 resolved;
+	ShaderPipeline* planetPipeline;
+	ShaderPipeline* asteroidPipelines[2];
+	UniformHandle<mat4> planetWorld;
+	UniformHandle<float> orbitTime;
+	UniformHandle<u32> orbitInstanceCount;
+};
+
+void submitAsteroidScenePrograms(AsteroidScenePrograms& programs, ShaderVariantCache& variants, ShaderBuildQueue& builds)
+{
+	// Flat shaded planet and rocks, built before anything else so the first frames have something
+	// to draw while the driver works on the real programs
+	for (u32 instanced = 0; instanced < 2; instanced++)
+	{
+		ShaderNames fallbackNames;
+		initShaderNames(&fallbackNames);
+		strcpy(fallbackNames.value[VERTEX_SHADER], "fallback.vert.glsl");
+		strcpy(fallbackNames.value[FRAGMENT_SHADER], "fallback.frag.glsl");
+		ShaderDefines fallbackDefines;
+		initShaderDefines(fallbackDefines);
+		addShaderDefine(fallbackDefines, "INSTANCED", int(instanced));
+		programs.fallback[instanced] = getShaderVariant(variants, fallbackNames, &fallbackDefines);
+	}
+	programs.fallbackWorld = programs.fallback[0]->getUniform<mat4>("world"_u);
+
+	// The planet and the asteroids are separable stages mixed in pipelines once they are built
+	programs.planetVertex = getShaderStage(variants, VERTEX_SHADER, "planet.vert.glsl", nullptr, &builds);
+	programs.asteroidVertex = getShaderStage(variants, VERTEX_SHADER, "asteroid.vert.glsl", nullptr, &builds);
+	for (u32 fade = 0; fade < 2; fade++)
+	{
+		ShaderDefines asteroidDefines;
+		initShaderDefines(asteroidDefines);
+		addShaderDefine(asteroidDefines, "IMPOSTOR_FADE", int(fade));
+		programs.asteroidFragment[fade] = getShaderStage(variants, FRAGMENT_SHADER, "asteroid.frag.glsl", &asteroidDefines, &builds);
+	}
+
+	ShaderNames impostorBakeShaderNames;
+	initShaderNames(&impostorBakeShaderNames);
+	strcpy(impostorBakeShaderNames.value[0], "impostor_bake.vert.glsl");
+	strcpy(impostorBakeShaderNames.value[1], "impostor_bake.frag.glsl");
+	programs.impostorBake = getShaderVariant(variants, impostorBakeShaderNames, nullptr, &builds);
+
+	ShaderNames impostorShaderNames;
+	initShaderNames(&impostorShaderNames);
+	strcpy(impostorShaderNames.value[0], "impostor.vert.glsl");
+	strcpy(impostorShaderNames.value[1], "impostor.frag.glsl");
+	programs.impostor = getShaderVariant(variants, impostorShaderNames, nullptr, &builds);
+
+	ShaderNames orbitShaderNames;
+	initShaderNames(&orbitShaderNames);
+	strcpy(orbitShaderNames.value[COMPUTE_SHADER], "orbit.comp.glsl");
+	ShaderDefines orbitDefines;
+	initShaderDefines(orbitDefines);
+	addShaderDefine(orbitDefines, "WORKGROUP_SIZE", ORBIT_WORKGROUP_SIZE);
+	programs.orbit = getShaderVariant(variants, orbitShaderNames, &orbitDefines, &builds);
+
+	programs.resolved = false;
+}
+
+// Once every program of the queue is built
+void resolveAsteroidScenePrograms(AsteroidScenePrograms& programs, ShaderPipelineCache& pipelines)
+{
+	programs.planetPipeline = getShaderPipeline(pipelines, programs.planetVertex, programs.asteroidFragment[0]);
+	programs.planetWorld = programs.planetVertex->getUniform<mat4>("world"_u);
+	for (u32 fade = 0; fade < 2; fade++)
+	{
+		programs.asteroidPipelines[fade] = getShaderPipeline(pipelines, programs.asteroidVertex, programs.asteroidFragment[fade]);
+	}
+	programs.orbitTime = programs.orbit->getUniform<float>("time"_u);
+	programs.orbitInstanceCount = programs.orbit->getUniform<u32>("instanceCount"_u);
+
+	// Sampler units are fixed per texture role, the render queue binds texture i of a packet to unit i
+	assignTextureRoleSamplers(*programs.planetPipeline->stages[FRAGMENT_SHADER]);
+	for (u32 fade = 0; fade < 2; fade++)
+	{
+		programs.asteroidFragment[fade]->setInt("texture_diffuse1"_u, 0);
+	}
+	programs.impostor->setInt("impostorAtlas"_u, 0);
+	programs.resolved = true;
+}
+
+// The ring's instances are gathered by the threads in chunks of draw positions
+#define ASTEROID_GATHER_CHUNK_SIZE 16384
+#define ASTEROID_MAX_ROCK_OCCLUDERS 32
+#define ASTEROID_ROCK_OCCLUDER_MIN_AREA 64.0f
+
+enum AsteroidCommandBuffer
+{
+	ASTEROID_MAIN_COMMANDS,
+	ASTEROID_IMPOSTOR_COMMANDS,
+	ASTEROID_COMMAND_BUFFER_COUNT,
+};
+
+// The planet and asteroidCount rocks around it, what main() draws every frame and the asteroid
+// benchmarks draw for their counts. Everything a frame fills is sized for its worst case by
+// initAsteroidScene(), so renderAsteroidScene() doesn't allocate.
+struct AsteroidScene
+{
+	AsteroidScenePrograms* programs;
+	Model* planet;
+	Model* rock;
+	u32 asteroidCount;
+	u32 memoryAsset;
+
+	vector<mat4> modelMatrices;
+	u32 instanceBuffer;
+	bool32 instanceBufferHoldsAll;
+
+	vector<OrbitalParameters> orbits;
+	u32 orbitBuffer;
+	float orbitTime;
+	// Whether the GPU moved the field since modelMatrices were last brought up to date
+	bool32 orbitsAheadOfCpu;
+	float orbitReportTime;
+
+	OcclusionMesh planetOccluder;
+	OcclusionMesh rockOccluder;
+	vector<u8> visibility;
+	vector<float> screenArea;
+	// Largest rocks on screen last frame, rasterized as occluders in the next one
+	vector<u32> rockOccluders;
+
+	InstanceSorter sorter;
+
+	ImpostorField impostorField;
+	u32 impostorAtlas;
+	u32 impostorInstanceBuffer;
+	u32 impostorVertexArray;
+	// Whether the rock meshes source their cross-fade from the ring
+	bool32 fadeEnabled;
+
+	// Where each gather chunk's instances start in the ring
+	vector<u32> chunkFirstDraws;
+	RenderCommandBuffer commandBuffers[ASTEROID_COMMAND_BUFFER_COUNT];
+	RenderQueue renderQueue;
+
+	u32 orbitGpuPass;
+	u32 planetGpuPass;
+	u32 asteroidGpuPass;
+	u32 impostorGpuPass;
+};
+
+// The camera and the M/O/B/I toggles of a frame
+struct AsteroidSceneFrame
+{
+	mat4 view;
+	mat4 proj;
+	vec3 eye;
+	float time;
+	float deltaTime;
+	bool32 useFallback;
+	bool32 occlusionCulling;
+	bool32 frontToBackSorting;
+	bool32 impostors;
+	bool32 orbitalAnimation;
+};
+
+// What a frame streams through the frame ring at most: the gathered instance matrices, the mesh
+// fades and the impostor draws, plus some room for smaller blocks and alignment
+u64 getAsteroidSceneFrameBytes(u32 asteroidCount)
+{
+	return u64(asteroidCount) * (sizeof(mat4) + sizeof(float) + sizeof(ImpostorDraw)) + 256 * 1024;
+}
+
+// Recreates the frame ring with room for RING_BUFFER_FRAMES frames of frameBytes, between frames
+void initFrameRing(u64 frameBytes)
+{
+	if (g_FrameRing.buffer)
+	{
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, g_FrameRing.buffer);
+		destroyRingBuffer(g_FrameRing, g_GLState);
+	}
+	initRingBuffer(g_FrameRing, RING_BUFFER_FRAMES * frameBytes);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, g_FrameRing.buffer, getMemoryAsset(g_MemoryTracker, "frame ring"), MEMORY_STREAMING_BUFFER, g_FrameRing.capacity);
+}
+
+// Points the rock meshes' instance attributes at the ASTEROID_MATRIX_BINDING and
+// ASTEROID_FADE_BINDING vertex buffer bindings, the matrices starting out in instanceBuffer
+void setupAsteroidVertexArrays(const Model& rock, u32 instanceBuffer)
+{
+	for (u32 i = 0; i < rock.meshes.size(); i++)
+	{
+		u32 vertexArray = rock.meshes[i].vertexArray;
+		setGLVertexArray(g_GLState, vertexArray);
+
+		// The instance streams go through vertex buffer bindings, so moving them between the static
+		// instance buffer and a range of the frame ring is a single glBindVertexBuffer
+		const u32 vec4Size = sizeof(vec4);
+		u32 relativeOffset = 0;
+		for (u32 currentVertexAttributeIndex = 3; currentVertexAttributeIndex < 7; currentVertexAttributeIndex++, relativeOffset += vec4Size)
+		{
+			glEnableVertexAttribArray(currentVertexAttributeIndex);
+			glVertexAttribFormat(currentVertexAttributeIndex, 4, GL_FLOAT, GL_FALSE, relativeOffset);
+			glVertexAttribBinding(currentVertexAttributeIndex, ASTEROID_MATRIX_BINDING);
+		}
+		glVertexBindingDivisor(ASTEROID_MATRIX_BINDING, 1);
+		glBindVertexBuffer(ASTEROID_MATRIX_BINDING, instanceBuffer, 0, sizeof(mat4));
+
+		glVertexAttribFormat(7, 1, GL_FLOAT, GL_FALSE, 0);
+		glVertexAttribBinding(7, ASTEROID_FADE_BINDING);
+		glVertexBindingDivisor(ASTEROID_FADE_BINDING, 1);
+
+		setGLVertexArray(g_GLState, 0);
+	}
+}
+
+// fieldSeed places the rocks, orbitSeed draws their orbits. Waits for the impostor bake program,
+// the others may still be building.
+void initAsteroidScene(AsteroidScene& scene, AsteroidScenePrograms& programs, ShaderBuildQueue& builds, Model& planet, Model& rock, u32 asteroidCount, u32 fieldSeed, u64 orbitSeed)
+{
+	scene.programs = &programs;
+	scene.planet = &planet;
+	scene.rock = &rock;
+	scene.asteroidCount = asteroidCount;
+	scene.memoryAsset = getMemoryAsset(g_MemoryTracker, "asteroid field");
+
+	scene.modelMatrices.resize(asteroidCount);
+	srand(fieldSeed);
+	generateAsteroidField(scene.modelMatrices.data(), asteroidCount);
+
+	scene.planetOccluder = buildOcclusionMesh(planet);
+	scene.rockOccluder = buildOcclusionMesh(rock);
+	scene.visibility.resize(asteroidCount);
+	scene.screenArea.resize(asteroidCount);
+	scene.rockOccluders.reserve(ASTEROID_MAX_ROCK_OCCLUDERS);
+	reserveOcclusionBuffer(g_OcclusionBuffer, u32(scene.planetOccluder.indices.size() + ASTEROID_MAX_ROCK_OCCLUDERS * scene.rockOccluder.indices.size()) / 3);
+
+	initInstanceSorter(scene.sorter, asteroidCount, 0.1f, 1000.0f);
+	reserveRadixSortScratch(g_Jobs, scene.sorter.radixScratch, asteroidCount);
+
+	// Rocks whose bounding sphere is under ~6 pixels in radius become impostors
+	scene.impostorField.screenRadiusThreshold = 6.0f;
+	scene.impostorField.fadeBand = 0.5f;
+	addImpostorVariant(scene.impostorField, scene.rockOccluder.aabbMin, scene.rockOccluder.aabbMax);
+	initImpostorInstances(scene.impostorField, scene.modelMatrices.data(), nullptr, asteroidCount);
+	waitForShader(builds, programs.impostorBake);
+	scene.impostorAtlas = bakeImpostorAtlas(&rock, 1, scene.impostorField, *programs.impostorBake);
+
+	scene.impostorInstanceBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, scene.impostorField.instances.data(), asteroidCount * sizeof(ImpostorInstance), GL_STATIC_DRAW, scene.memoryAsset, MEMORY_STORAGE_BUFFER);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, scene.impostorInstanceBuffer, scene.memoryAsset, MEMORY_CPU_INSTANCES, scene.impostorField.instances.capacity() * sizeof(ImpostorInstance));
+	scene.impostorVertexArray = createVertexArray();
+	setGLVertexArray(g_GLState, scene.impostorVertexArray);
+	glEnableVertexAttribArray(0);
+	glVertexAttribIFormat(0, 1, GL_UNSIGNED_INT, offsetof(ImpostorDraw, instance));
+	glVertexAttribBinding(0, 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribFormat(1, 1, GL_FLOAT, GL_FALSE, offsetof(ImpostorDraw, fade));
+	glVertexAttribBinding(1, 0);
+	glVertexBindingDivisor(0, 1);
+	setGLVertexArray(g_GLState, 0);
+
+	// Per instance cross-fade of the rock meshes, only sourced from the ring while impostors are on.
+	// Otherwise every instance reads the constant generic value 0, the fully opaque mesh.
+	glVertexAttrib1f(7, 0.0f);
+	scene.fadeEnabled = false;
+
+	scene.instanceBuffer = createBuffer(GL_ARRAY_BUFFER, scene.modelMatrices.data(), asteroidCount * sizeof(mat4), GL_DYNAMIC_DRAW, scene.memoryAsset, MEMORY_INSTANCE_BUFFER);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, scene.instanceBuffer, scene.memoryAsset, MEMORY_CPU_INSTANCES, asteroidCount * sizeof(mat4));
+	scene.instanceBufferHoldsAll = true;
+
+	scene.orbits.resize(asteroidCount);
+	generateOrbitalParameters(scene.orbits.data(), asteroidCount, orbitSeed);
+	scene.orbitBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, scene.orbits.data(), asteroidCount * sizeof(OrbitalParameters), GL_STATIC_DRAW, scene.memoryAsset, MEMORY_STORAGE_BUFFER);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, scene.orbitBuffer, scene.memoryAsset, MEMORY_CPU_INSTANCES, scene.orbits.capacity() * sizeof(OrbitalParameters));
+	scene.orbitTime = 0.0f;
+	scene.orbitsAheadOfCpu = false;
+	scene.orbitReportTime = 0.0f;
+
+	scene.orbitGpuPass = addGpuPass(g_GpuProfiler, "orbit");
+	scene.planetGpuPass = addGpuPass(g_GpuProfiler, "planet");
+	scene.asteroidGpuPass = addGpuPass(g_GpuProfiler, "asteroids");
+	scene.impostorGpuPass = addGpuPass(g_GpuProfiler, "impostors");
+
+	setupAsteroidVertexArrays(rock, scene.instanceBuffer);
+
+	// The chunks are counted first so every chunk knows where its instances start in the ring.
+	// The planet and the ring go on the main buffer, the impostor batch on its own.
+	const u32 gatherChunkCount = (asteroidCount + ASTEROID_GATHER_CHUNK_SIZE - 1) / ASTEROID_GATHER_CHUNK_SIZE;
+	scene.chunkFirstDraws.resize(gatherChunkCount + 1);
+	const u32 maxMainPackets = u32(planet.meshes.size() + rock.meshes.size());
+	const u32 maxFramePackets = maxMainPackets + 1;
+	for (u32 i = 0; i < ASTEROID_COMMAND_BUFFER_COUNT; i++)
+	{
+		u32 maxPackets = i == ASTEROID_MAIN_COMMANDS ? maxMainPackets : 1;
+		scene.commandBuffers[i].packets.reserve(maxPackets);
+		scene.commandBuffers[i].keys.reserve(maxPackets);
+		scene.commandBuffers[i].keyOverflows = 0;
+	}
+	scene.renderQueue.keyOverflows = 0;
+	reserveFrameArena(g_FrameArena, getRenderQueueArenaBytes(maxFramePackets));
+	reserveRadixSortScratch(g_Jobs, scene.renderQueue.sortScratch, maxFramePackets);
+}
+
+void destroyAsteroidScene(AsteroidScene& scene)
+{
+	if (scene.fadeEnabled)
+	{
+		for (const Mesh& mesh : scene.rock->meshes)
+		{
+			setGLVertexArray(g_GLState, mesh.vertexArray);
+			glDisableVertexAttribArray(7);
+		}
+		scene.fadeEnabled = false;
+	}
+
+	const u32 buffers[] = { scene.instanceBuffer, scene.orbitBuffer, scene.impostorInstanceBuffer };
+	for (u32 buffer : buffers)
+	{
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, buffer);
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, buffer);
+		deleteGLBuffer(g_GLState, buffer);
+	}
+	untrackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, scene.impostorAtlas);
+	deleteGLTextures(g_GLState, 1, &scene.impostorAtlas);
+	deleteGLVertexArray(g_GLState, scene.impostorVertexArray);
+}
+
+// Records, sorts and submits the frame. The caller has the frame ring, the GPU profiler frame and
+// the frame uniforms started, and the frame arena reset.
+void renderAsteroidScene(AsteroidScene& scene, const AsteroidSceneFrame& frame)
+{
+	const AsteroidScenePrograms& programs = *scene.programs;
+	const u32 asteroidCount = scene.asteroidCount;
+	const mat4* modelMatrices = scene.modelMatrices.data();
+
+	mat4 worldPlanetMatrix(1.0f);
+	worldPlanetMatrix = translate(worldPlanetMatrix, vec3(0.0f, -3.0f, 0.0f));
+	worldPlanetMatrix = scale(worldPlanetMatrix, vec3(4.0f));
+
+	const float farPlane = 1000.0f;
+	for (RenderCommandBuffer& commands : scene.commandBuffers)
+	{
+		resetRenderCommandBuffer(commands);
+	}
+	RenderCommandBuffer& mainCommands = scene.commandBuffers[ASTEROID_MAIN_COMMANDS];
+
+	RenderPacket planetPacket;
+	initRenderPacket(planetPacket);
+	if (frame.useFallback)
+	{
+		planetPacket.program = programs.fallback[0]->program;
+		planetPacket.worldProgram = programs.fallback[0]->program;
+		planetPacket.worldLocation = programs.fallbackWorld.location;
+	}
+	else
+	{
+		planetPacket.pipeline = programs.planetPipeline->pipeline;
+		planetPacket.worldProgram = programs.planetVertex->program;
+		planetPacket.worldLocation = programs.planetWorld.location;
+	}
+	planetPacket.world = worldPlanetMatrix;
+	planetPacket.gpuPass = scene.planetGpuPass;
+	float planetDepth = length(vec3(worldPlanetMatrix[3]) - frame.eye) / farPlane;
+	recordModelPackets(mainCommands, *scene.planet, planetPacket, RENDER_PASS_WORLD, planetDepth);
+
+	// Culling, sorting and impostors work on the CPU copy of the matrices, so they sit out while
+	// the GPU animates the orbits. When the animation stops, the CPU copy is evaluated from the
+	// same orbits at the same time, so the rocks stay where the GPU left them.
+	if (!frame.orbitalAnimation && scene.orbitsAheadOfCpu)
+	{
+		CPU_ZONE("Orbit hand-off");
+		parallelFor(g_Jobs, asteroidCount, 4096, [&](u32 begin, u32 end)
+		{
+			for (u32 i = begin; i < end; i++)
+			{
+				scene.modelMatrices[i] = evaluateOrbit(scene.orbits[i], scene.orbitTime);
+			}
+		});
+		initImpostorInstances(scene.impostorField, modelMatrices, nullptr, asteroidCount);
+		glNamedBufferSubData(scene.impostorInstanceBuffer, 0, asteroidCount * sizeof(ImpostorInstance), scene.impostorField.instances.data());
+		scene.orbitsAheadOfCpu = false;
+	}
+
+	// The fallback frames draw the whole field as it was generated
+	const bool32 animateOrbits = frame.orbitalAnimation && !frame.useFallback;
+	const bool32 useOcclusion = frame.occlusionCulling && !frame.orbitalAnimation && !frame.useFallback;
+	const bool32 useSorting = frame.frontToBackSorting && !frame.orbitalAnimation && !frame.useFallback;
+	const bool32 useImpostors = frame.impostors && !frame.orbitalAnimation && !frame.useFallback;
+
+	const u8* asteroidVisibilityMask = nullptr;
+	if (useOcclusion)
+	{
+		CPU_ZONE("Occlusion culling");
+		mat4 viewProj = frame.proj * frame.view;
+		beginOcclusionFrame(g_OcclusionBuffer, viewProj);
+		addOccluder(g_OcclusionBuffer, scene.planetOccluder, worldPlanetMatrix);
+		for (u32 rockIndex : scene.rockOccluders)
+		{
+			addOccluder(g_OcclusionBuffer, scene.rockOccluder, modelMatrices[rockIndex]);
+		}
+		rasterizeOccluders(g_OcclusionBuffer, g_Jobs);
+
+		parallelFor(g_Jobs, asteroidCount, 4096, [&](u32 begin, u32 end)
+		{
+			CPU_ZONE("Occlusion test");
+			for (u32 i = begin; i < end; i++)
+			{
+				OcclusionResult result = testOcclusionAABB(g_OcclusionBuffer, viewProj * modelMatrices[i], scene.rockOccluder.aabbMin, scene.rockOccluder.aabbMax, &scene.screenArea[i]);
+				scene.visibility[i] = (result == OcclusionResult::VISIBLE);
+			}
+		});
+
+		scene.rockOccluders.clear();
+		for (u32 i = 0; i < asteroidCount && scene.rockOccluders.size() < ASTEROID_MAX_ROCK_OCCLUDERS; i++)
+		{
+			if (scene.visibility[i] && scene.screenArea[i] >= ASTEROID_ROCK_OCCLUDER_MIN_AREA)
+			{
+				scene.rockOccluders.push_back(i);
+			}
+		}
+		asteroidVisibilityMask = scene.visibility.data();
+	}
+
+	// Instances that end up fully as impostors drop out of the mesh pass
+	const u8* meshVisibilityMask = asteroidVisibilityMask;
+	if (useImpostors)
+	{
+		CPU_ZONE("Impostor classification");
+		float pixelsPerUnit = (height * 0.5f) / tanf(radians(45.0f) * 0.5f);
+		classifyImpostors(scene.impostorField, g_Jobs, frame.eye, pixelsPerUnit, asteroidVisibilityMask);
+		meshVisibilityMask = scene.impostorField.meshVisibility.data();
+	}
+
+	if (useSorting)
+	{
+		CPU_ZONE("Instance sort");
+		updateInstanceDepthKeys(scene.sorter, g_Jobs, frame.view, modelMatrices, asteroidVisibilityMask);
+		sortInstancesFrontToBack(scene.sorter, g_Jobs);
+	}
+
+	// The fade stream is vertex array state, so it's switched here rather than per draw
+	if (scene.fadeEnabled != useImpostors)
+	{
+		for (const Mesh& mesh : scene.rock->meshes)
+		{
+			setGLVertexArray(g_GLState, mesh.vertexArray);
+			if (useImpostors)
+			{
+				glEnableVertexAttribArray(7);
+			}
+			else
+			{
+				glDisableVertexAttribArray(7);
+			}
+		}
+		scene.fadeEnabled = useImpostors;
+	}
+
+	// The ring is one instanced batch per mesh, keyed on the distance to its center
+	RenderPacket asteroidPacket;
+	initRenderPacket(asteroidPacket);
+	if (frame.useFallback)
+	{
+		asteroidPacket.program = programs.fallback[1]->program;
+	}
+	else
+	{
+		asteroidPacket.pipeline = programs.asteroidPipelines[useImpostors]->pipeline;
+	}
+	asteroidPacket.gpuPass = scene.asteroidGpuPass;
+	float ringDepth = length(frame.eye) / farPlane;
+
+	u32 asteroidMatrixSource = scene.instanceBuffer;
+	if (animateOrbits)
+	{
+		scene.orbitTime += frame.deltaTime;
+
+		beginGpuPass(g_GpuProfiler, scene.orbitGpuPass);
+		programs.orbit->set(programs.orbitTime, scene.orbitTime);
+		programs.orbit->set(programs.orbitInstanceCount, asteroidCount);
+		bindStorageBuffer(g_Barriers, 2, scene.orbitBuffer, SHADER_READ);
+		bindStorageBuffer(g_Barriers, 3, scene.instanceBuffer, SHADER_WRITE);
+		dispatchCompute(g_Barriers, *programs.orbit, getComputeGroups(*programs.orbit, asteroidCount));
+		endGpuPass(g_GpuProfiler, scene.orbitGpuPass);
+		scene.instanceBufferHoldsAll = false;
+		scene.orbitsAheadOfCpu = true;
+
+		if (frame.time - scene.orbitReportTime >= 1.0f)
+		{
+			u32 skippedBarriers;
+			GpuPassStats orbitStats = getGpuPassStats(g_GpuProfiler, scene.orbitGpuPass);
+			u32 issuedBarriers = takeBarrierStats(g_Barriers, &skippedBarriers);
+			printf("Orbital animation: %u instances, %.3f ms GPU (%u frames), %u barriers issued, %u skipped\n", asteroidCount, orbitStats.averageMs, orbitStats.sampleCount, issuedBarriers, skippedBarriers);
+			scene.orbitReportTime = frame.time;
+		}
+	}
+	else if (useOcclusion || useSorting || useImpostors)
+	{
+		CPU_ZONE("Record");
+		// The chunks are counted first, so each one gathers straight to where its instances
+		// start and the whole ring draws once per mesh. The ring is persistently mapped, the
+		// workers write straight into it, but only this thread allocates from it.
+		const u32* order = useSorting ? scene.sorter.order.data() : nullptr;
+		const u32 gatherChunkCount = u32(scene.chunkFirstDraws.size() - 1);
+		u32* chunkFirstDraws = scene.chunkFirstDraws.data();
+		RingAllocation matrixRange = allocateRing(g_FrameRing, asteroidCount * sizeof(mat4));
+		RingAllocation fadeRange = {};
+		RingAllocation impostorDrawRange = {};
+		if (useImpostors)
+		{
+			fadeRange = allocateRing(g_FrameRing, asteroidCount * sizeof(float));
+			impostorDrawRange = allocateRing(g_FrameRing, asteroidCount * sizeof(ImpostorDraw));
+		}
+		asteroidMatrixSource = g_FrameRing.buffer;
+
+		// Job 0 records the impostors, the others count a chunk each
+		parallelFor(g_Jobs, 1 + gatherChunkCount, 1, [&](u32 firstJob, u32 lastJob)
+		{
+			for (u32 job = firstJob; job < lastJob; job++)
+			{
+				if (job > 0)
+				{
+					CPU_ZONE("Count chunk");
+					u32 begin = (job - 1) * ASTEROID_GATHER_CHUNK_SIZE;
+					u32 end = min(begin + ASTEROID_GATHER_CHUNK_SIZE, asteroidCount);
+					chunkFirstDraws[job] = countInstanceRange(begin, end, order, meshVisibilityMask);
+					continue;
+				}
+
+				if (!useImpostors)
+				{
+					continue;
+				}
+
+				CPU_ZONE("Record impostors");
+				RenderCommandBuffer& commands = scene.commandBuffers[ASTEROID_IMPOSTOR_COMMANDS];
+				gatherImpostorDraws(scene.impostorField, order, asteroidVisibilityMask);
+				u32 impostorDrawCount = u32(scene.impostorField.draws.size());
+				if (impostorDrawCount)
+				{
+					memcpy(impostorDrawRange.data, scene.impostorField.draws.data(), impostorDrawCount * sizeof(ImpostorDraw));
+
+					RenderPacket impostorPacket;
+					initRenderPacket(impostorPacket);
+					impostorPacket.program = programs.impostor->program;
+					impostorPacket.vertexArray = scene.impostorVertexArray;
+					addRenderPacketTexture(impostorPacket, GL_TEXTURE_2D_ARRAY, scene.impostorAtlas);
+					addRenderPacketVertexBuffer(impostorPacket, 0, g_FrameRing.buffer, impostorDrawRange.offset, sizeof(ImpostorDraw));
+					impostorPacket.primitive = GL_TRIANGLE_STRIP;
+					impostorPacket.elementCount = 4;
+					impostorPacket.instanceCount = impostorDrawCount;
+					impostorPacket.gpuPass = scene.impostorGpuPass;
+					recordRenderPacket(commands, impostorPacket, makeRenderKey(commands, RENDER_PASS_WORLD, false, impostorPacket, scene.impostorAtlas, ringDepth));
+				}
+			}
+		});
+
+		// chunkFirstDraws[c + 1] held the count of chunk c, it becomes where chunk c + 1 starts
+		chunkFirstDraws[0] = 0;
+		for (u32 chunk = 0; chunk < gatherChunkCount; chunk++)
+		{
+			chunkFirstDraws[chunk + 1] += chunkFirstDraws[chunk];
+		}
+		const u32 meshDrawCount = chunkFirstDraws[gatherChunkCount];
+
+		parallelFor(g_Jobs, gatherChunkCount, 1, [&](u32 firstChunk, u32 lastChunk)
+		{
+			CPU_ZONE("Gather chunk");
+			for (u32 chunk = firstChunk; chunk < lastChunk; chunk++)
+			{
+				u32 begin = chunk * ASTEROID_GATHER_CHUNK_SIZE;
+				u32 end = min(begin + ASTEROID_GATHER_CHUNK_SIZE, asteroidCount);
+				u32 firstDraw = chunkFirstDraws[chunk];
+				mat4* chunkMatrices = (mat4*)matrixRange.data + firstDraw;
+				float* chunkFades = useImpostors ? (float*)fadeRange.data + firstDraw : nullptr;
+				const float* instanceFades = useImpostors ? scene.impostorField.fades.data() : nullptr;
+				u32 chunkDrawCount = gatherInstanceRange(chunkMatrices, chunkFades, modelMatrices, instanceFades, begin, end, order, meshVisibilityMask);
+				assert(chunkDrawCount == chunkFirstDraws[chunk + 1] - firstDraw);
+				(void)chunkDrawCount;
+			}
+		});
+
+		if (meshDrawCount)
+		{
+			RenderPacket ringPacket = asteroidPacket;
+			ringPacket.instanceCount = meshDrawCount;
+			addRenderPacketVertexBuffer(ringPacket, ASTEROID_MATRIX_BINDING, g_FrameRing.buffer, matrixRange.offset, sizeof(mat4));
+			if (useImpostors)
+			{
+				addRenderPacketVertexBuffer(ringPacket, ASTEROID_FADE_BINDING, g_FrameRing.buffer, fadeRange.offset, sizeof(float));
+			}
+			recordModelPackets(mainCommands, *scene.rock, ringPacket, RENDER_PASS_WORLD, ringDepth);
+		}
+
+		if (useImpostors && !scene.commandBuffers[ASTEROID_IMPOSTOR_COMMANDS].packets.empty())
+		{
+			bindStorageBuffer(g_Barriers, 1, scene.impostorInstanceBuffer, SHADER_READ);
+		}
+	}
+	else if (!scene.instanceBufferHoldsAll)
+	{
+		// The orbits may have been writing this buffer until the last frame
+		requireBarrier(g_Barriers, getBufferBarrierKey(scene.instanceBuffer), GL_BUFFER_UPDATE_BARRIER_BIT);
+		flushBarriers(g_Barriers);
+		glNamedBufferSubData(scene.instanceBuffer, 0, asteroidCount * sizeof(mat4), modelMatrices);
+		scene.instanceBufferHoldsAll = true;
+	}
+
+	if (asteroidMatrixSource == scene.instanceBuffer)
+	{
+		// The whole field straight from the instance buffer
+		RenderPacket allPacket = asteroidPacket;
+		allPacket.instanceCount = asteroidCount;
+		addRenderPacketVertexBuffer(allPacket, ASTEROID_MATRIX_BINDING, scene.instanceBuffer, 0, sizeof(mat4));
+		recordModelPackets(mainCommands, *scene.rock, allPacket, RENDER_PASS_WORLD, ringDepth);
+	}
+	requireBarrier(g_Barriers, getBufferBarrierKey(asteroidMatrixSource), GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	// Everything recorded is replayed here, on the one thread that owns the context
+	CPU_NAMED_ZONE(sortZone, "Render queue sort");
+	beginRenderQueue(scene.renderQueue, g_FrameArena, countRenderCommandBufferPackets(scene.commandBuffers, ASTEROID_COMMAND_BUFFER_COUNT));
+	appendRenderCommandBuffers(scene.renderQueue, scene.commandBuffers, ASTEROID_COMMAND_BUFFER_COUNT);
+	flushBarriers(g_Barriers);
+	sortRenderQueue(scene.renderQueue, g_Jobs);
+	CPU_END_ZONE(sortZone);
+
+	CPU_NAMED_ZONE(submitZone, "Submit");
+	submitRenderQueue(scene.renderQueue, g_GLState, &g_GpuProfiler);
+	CPU_END_ZONE(submitZone);
+}
+
+// Offscreen color and depth the headless mode renders into instead of the default framebuffer
+struct HeadlessTarget
+{
+	u32 framebuffer;
+	u32 color;
+	u32 depth;
+	// Fence behind the last frame presented, see presentHeadlessFrame()
+	GLsync previousFrame;
+};
+
+HeadlessTarget createHeadlessTarget(int targetWidth, int targetHeight)
+{
+	HeadlessTarget target;
+	u32 memoryAsset = getMemoryAsset(g_MemoryTracker, "headless target");
+	glGenRenderbuffers(1, &target.color);
+	setGLRenderbuffer(g_GLState, target.color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetWidth, targetHeight);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, target.color, memoryAsset, MEMORY_RENDER_TARGET, getTextureBytes(GL_RGBA8, targetWidth, targetHeight, 1, 1));
+	glGenRenderbuffers(1, &target.depth);
+	setGLRenderbuffer(g_GLState, target.depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, targetWidth, targetHeight);
+	trackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, target.depth, memoryAsset, MEMORY_RENDER_TARGET, getTextureBytes(GL_DEPTH24_STENCIL8, targetWidth, targetHeight, 1, 1));
+	setGLRenderbuffer(g_GLState, 0);
+
+	glGenFramebuffers(1, &target.framebuffer);
+	setGLFramebuffer(g_GLState, target.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	setGLFramebuffer(g_GLState, 0);
+	target.previousFrame = nullptr;
+	return target;
+}
+
+// Stands in for the swap. Nothing holds a headless frame back otherwise, and timing it would only
+// measure how fast the commands are submitted. Like a swap chain one frame deep, the frame waits
+// for the GPU to finish the previous one, so the CPU and the GPU still overlap by a frame and a
+// GPU bound run shows up in the frame time.
+void presentHeadlessFrame(HeadlessTarget& target)
+{
+	GLsync frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	if (target.previousFrame)
+	{
+		u32 status;
+		do
+		{
+			status = glClientWaitSync(target.previousFrame, 0, 1000000);
+		} while (status == GL_TIMEOUT_EXPIRED);
+		assert(status != GL_WAIT_FAILED);
+		glDeleteSync(target.previousFrame);
+	}
+	target.previousFrame = frameFence;
+}
 
-	void setupMesh()
+void destroyHeadlessTarget(HeadlessTarget& target)
+{
+	if (target.previousFrame)
 	{
-		glGenVertexArrays(1, &vertexArray);
-		glGenBuffers(1, &vertexBuffer);
-		glGenBuffers(1, &elementBuffer);
+		glDeleteSync(target.previousFrame);
+		target.previousFrame = nullptr;
+	}
+	deleteGLFramebuffer(g_GLState, target.framebuffer);
+	deleteGLRenderbuffer(g_GLState, target.color);
+	deleteGLRenderbuffer(g_GLState, target.depth);
+	untrackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, target.color);
+	untrackMemory(g_MemoryTracker, MEMORY_OBJECT_RENDERBUFFER, target.depth);
+}
 
-		glBindVertexArray(vertexArray);
+// The headless camera follows the --bench-sort path: along the inside of the ring, looking
+// along it, a quarter degree per frame
+void scriptHeadlessCamera(Camera& camera, u32 frame)
+{
+	float angle = radians(frame * 0.25f);
+	camera.position = vec3(sin(angle) * 140.0f, 1.0f, cos(angle) * 140.0f);
+	vec3 tangent(cos(angle), 0.0f, -sin(angle));
+	camera.pitch = 0.0f;
+	camera.yaw = degrees(atan2(tangent.z, tangent.x));
+	updateCameraVectors(camera);
+}
 
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+void writeHeadlessReport(FILE* file, const FrameTimeStats& frameStats, const FrameStats& histograms, u32 warmupFrames, u32 asteroidCount, const GpuProfiler& profiler)
+{
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+	fprintf(file, "\t\"width\": %d,\n\t\"height\": %d,\n", width, height);
+	fprintf(file, "\t\"asteroids\": %u,\n", asteroidCount);
+	fprintf(file, "\t\"warmupFrames\": %u,\n\t\"frames\": %u,\n", warmupFrames, frameStats.frameCount);
+	fprintf(file, "\t\"frameMs\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", frameStats.meanMs, frameStats.p50Ms, frameStats.p99Ms, frameStats.maxMs);
+	fprintf(file, "\t\"histogramMs\": ");
+	writeFrameStatsJson(file, histograms, "\t");
+	fprintf(file, ",\n");
+	fprintf(file, "\t\"gpuPassMs\": {\n");
+	for (u32 pass = 0; pass < profiler.passCount; pass++)
+	{
+		GpuPassStats stats = getGpuPassStats(profiler, pass);
+		fprintf(file, "\t\t\"%s\": { \"mean\": %.4f, \"frames\": %u }%s\n", profiler.passes[pass].name, stats.runAverageMs, stats.runSampleCount, pass + 1 < profiler.passCount ? "," : "");
+	}
+	fprintf(file, "\t}\n}\n");
+}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u32), indices.data(), GL_STATIC_DRAW);
+// What a --bench run draws with, set up by main() before the interactive scene takes over
+struct BenchmarkContext
+{
+	GLFWwindow* window;
+	bool32 headless;
+	HeadlessTarget* headlessTarget;
+	u32 framebuffer;
+	u32 warmupFrames;
+	u32 frameCount;
+	u64 seed;
+	Model* planet;
+	Model* rock;
+	// Built and resolved
+	AsteroidScenePrograms* asteroidPrograms;
+	ShaderBuildQueue* shaderBuilds;
+	ShaderVariantCache* shaderVariants;
+};
 
-		// vertex positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-		// vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		// vertex texture coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-		// vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+struct BenchmarkFrameCounters
+{
+	u64 drawCalls;
+	u64 triangles;
+};
 
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+#define BENCHMARK_GRID_SIDE 10
+#define BENCHMARK_LIGHTS_GRID_SIDE 5
+#define BENCHMARK_POINT_LIGHTS 32
+#define BENCHMARK_TEXTURE_COUNT 128
+#define BENCHMARK_TEXTURE_SIZE 512
+#define BENCHMARK_TEXTURED_ROCKS 1024
 
-		glBindVertexArray(0);
-	}
+// Circles center at the given radius and height, half a degree per frame
+mat4 getBenchmarkOrbitView(const vec3& center, float radius, float height, u32 frame, vec3& eye)
+{
+	float angle = radians(frame * 0.5f);
+	eye = center + vec3(sin(angle) * radius, height, cos(angle) * radius);
+	return lookAt(eye, center, vec3(0.0f, 1.0f, 0.0f));
+}
 
-	Mesh(const vector<Vertex>& vertices_, const vector<u32>& indices_, const vector<Texture>& textures_)
-		: vertices(vertices_), indices(indices_), textures(textures_)
+// What the memory tracker has for this instance of the model, other loads of the same path are
+// accounted to the same asset
+u64 getModelGpuBytes(const Model& model, u64* cpuBytes)
+{
+	u64 bytes = 0;
+	*cpuBytes = 0;
+	for (const Mesh& mesh : model.meshes)
 	{
-		setupMesh();
+		bytes += getTrackedMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, mesh.vertexBuffer);
+		bytes += getTrackedMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, mesh.elementBuffer);
+		*cpuBytes += getTrackedMemory(g_MemoryTracker, MEMORY_OBJECT_CPU, mesh.vertexBuffer);
 	}
 
-	void draw(const Shader& shader)
+	for (const Texture& texture : model.loadedTextures)
 	{
-		u32 diffuseNumber = 1;
-		u32 specularNumber = 1;
-		u32 normalNumber = 1;
-		u32 heightNumber = 1;
+		bytes += getTrackedMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, texture.id);
+	}
+	return bytes;
+}
+
+// Merges, sorts and submits a scenario's packets the way a frame of the main scene does, and
+// counts what the queue drew
+void submitBenchmarkCommands(RenderCommandBuffer& commands, RenderQueue& queue, BenchmarkFrameCounters& counters)
+{
+	beginRenderQueue(queue, g_FrameArena, countRenderCommandBufferPackets(&commands, 1));
+	appendRenderCommandBuffers(queue, &commands, 1);
+	sortRenderQueue(queue, g_Jobs);
+	submitRenderQueue(queue, g_GLState, &g_GpuProfiler);
+	counters.drawCalls += queue.packetCount;
+	counters.triangles += countRenderQueueTriangles(queue);
+}
 
-		for (u32 i = 0; i < textures.size(); i++)
+// Sizes what a scenario that records up to maxPackets packets a frame fills, so its frames don't
+// allocate
+void reserveBenchmarkCommands(RenderCommandBuffer& commands, RenderQueue& queue, u32 maxPackets)
+{
+	commands.packets.reserve(maxPackets);
+	commands.keys.reserve(maxPackets);
+	commands.keyOverflows = 0;
+	queue.keyOverflows = 0;
+	reserveFrameArena(g_FrameArena, getRenderQueueArenaBytes(maxPackets));
+	reserveRadixSortScratch(g_Jobs, queue.sortScratch, maxPackets);
+}
+
+// Warm up frames first, then frameCount measured ones. drawFrame(frame, counters) issues the
+// frame's draws; the framebuffer, the clear, the frame arena, the frame ring and the GPU profiler
+// frame are handled here.
+template <typename DrawFunction>
+void runBenchmarkFrames(const BenchmarkContext& context, BenchmarkResult& result, DrawFunction&& drawFrame)
+{
+	vector<float> frameMs;
+	vector<float> cpuMs;
+	frameMs.reserve(context.frameCount);
+	cpuMs.reserve(context.frameCount);
+	BenchmarkFrameCounters totals = {};
+
+	g_GpuProfiler.recordRunSamples = true;
+	double frameStart = getElapsedSeconds();
+	for (u32 frame = 0; frame < context.warmupFrames + context.frameCount; frame++)
+	{
+		if (frame == context.warmupFrames)
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
+			drainGpuProfiler(g_GpuProfiler);
+			resetGpuProfilerTotals(g_GpuProfiler);
+			frameStart = getElapsedSeconds();
+		}
+
+		double cpuStart = getElapsedSeconds();
+		resetFrameArena(g_FrameArena);
+		setGLFramebuffer(g_GLState, context.framebuffer);
+		setGLClearColor(g_GLState, 0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		beginGpuProfilerFrame(g_GpuProfiler);
+		beginRingFrame(g_FrameRing);
 
-			string number;
-			string name = textures[i].type;
+		BenchmarkFrameCounters counters = {};
+		drawFrame(frame, counters);
 
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNumber++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNumber++);
-			else if (name == "texture_normal")
-				number = std::to_string(normalNumber++);
-			else if (name == "texture_height")
-				number = std::to_string(heightNumber++);
+		endRingFrame(g_FrameRing);
+		endGpuProfilerFrame(g_GpuProfiler);
+		double cpuEnd = getElapsedSeconds();
 
-			shader.setInt((name + number).c_str(), (int)i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		if (context.headless)
+		{
+			presentHeadlessFrame(*context.headlessTarget);
+		}
+		else
+		{
+			glfwSwapBuffers(context.window);
+			glfwPollEvents();
 		}
-		
-		glBindVertexArray(vertexArray);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
 
-		glActiveTexture(GL_TEXTURE0);
+		double now = getElapsedSeconds();
+		if (frame >= context.warmupFrames)
+		{
+			frameMs.push_back(float((now - frameStart) * 1000.0));
+			cpuMs.push_back(float((cpuEnd - cpuStart) * 1000.0));
+			totals.drawCalls += counters.drawCalls;
+			totals.triangles += counters.triangles;
+		}
+		frameStart = now;
 	}
-};
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+	drainGpuProfiler(g_GpuProfiler);
+	g_GpuProfiler.recordRunSamples = false;
+	result.frameMs = computeFrameTimeStats(frameMs);
+	result.cpuMs = computeFrameTimeStats(cpuMs);
+	result.gpuMs = computeFrameTimeStats(g_GpuProfiler.passes[GPU_PROFILER_FRAME_PASS].runSamples);
+	result.drawCalls = context.frameCount ? double(totals.drawCalls) / context.frameCount : 0.0;
+	result.triangles = context.frameCount ? double(totals.triangles) / context.frameCount : 0.0;
+	resetGpuProfilerTotals(g_GpuProfiler);
+}
 
-struct Model
+// The main scene with asteroidCount rocks, drawn by the same frame function as main() with the
+// toggles main() starts with, along the headless camera path. The frame ring is sized for the
+// count and shrunk back afterwards.
+void runAsteroidBenchmark(const BenchmarkContext& context, u32 asteroidCount, BenchmarkResult& result)
 {
-	vector<Texture> loadedTextures;
-	vector<Mesh> meshes;
-	string directory;
-	bool32 gammaCorrection;
-	//void processNode()
-	Model(const char* path, bool32 gammaCorrection = false)
+	double loadStart = getElapsedSeconds();
+	initFrameRing(getAsteroidSceneFrameBytes(asteroidCount));
+	AsteroidScene scene;
+	initAsteroidScene(scene, *context.asteroidPrograms, *context.shaderBuilds, *context.planet, *context.rock, asteroidCount, u32(context.seed), context.seed);
+	result.loadMs = (getElapsedSeconds() - loadStart) * 1000.0;
+	const MemoryAsset& asset = g_MemoryTracker.assets[scene.memoryAsset];
+	result.gpuBytes = getMemoryAssetBytes(asset, false) + getTrackedMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, scene.impostorAtlas) + g_FrameRing.capacity;
+	result.cpuBytes = getMemoryAssetBytes(asset, true);
+
+	Camera camera;
+	initCamera(camera);
+	AsteroidSceneFrame sceneFrame;
+	sceneFrame.proj = perspective(radians(45.0f), ASPECT_RATIO, 0.1f, 1000.0f);
+	sceneFrame.deltaTime = 1.0f / 60.0f;
+	sceneFrame.useFallback = false;
+	sceneFrame.occlusionCulling = occlusionCulling;
+	sceneFrame.frontToBackSorting = frontToBackSorting;
+	sceneFrame.impostors = impostorsEnabled;
+	sceneFrame.orbitalAnimation = orbitalAnimation;
+	runBenchmarkFrames(context, result, [&](u32 frame, BenchmarkFrameCounters& counters)
 	{
-		load(path);
-	}
+		scriptHeadlessCamera(camera, frame);
+		sceneFrame.view = lookAt(camera.position, camera.position + camera.front, camera.up);
+		sceneFrame.eye = camera.position;
+		sceneFrame.time = frame / 60.0f;
+		bindFrameUniforms(sceneFrame.view, sceneFrame.proj, sceneFrame.eye, sceneFrame.time);
+
+		renderAsteroidScene(scene, sceneFrame);
+		counters.drawCalls += scene.renderQueue.packetCount;
+		counters.triangles += countRenderQueueTriangles(scene.renderQueue);
+	});
+
+	destroyAsteroidScene(scene);
+	initFrameRing(getAsteroidSceneFrameBytes(0));
+}
 
-	void processNode(aiNode* node, const aiScene* scene)
+// A grid of nanosuits, one packet per mesh and suit through the render queue. With manyLights the
+// suits are shaded by phong_all_lights with BENCHMARK_POINT_LIGHTS point lights on top of the
+// directional light and the spotlight, on a smaller grid.
+void runNanosuitBenchmark(const BenchmarkContext& context, bool32 manyLights, BenchmarkResult& result)
+{
+	double loadStart = getElapsedSeconds();
+	Model nanosuit("models/nanosuit/nanosuit.obj");
+
+	ShaderNames names;
+	initShaderNames(&names);
+	strcpy(names.value[VERTEX_SHADER], manyLights ? "phong.vert.glsl" : "nanosuit.vert.glsl");
+	strcpy(names.value[FRAGMENT_SHADER], manyLights ? "phong_all_lights.frag.glsl" : "nanosuit.frag.glsl");
+	ShaderDefines defines;
+	initShaderDefines(defines);
+	addShaderDefine(defines, "POINT_LIGHT_COUNT", BENCHMARK_POINT_LIGHTS);
+	Shader* shader = getShaderVariant(*context.shaderVariants, names, manyLights ? &defines : nullptr);
+	result.loadMs = (getElapsedSeconds() - loadStart) * 1000.0;
+	result.gpuBytes = getModelGpuBytes(nanosuit, &result.cpuBytes);
+
+	UniformHandle<mat4> world = shader->getUniform<mat4>("world"_u);
+	assignTextureRoleSamplers(*shader);
+	if (manyLights)
 	{
-		for (u32 i = 0; i < node->mNumMeshes; i++)
+		// The units of the first diffuse and specular maps of every mesh
+		shader->setInt("material.diffuse"_u, TEXTURE_DIFFUSE);
+		shader->setInt("material.specular"_u, TEXTURE_SPECULAR);
+		shader->setFloat("material.shininess"_u, 32.0f);
+
+		shader->setVec3("directionalLight.direction"_u, -0.2f, -1.0f, -0.3f);
+		shader->setVec3("directionalLight.ambient"_u, 0.05f, 0.05f, 0.05f);
+		shader->setVec3("directionalLight.diffuse"_u, 0.4f, 0.4f, 0.4f);
+		shader->setVec3("directionalLight.specular"_u, 0.5f, 0.5f, 0.5f);
+
+		// The orbit generator rather than rand(), whose sequence differs between C runtimes, so a
+		// seed is the same workload on every platform
+		OrbitRandom random;
+		initOrbitRandom(random, context.seed);
+		char name[64];
+		for (u32 i = 0; i < BENCHMARK_POINT_LIGHTS; i++)
 		{
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			float angle = radians(i * 360.0f / BENCHMARK_POINT_LIGHTS);
+			vec3 color;
+			color.r = randomOrbitFloat(random, 0.2f, 1.0f);
+			color.g = randomOrbitFloat(random, 0.2f, 1.0f);
+			color.b = randomOrbitFloat(random, 0.2f, 1.0f);
+			float height = randomOrbitFloat(random, 4.0f, 14.0f);
+			snprintf(name, sizeof(name), "pointLights[%u].position", i);
+			shader->setVec3(UniformName(name), vec3(sin(angle) * 25.0f, height, cos(angle) * 25.0f));
+			snprintf(name, sizeof(name), "pointLights[%u].ambient", i);
+			shader->setVec3(UniformName(name), color * 0.05f);
+			snprintf(name, sizeof(name), "pointLights[%u].diffuse", i);
+			shader->setVec3(UniformName(name), color);
+			snprintf(name, sizeof(name), "pointLights[%u].specular", i);
+			shader->setVec3(UniformName(name), vec3(1.0f));
+			snprintf(name, sizeof(name), "pointLights[%u].constant", i);
+			shader->setFloat(UniformName(name), 1.0f);
+			snprintf(name, sizeof(name), "pointLights[%u].linear", i);
+			shader->setFloat(UniformName(name), 0.09f);
+			snprintf(name, sizeof(name), "pointLights[%u].quadratic", i);
+			shader->setFloat(UniformName(name), 0.032f);
 		}
 
-		for (u32 i = 0; i < node->mNumChildren; i++)
-		{
-			processNode(node->mChildren[i], scene);
-		}
+		shader->setVec3("spotlight.ambient"_u, 0.0f, 0.0f, 0.0f);
+		shader->setVec3("spotlight.diffuse"_u, 1.0f, 1.0f, 1.0f);
+		shader->setVec3("spotlight.specular"_u, 1.0f, 1.0f, 1.0f);
+		shader->setFloat("spotlight.constant"_u, 1.0f);
+		shader->setFloat("spotlight.linear"_u, 0.09f);
+		shader->setFloat("spotlight.quadratic"_u, 0.032f);
+		shader->setFloat("spotlight.cutOff"_u, cos(radians(12.5f)));
+		shader->setFloat("spotlight.outerCutOff"_u, cos(radians(15.0f)));
 	}
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+	const u32 gridSide = manyLights ? BENCHMARK_LIGHTS_GRID_SIDE : BENCHMARK_GRID_SIDE;
+	const float spacing = 10.0f;
+	const vec3 center(0.0f, 8.0f, 0.0f);
+	const float farPlane = 1000.0f;
+	const mat4 proj = perspective(radians(45.0f), ASPECT_RATIO, 0.1f, farPlane);
+
+	RenderCommandBuffer commands;
+	RenderQueue queue;
+	reserveBenchmarkCommands(commands, queue, gridSide * gridSide * u32(nanosuit.meshes.size()));
+	RenderPacket suitPacket;
+	initRenderPacket(suitPacket);
+	suitPacket.program = shader->program;
+	suitPacket.worldProgram = shader->program;
+	suitPacket.worldLocation = world.location;
+	suitPacket.gpuPass = addGpuPass(g_GpuProfiler, "nanosuits");
+
+	runBenchmarkFrames(context, result, [&](u32 frame, BenchmarkFrameCounters& counters)
 	{
-		vector<Vertex> vertices;
-		vector<u32> indices;
-		vector<Texture> textures;
-
-		for (u32 i = 0; i < mesh->mNumVertices; i++)
+		vec3 eye;
+		mat4 view = getBenchmarkOrbitView(center, gridSide * spacing, 25.0f, frame, eye);
+		bindFrameUniforms(view, proj, eye, frame / 60.0f);
+		shader->setMat4("view"_u, view);
+		shader->setMat4("proj"_u, proj);
+		if (manyLights)
 		{
-			Vertex vertex;
-			vec3 vector;
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.position = vector;
-
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.normal = vector;
+			shader->setVec3("viewPosition"_u, eye);
+			shader->setVec3("spotlight.position"_u, eye);
+			shader->setVec3("spotlight.direction"_u, normalize(center - eye));
+		}
 
-			if (mesh->mTextureCoords[0])
-			{
-				vec2 texCoord;
-				texCoord.x = mesh->mTextureCoords[0][i].x;
-				texCoord.y = mesh->mTextureCoords[0][i].y;
-				vertex.texCoord = texCoord;
-			}
-			else
+		resetRenderCommandBuffer(commands);
+		for (u32 z = 0; z < gridSide; z++)
+		{
+			for (u32 x = 0; x < gridSide; x++)
 			{
-				vertex.texCoord = vec2(0.0f, 0.0f);
+				vec3 position((x - (gridSide - 1) * 0.5f) * spacing, 0.0f, (z - (gridSide - 1) * 0.5f) * spacing);
+				suitPacket.world = translate(mat4(1.0f), position);
+				recordModelPackets(commands, nanosuit, suitPacket, RENDER_PASS_WORLD, length(position - eye) / farPlane);
 			}
-
-			vector.x = mesh->mTangents[i].x;
-			vector.y = mesh->mTangents[i].y;
-			vector.z = mesh->mTangents[i].z;
-			vertex.tangent = vector;
-
-			vector.x = mesh->mBitangents[i].x;
-			vector.y = mesh->mBitangents[i].y;
-			vector.z = mesh->mBitangents[i].z;
-			vertex.bitangent = vector;
-
-			vertices.push_back(vertex);
 		}
+		submitBenchmarkCommands(commands, queue, counters);
+	});
+	destroyModel(nanosuit);
+}
 
-		for (u32 i = 0; i < mesh->mNumFaces; i++)
+// BENCHMARK_TEXTURED_ROCKS rocks in a grid, each a packet of its own with one of
+// BENCHMARK_TEXTURE_COUNT mipmapped textures. The render queue sorts them by texture, so the
+// frame still switches textures BENCHMARK_TEXTURE_COUNT times per rock mesh.
+void runTextureBenchmark(const BenchmarkContext& context, BenchmarkResult& result)
+{
+	double loadStart = getElapsedSeconds();
+	u32 textures[BENCHMARK_TEXTURE_COUNT];
+	glGenTextures(BENCHMARK_TEXTURE_COUNT, textures);
+	u32 memoryAsset = getMemoryAsset(g_MemoryTracker, "texture_heavy textures");
+	vector<u32> pixels(BENCHMARK_TEXTURE_SIZE * BENCHMARK_TEXTURE_SIZE);
+	u32 state = u32(context.seed) | 1;
+	for (u32 i = 0; i < BENCHMARK_TEXTURE_COUNT; i++)
+	{
+		// A checkerboard in a random tint, cheap to make and not flat enough to compress well
+		for (u32 y = 0; y < BENCHMARK_TEXTURE_SIZE; y++)
 		{
-			aiFace face = mesh->mFaces[i];
-			for (u32 j = 0; j < face.mNumIndices; j++)
+			for (u32 x = 0; x < BENCHMARK_TEXTURE_SIZE; x++)
 			{
-				indices.push_back(face.mIndices[j]);
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				u32 checker = ((x >> 4) ^ (y >> 4)) & 1;
+				pixels[y * BENCHMARK_TEXTURE_SIZE + x] = (state & 0x003F3F3F) | (checker ? 0xFFC0C0C0 : 0xFF404040);
 			}
 		}
-
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-		// 1. Diffuse maps
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		// 2. Specular maps
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		// 3. Normal maps
-		vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		// 4. Height maps
-		vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-		return Mesh(vertices, indices, textures);
+		setGLTexture(g_GLState, 0, GL_TEXTURE_2D, textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		trackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, textures[i], memoryAsset, MEMORY_TEXTURE, getTextureBytes(GL_RGBA8, BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE, 1, getMipCount(BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE)));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	}
 
-	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+	const u32 gridSide = 32;
+	const float spacing = 6.0f;
+	vector<mat4> matrices(BENCHMARK_TEXTURED_ROCKS);
+	for (u32 i = 0; i < BENCHMARK_TEXTURED_ROCKS; i++)
 	{
-		vector<Texture> textures;
-		for (u32 i = 0; i < mat->GetTextureCount(type); i++)
-		{
-			aiString str;
-			mat->GetTexture(type, i, &str);
-			bool skip = false;
-			for (u32 j = 0; j < loadedTextures.size(); j++)
-			{
-				if (strcmp(loadedTextures[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(loadedTextures[j]);
-					skip = true;
-					break;
-				}
-			}
+		vec3 position(((i % gridSide) - (gridSide - 1) * 0.5f) * spacing, 0.0f, ((i / gridSide) - (gridSide - 1) * 0.5f) * spacing);
+		matrices[i] = rotate(translate(mat4(1.0f), position), radians(float(i * 37 % 360)), vec3(0.4f, 0.6f, 0.8f));
+	}
+	u32 instanceBuffer = createBuffer(GL_ARRAY_BUFFER, matrices.data(), BENCHMARK_TEXTURED_ROCKS * sizeof(mat4), GL_STATIC_DRAW, memoryAsset, MEMORY_INSTANCE_BUFFER);
+	setupAsteroidVertexArrays(*context.rock, instanceBuffer);
+	result.loadMs = (getElapsedSeconds() - loadStart) * 1000.0;
+	result.gpuBytes = getMemoryAssetBytes(g_MemoryTracker.assets[memoryAsset], false);
+	result.cpuBytes = pixels.size() * sizeof(u32) + BENCHMARK_TEXTURED_ROCKS * sizeof(mat4);
+
+	const Model& rock = *context.rock;
+	const float farPlane = 1000.0f;
+	const mat4 proj = perspective(radians(45.0f), ASPECT_RATIO, 0.1f, farPlane);
+	RenderCommandBuffer commands;
+	RenderQueue queue;
+	reserveBenchmarkCommands(commands, queue, BENCHMARK_TEXTURED_ROCKS * u32(rock.meshes.size()));
+	RenderPacket rockPacket;
+	initRenderPacket(rockPacket);
+	rockPacket.pipeline = context.asteroidPrograms->asteroidPipelines[0]->pipeline;
+	rockPacket.indexed = true;
+	rockPacket.gpuPass = addGpuPass(g_GpuProfiler, "textured rocks");
+
+	runBenchmarkFrames(context, result, [&](u32 frame, BenchmarkFrameCounters& counters)
+	{
+		vec3 eye;
+		mat4 view = getBenchmarkOrbitView(vec3(0.0f), gridSide * spacing * 0.6f, 60.0f, frame, eye);
+		bindFrameUniforms(view, proj, eye, frame / 60.0f);
 
-			if (!skip)
+		resetRenderCommandBuffer(commands);
+		for (u32 i = 0; i < BENCHMARK_TEXTURED_ROCKS; i++)
+		{
+			u32 texture = textures[i % BENCHMARK_TEXTURE_COUNT];
+			float depth = length(vec3(matrices[i][3]) - eye) / farPlane;
+			for (const Mesh& mesh : rock.meshes)
 			{
-				Texture texture;
-				texture.id = textureFromFile(str.C_Str());
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				loadedTextures.push_back(texture);
+				RenderPacket packet = rockPacket;
+				packet.vertexArray = mesh.vertexArray;
+				addRenderPacketTexture(packet, GL_TEXTURE_2D, texture);
+				addRenderPacketVertexBuffer(packet, ASTEROID_MATRIX_BINDING, instanceBuffer, i * sizeof(mat4), sizeof(mat4));
+				packet.elementCount = u32(mesh.indices.size());
+				recordRenderPacket(commands, packet, makeRenderKey(commands, RENDER_PASS_WORLD, false, packet, texture, depth));
 			}
 		}
+		submitBenchmarkCommands(commands, queue, counters);
+	});
 
-		return textures;
+	untrackMemory(g_MemoryTracker, MEMORY_OBJECT_BUFFER, instanceBuffer);
+	deleteGLBuffer(g_GLState, instanceBuffer);
+
+	for (u32 i = 0; i < BENCHMARK_TEXTURE_COUNT; i++)
+	{
+		untrackMemory(g_MemoryTracker, MEMORY_OBJECT_TEXTURE, textures[i]);
 	}
+	deleteGLTextures(g_GLState, BENCHMARK_TEXTURE_COUNT, textures);
+}
 
-	u32 textureFromFile(const char* textureName)
+// Loading every model and building every program of the scenarios from scratch, no frames.
+// Programs still come from the binary cache when it has them.
+void runLoadBenchmark(BenchmarkResult& result)
+{
+	double loadStart = getElapsedSeconds();
+	Model planet("models/planet/planet.obj");
+	Model rock("models/rock/rock.obj");
+	Model nanosuit("models/nanosuit/nanosuit.obj");
+
+	ShaderVariantCache shaderVariants;
+	initShaderVariantCache(shaderVariants);
+	const char* programs[][2] =
 	{
-		string texturePath = directory + '/' + textureName;
-		u32 texture;
-		const u32 textureType = GL_TEXTURE_2D;
-		// TEXTURE 1
-		glGenTextures(1, &texture);
-		
-		int width, height, channelCount;
-		stbi_set_flip_vertically_on_load(true);
+		{ "nanosuit.vert.glsl", "nanosuit.frag.glsl" },
+		{ "phong.vert.glsl", "phong_all_lights.frag.glsl" },
+		{ "impostor.vert.glsl", "impostor.frag.glsl" },
+	};
+	for (u32 i = 0; i < ARRAYSIZE(programs); i++)
+	{
+		ShaderNames names;
+		initShaderNames(&names);
+		strcpy(names.value[VERTEX_SHADER], programs[i][0]);
+		strcpy(names.value[FRAGMENT_SHADER], programs[i][1]);
+		getShaderVariant(shaderVariants, names, nullptr);
+	}
+	glFinish();
+	result.loadMs = (getElapsedSeconds() - loadStart) * 1000.0;
 
-		u8* data = stbi_load(texturePath.c_str(), &width, &height, &channelCount, 0);
-		assert(data);
+	Model* models[] = { &planet, &rock, &nanosuit };
+	for (Model* model : models)
+	{
+		u64 cpuBytes;
+		result.gpuBytes += getModelGpuBytes(*model, &cpuBytes);
+		result.cpuBytes += cpuBytes;
+		destroyModel(*model);
+	}
+	destroyShaderVariantCache(shaderVariants);
+}
 
-		u32 format = 0;
-		switch (channelCount)
+// Runs the scenarios whose bit is set in scenarioMask and writes their results to outputPath,
+// stdout when it's nullptr
+void runBenchmarkSuite(const BenchmarkContext& context, u32 scenarioMask, const char* outputPath)
+{
+	// The frame times are the renderer's, not the display's
+	if (!context.headless)
+	{
+		glfwSwapInterval(0);
+	}
+
+	vector<BenchmarkResult> results;
+	for (u32 scenario = 0; scenario < BENCHMARK_SCENARIO_COUNT; scenario++)
+	{
+		if (!(scenarioMask & (1u << scenario)))
 		{
-			case (1):
+			continue;
+		}
+
+		BenchmarkResult result;
+		initBenchmarkResult(result, g_BenchmarkScenarioNames[scenario]);
+		switch (scenario)
+		{
+			case (BENCHMARK_ASTEROIDS_10K):
 			{
-				format = GL_RED;
+				runAsteroidBenchmark(context, 10000, result);
 			} break;
-			case (3):
+			case (BENCHMARK_ASTEROIDS_100K):
 			{
-				format = GL_RGB;
+				runAsteroidBenchmark(context, 100000, result);
 			} break;
-			case (4):
+			case (BENCHMARK_ASTEROIDS_1M):
 			{
-				format = GL_RGBA;
+				runAsteroidBenchmark(context, 1000000, result);
 			} break;
-			default:
+			case (BENCHMARK_ASTEROIDS_10M):
 			{
-				format = 0;
-				assert(channelCount != 3 && !(channelCount > 4) && "Error: Format not supported");
+				runAsteroidBenchmark(context, 10000000, result);
+			} break;
+			case (BENCHMARK_NANOSUIT_GRID):
+			{
+				runNanosuitBenchmark(context, false, result);
+			} break;
+			case (BENCHMARK_MANY_LIGHTS):
+			{
+				runNanosuitBenchmark(context, true, result);
+			} break;
+			case (BENCHMARK_TEXTURE_HEAVY):
+			{
+				runTextureBenchmark(context, result);
+			} break;
+			case (BENCHMARK_LOAD_ONLY):
+			{
+				runLoadBenchmark(result);
 			} break;
 		}
-
-		glBindTexture(textureType, texture);
-
-		glTexImage2D(textureType, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(textureType, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(textureType, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-
-		return texture;
-	}
-
-	void load(string const& path)
-	{
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-
-		assert(scene && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) && (scene->mRootNode));
-
-		directory = path.substr(0, path.find_last_of('/'));
-
-		processNode(scene->mRootNode, scene);
+		printf("%-16s frame %.3f ms (p99 %.3f), cpu %.3f ms, gpu %.3f ms, load %.1f ms\n", result.name,
+			result.frameMs.meanMs, result.frameMs.p99Ms, result.cpuMs.meanMs, result.gpuMs.meanMs, result.loadMs);
+		results.push_back(result);
 	}
 
-	void draw(const Shader& shader)
+	FILE* file = outputPath ? fopen(outputPath, "w") : stdout;
+	if (!file)
 	{
-		for (Mesh& mesh : meshes)
-		{
-			mesh.draw(shader);
-		}
+		printf("Can't open \"%s\" for the benchmark results, writing them here instead\n", outputPath);
+		file = stdout;
 	}
-};
-
-int queryMaxNAttributes()
-{
-	// query for n of attributes
-	int numberOfAttributes;
-	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numberOfAttributes);
-	printf("MAXIMUM NUMBER OF ATTRIBUTES SUPPORTED: %d\n", numberOfAttributes);
-	return numberOfAttributes;
-}
-
-u32 createBuffer(u32 bufferType, const void* data, size_t dataSize, u32 usage)
-{
-	u32 buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(bufferType, buffer);
-	glBufferData(bufferType, dataSize, data, usage);
-
-	return buffer;
-}
-
-u32 createVertexArray()
-{
-	u32 vertexArray;
-	glGenVertexArrays(1, &vertexArray);
-
-	return vertexArray;
-}
-
-struct VertexFeature
-{
-	u32 elementCount;
-	u32 elementSize;
-	u32 elementType;
-	bool32 normalized = false;
-};
-
-void setAttributes(const VertexFeature* vertexFeatures, size_t vertexFeatureCount, size_t vertexSize)
-{
-#ifdef _DEBUG
-	size_t sizeCount = 0;
-	for (u32 i = 0; i < vertexFeatureCount; i++)
+	writeBenchmarkResults(file, (const char*)glGetString(GL_RENDERER), results);
+	if (file != stdout)
 	{
-		VertexFeature const& feature = vertexFeatures[i];
-		sizeCount += feature.elementCount * feature.elementSize;
+		fclose(file);
 	}
-	size_t sizeOfVertex = sizeof(Vertex);
-	if (sizeOfVertex != sizeCount)
+}
+
+// An aiMesh shaped like what the importer hands processMesh(): a grid of vertices with every
+// attribute filled in, two triangles per cell
+void createMicroBenchMesh(aiMesh& mesh, u32 gridSize)
+{
+	mesh.mNumVertices = gridSize * gridSize;
+	mesh.mVertices = new aiVector3D[mesh.mNumVertices];
+	mesh.mNormals = new aiVector3D[mesh.mNumVertices];
+	mesh.mTangents = new aiVector3D[mesh.mNumVertices];
+	mesh.mBitangents = new aiVector3D[mesh.mNumVertices];
+	mesh.mTextureCoords[0] = new aiVector3D[mesh.mNumVertices];
+	mesh.mNumUVComponents[0] = 2;
+	for (u32 y = 0; y < gridSize; y++)
 	{
-		assert(!"Vertex sizes differ. Check padding and vertex layout, maybe a bug made of copypasta origins");
+		for (u32 x = 0; x < gridSize; x++)
+		{
+			u32 i = y * gridSize + x;
+			mesh.mVertices[i] = aiVector3D(float(x), 0.0f, float(y));
+			mesh.mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+			mesh.mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+			mesh.mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+			mesh.mTextureCoords[0][i] = aiVector3D(float(x) / gridSize, float(y) / gridSize, 0.0f);
+		}
 	}
-	assert(sizeCount == sizeof(Vertex));
-#endif
 
-	u64 stride = 0;
-	for (u32 i = 0; i < vertexFeatureCount; i++)
+	mesh.mNumFaces = (gridSize - 1) * (gridSize - 1) * 2;
+	mesh.mFaces = new aiFace[mesh.mNumFaces];
+	u32 face = 0;
+	for (u32 y = 0; y + 1 < gridSize; y++)
 	{
-		VertexFeature const& feature = vertexFeatures[i];
-		glVertexAttribPointer(i, feature.elementCount, feature.elementType, feature.normalized, (GLsizei)vertexSize, (void*)(stride));
-		glEnableVertexAttribArray(i);
-		stride += feature.elementCount * feature.elementSize;
+		for (u32 x = 0; x + 1 < gridSize; x++)
+		{
+			u32 corner = y * gridSize + x;
+			const u32 triangles[2][3] = { { corner, corner + gridSize, corner + 1 }, { corner + 1, corner + gridSize, corner + gridSize + 1 } };
+			for (u32 t = 0; t < 2; t++)
+			{
+				aiFace& triangle = mesh.mFaces[face++];
+				triangle.mNumIndices = 3;
+				triangle.mIndices = new unsigned int[3];
+				memcpy(triangle.mIndices, triangles[t], sizeof(triangles[t]));
+			}
+		}
 	}
 }
 
-u32 createTexture(const char* texturePath)
+bool32 readBinaryFile(const char* path, vector<u8>& bytes)
 {
-	u32 texture;
-	const u32 textureType = GL_TEXTURE_2D;
-	// TEXTURE 1
-	glGenTextures(1, &texture);
-	glBindTexture(textureType, texture);
-	
-	glTexParameteri(textureType, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(textureType, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	
-	glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bytes.resize(size_t(length));
+	size_t rc = fread(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+	return rc == bytes.size();
+}
 
-	int width, height, channelCount;
-	stbi_set_flip_vertically_on_load(true);
+// Runs every micro-benchmark whose name contains filter (nullptr for all) and returns how many ran
+u32 runMicroBenchmarks(const char* filter)
+{
+	MicroBench bench;
+	initMicroBench(bench, filter);
 
-	u8* data = stbi_load(texturePath, &width, &height, &channelCount, 0);
-	assert(data);
+	const u32 meshGridSizes[] = { 32, 128, 512 };
+	const char* const meshSizeLabels[] = { "1k", "16k", "256k" };
+	for (u32 size = 0; size < ARRAYSIZE(meshGridSizes) && isMicroBenchEnabled(bench, "vertex_convert"); size++)
+	{
+		aiMesh mesh;
+		createMicroBenchMesh(mesh, meshGridSizes[size]);
+		vector<Vertex> vertices;
+		vector<u32> indices;
+		runMicroBench(bench, "vertex_convert", meshSizeLabels[size], mesh.mNumVertices, u64(mesh.mNumVertices) * sizeof(Vertex) + u64(mesh.mNumFaces) * 3 * sizeof(u32), [&]()
+		{
+			vertices.clear();
+			indices.clear();
+			convertMeshGeometry(&mesh, vertices, indices);
+			g_MicroBenchSink += vertices.size() + indices.back();
+		});
+	}
 
-	u32 format;
-	switch (channelCount)
+	// One image per format stb_image decodes for the renderer, the size label is the format.
+	// Throughput is in decoded pixels and bytes
+	const char* const imagePaths[] = { "container.jpg", "marble.jpg", "container2.png", "awesomeface.png", "metal.png" };
+	for (u32 image = 0; image < ARRAYSIZE(imagePaths) && isMicroBenchEnabled(bench, "image_decode"); image++)
 	{
-		case (1):
+		vector<u8> encoded;
+		int width, height, channelCount;
+		if (!readBinaryFile(imagePaths[image], encoded) || !stbi_info_from_memory(encoded.data(), int(encoded.size()), &width, &height, &channelCount))
 		{
-			format = GL_RED;
-		} break;
-		case (3):
+			printf("%-20s %-10s can't read %s\n", "image_decode", "", imagePaths[image]);
+			continue;
+		}
+
+		char sizeLabel[32];
+		snprintf(sizeLabel, sizeof(sizeLabel), "%s %dc", strrchr(imagePaths[image], '.') + 1, channelCount);
+		u64 pixelCount = u64(width) * u64(height);
+		runMicroBench(bench, "image_decode", sizeLabel, pixelCount, pixelCount * channelCount, [&]()
 		{
-			format = GL_RGB;
-		} break;
-		case (4):
+			int decodedWidth, decodedHeight, decodedChannels;
+			u8* data = stbi_load_from_memory(encoded.data(), int(encoded.size()), &decodedWidth, &decodedHeight, &decodedChannels, 0);
+			assert(data);
+			g_MicroBenchSink += data[0];
+			stbi_image_free(data);
+		});
+	}
+
+	const u32 mipSizes[] = { 256, 1024, 2048 };
+	const char* const mipSizeLabels[] = { "256^2", "1024^2", "2048^2" };
+	for (u32 size = 0; size < ARRAYSIZE(mipSizes) && isMicroBenchEnabled(bench, "mip_generate"); size++)
+	{
+		u32 dimension = mipSizes[size];
+		vector<u8> pixels(size_t(dimension) * dimension * 4);
+		for (size_t i = 0; i < pixels.size(); i++)
 		{
-			format = GL_RGBA;
-		} break;
-		default:
+			pixels[i] = u8(i * 2654435761u >> 24);
+		}
+		vector<u8> mips;
+		u64 pixelCount = u64(dimension) * dimension;
+		runMicroBench(bench, "mip_generate", mipSizeLabels[size], pixelCount, pixelCount * 4, [&]()
 		{
-			assert(channelCount != 3 && !(channelCount > 4) && "Error: Format not supported");
-		} break;
+			generateMipChainRGBA8(pixels.data(), dimension, dimension, mips);
+			g_MicroBenchSink += mips.back();
+		});
 	}
 
-	glTexImage2D(textureType, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	// The matrix kernels all work on the same fields, one per size
+	const u32 instanceCounts[] = { 1000, 16000, 256000 };
+	const char* const instanceSizeLabels[] = { "1k", "16k", "256k" };
+	mat4 proj = perspective(radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	mat4 view = lookAt(vec3(0.0f, 20.0f, 200.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+	mat4 viewProj = proj * view;
+	for (u32 size = 0; size < ARRAYSIZE(instanceCounts); size++)
+	{
+		u32 count = instanceCounts[size];
+		vector<mat4> matrices(count);
+		vector<mat4> results(count);
+		vector<u8> visibility(count);
 
-	stbi_image_free(data);
+		runMicroBench(bench, "asteroid_transforms", instanceSizeLabels[size], count, u64(count) * sizeof(mat4), [&]()
+		{
+			srand(1234);
+			generateAsteroidField(matrices.data(), count);
+			g_MicroBenchSink += u64(matrices[count - 1][3][0]);
+		});
+
+		srand(1234);
+		generateAsteroidField(matrices.data(), count);
+		runMicroBench(bench, "frustum_cull", instanceSizeLabels[size], count, u64(count) * sizeof(mat4), [&]()
+		{
+			u32 visibleCount = 0;
+			for (u32 i = 0; i < count; i++)
+			{
+				visibility[i] = !isAABBOutsideFrustum(viewProj * matrices[i], vec3(-1.0f), vec3(1.0f));
+				visibleCount += visibility[i];
+			}
+			g_MicroBenchSink += visibleCount;
+		});
 
-	return texture;
+		runMicroBench(bench, "matrix_multiply", instanceSizeLabels[size], count, u64(count) * sizeof(mat4) * 2, [&]()
+		{
+			for (u32 i = 0; i < count; i++)
+			{
+				results[i] = viewProj * matrices[i];
+			}
+			g_MicroBenchSink += u64(results[count - 1][3][3]);
+		});
+	}
+
+	return bench.caseCount;
 }
 
 int main(int argc, char** argv)
 {
+	bool32 sortBenchmark = false;
+	bool32 headless = false;
+	bool32 headlessEgl = false;
+	u32 headlessWarmupFrames = 60;
+	u32 headlessFrames = 600;
+	const char* statsJsonPath = nullptr;
+	u32 benchmarkScenarios = 0;
+	const char* benchmarkJsonPath = nullptr;
+	const char* compareBaselinePath = nullptr;
+	const char* compareRunPath = nullptr;
+	bool32 microBenchmarks = false;
+	bool32 occlusionTest = false;
+	const char* microBenchmarkFilter = nullptr;
+	double compareThreshold = BENCHMARK_DEFAULT_THRESHOLD;
+	u32 asteroidCount = 100000;
+	u64 orbitSeed = 1234;
+	const char* gpuProfileCsv = nullptr;
+	double hitchThresholdMs = FRAME_STATS_DEFAULT_HITCH_MS;
+	bool32 glIntercept = false;
+	bool32 memoryReport = false;
+	bool32 allocReport = false;
+	bool32 allocStacks = false;
+	bool32 allocAssert = false;
+	u32 allocWarmupFrames = 120;
+	const char* cpuTracePath = nullptr;
+	u32 cpuTraceFirstFrame = 0;
+	u32 cpuTraceFrameCount = 300;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bench-sort") == 0)
+		{
+			sortBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--asteroids") == 0 && i + 1 < argc)
+		{
+			asteroidCount = u32(atoi(argv[++i]));
+			assert(asteroidCount > 0);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			orbitSeed = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--headless-api") == 0 && i + 1 < argc)
+		{
+			// osmesa (the default) or egl
+			headlessEgl = strcmp(argv[++i], "egl") == 0;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			headlessFrames = u32(atoi(argv[++i]));
+			assert(headlessFrames > 0);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+		{
+			headlessWarmupFrames = u32(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc)
+		{
+			statsJsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+		{
+			// A scenario name or "all", may be repeated
+			const char* name = argv[++i];
+			if (strcmp(name, "all") == 0)
+			{
+				benchmarkScenarios = (1u << BENCHMARK_SCENARIO_COUNT) - 1;
+			}
+			else
+			{
+				u32 scenario = findBenchmarkScenario(name);
+				if (scenario == BENCHMARK_SCENARIO_COUNT)
+				{
+					printf("Unknown benchmark scenario \"%s\"\n", name);
+				}
+				assert(scenario != BENCHMARK_SCENARIO_COUNT);
+				benchmarkScenarios |= 1u << scenario;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-json") == 0 && i + 1 < argc)
+		{
+			benchmarkJsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc)
+		{
+			compareBaselinePath = argv[++i];
+			compareRunPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--micro-bench") == 0)
+		{
+			// Optionally followed by a kernel name filter
+			microBenchmarks = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				microBenchmarkFilter = argv[++i];
+			}
+		}
+		else if (strcmp(argv[i], "--occlusion-test") == 0)
+		{
+			occlusionTest = true;
+		}
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+		{
+			compareThreshold = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--gpu-csv") == 0 && i + 1 < argc)
+		{
+			gpuProfileCsv = argv[++i];
+		}
+		else if (strcmp(argv[i], "--memory-report") == 0)
+		{
+			// The V key dumps it any time, this is for runs without a keyboard
+			memoryReport = true;
+		}
+		else if (strcmp(argv[i], "--gl-intercept") == 0)
+		{
+			glIntercept = true;
+		}
+		else if (strcmp(argv[i], "--alloc-track") == 0)
+		{
+			allocReport = true;
+		}
+		else if (strcmp(argv[i], "--alloc-stacks") == 0)
+		{
+			allocStacks = true;
+		}
+		else if (strcmp(argv[i], "--alloc-assert") == 0)
+		{
+			allocAssert = true;
+		}
+		else if (strcmp(argv[i], "--alloc-warmup") == 0 && i + 1 < argc)
+		{
+			// Frames after the shader builds before a frame that allocates counts as one too many
+			allocWarmupFrames = u32(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc)
+		{
+			hitchThresholdMs = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--cpu-trace") == 0 && i + 1 < argc)
+		{
+			cpuTracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--cpu-trace-frames") == 0 && i + 2 < argc)
+		{
+			cpuTraceFirstFrame = u32(atoi(argv[++i]));
+			cpuTraceFrameCount = u32(atoi(argv[++i]));
+		}
+	}
+	initCpuProfiler(g_CpuProfiler, cpuTracePath, cpuTraceFirstFrame, cpuTraceFrameCount);
+	initFrameStats(g_FrameStats, hitchThresholdMs, g_CpuProfiler.originNs);
+	initMemoryTracker(g_MemoryTracker);
+	initAllocTracker(g_AllocTracker, allocReport, allocStacks, allocAssert);
+
+	// Needs no window, the exit code tells CI whether anything regressed
+	if (compareBaselinePath)
+	{
+		vector<BenchmarkResult> baseline;
+		vector<BenchmarkResult> run;
+		if (!readBenchmarkResults(compareBaselinePath, baseline) || !readBenchmarkResults(compareRunPath, run))
+		{
+			return 2;
+		}
+		return compareBenchmarkResults(baseline, run, compareThreshold) ? 1 : 0;
+	}
+	// The kernels are all CPU side, so these need no window either
+	if (microBenchmarks)
+	{
+		return runMicroBenchmarks(microBenchmarkFilter) ? 0 : 1;
+	}
+	if (occlusionTest)
+	{
+		initJobSystem(g_Jobs);
+		u32 failures = runOcclusionSelfTest(g_OcclusionBuffer, g_Jobs);
+		destroyJobSystem(g_Jobs);
+		return failures ? 1 : 0;
+	}
+
 	initCamera(g_Camera, vec3(0.0f, 0.0f, 55.0f));
 	g_MouseLastPosition.lastX = width / 2.0f;
 	g_MouseLastPosition.lastY = height/ 2.0f;
 	vec3 lightPosition(1.2f, 1.0f, 2.0f);
 	const char* title = "LearnOpenGL";
 
-	int glfwInitialization = glfwInit();
-	assert(glfwInitialization);
-
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	GLFWwindow* window = glfwCreateWindow(width, height, title, nullptr, nullptr);
-	assert(window);
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-	glfwSetCursorPosCallback(window, mouseCallback);
-	glfwSetScrollCallback(window, scrollCallback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	// Headless runs have no window and never touch GLFW, which would need a display server, see
+	// headless_context.h. Rendering goes to an FBO.
+	GLFWwindow* window = nullptr;
+	HeadlessContext headlessContext = {};
+	GLADloadproc getProcAddress = (GLADloadproc)glfwGetProcAddress;
+	if (headless)
+	{
+		if (!createHeadlessContext(headlessContext, headlessEgl, width, height))
+		{
+			printf("Can't create a headless %s context\n", headlessEgl ? "EGL" : "OSMesa");
+			return 1;
+		}
+		getProcAddress = headlessContext.getProcAddress;
+	}
+	else
+	{
+		int glfwInitialization = glfwInit();
+		assert(glfwInitialization);
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+		assert(window);
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+		glfwSetCursorPosCallback(window, mouseCallback);
+		glfwSetScrollCallback(window, scrollCallback);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
-	int gladInitialization = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	int gladInitialization = gladLoadGLLoader(getProcAddress);
 	assert(gladInitialization);
-	
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	
-	ShaderNames shaderNames;
-	initShaderNames(&shaderNames);
-	strcpy(shaderNames.value[0], "asteroid.vert.glsl");
-	strcpy(shaderNames.value[1], "asteroid.frag.glsl");
-	Shader asteroidShader(shaderNames);
-
-	ShaderNames shaderNames2;
-	initShaderNames(&shaderNames2);
-	strcpy(shaderNames2.value[0], "planet.vert.glsl");
-	strcpy(shaderNames2.value[1], "planet.frag.glsl");
-	Shader planetShader(shaderNames2);
+	if (glIntercept)
+	{
+		installGLIntercept(g_GLIntercept);
+	}
+	initGLState(g_GLState);
 
-	Model planet("models/planet/planet.obj");
-	Model rock("models/rock/rock.obj");
+	HeadlessTarget headlessTarget = {};
+	u32 mainFramebuffer = 0;
+	if (headless)
+	{
+		headlessTarget = createHeadlessTarget(width, height);
+		mainFramebuffer = headlessTarget.framebuffer;
+		setGLViewport(g_GLState, 0, 0, width, height);
+		printf("Headless on %s, %u + %u frames\n", (const char*)glGetString(GL_RENDERER), headlessWarmupFrames, headlessFrames);
+	}
+	
+	// Blending is switched on by the render queue for transparent packets only
+	setGLCapability(g_GLState, GL_DEPTH_TEST, true);
+	setGLCapability(g_GLState, GL_BLEND, false);
+	setGLBlendFunc(g_GLState, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	const u32 asteroidCount = 100000;
-	mat4* modelMatrices = new mat4[asteroidCount];
-	srand(glfwGetTime());
+	initProgramCache(g_ProgramCache);
 
-	float radius = 150.0f;
-	float offset = 25.0f;
+	ShaderVariantCache shaderVariants;
+	initShaderVariantCache(shaderVariants);
+	ShaderPipelineCache shaderPipelines;
+	initShaderPipelineCache(shaderPipelines);
 
-	for (u32 i = 0; i < asteroidCount; i++)
-	{
-		mat4 world = mat4(1.0f);
-		float angle = float(i) / float(asteroidCount) * 360.0f;
-		float displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
-		float x = glm::sin(angle) * radius + displacement;
-		displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
-		float y = displacement * 0.4f;
-		displacement = (rand() % int(2 * offset * 100)) / 100.0f - offset;
-		float z = cos(angle) * radius + displacement;
-		world = translate(world, vec3(x, y, z));
+	// Every program but the fallback ones is only submitted here; the driver builds them while the
+	// models load
+	ShaderBuildQueue shaderBuilds;
+	initShaderBuildQueue(shaderBuilds, shaderVariants);
+	AsteroidScenePrograms asteroidPrograms;
+	submitAsteroidScenePrograms(asteroidPrograms, shaderVariants, shaderBuilds);
 
-		float scaleBy = (rand() % 20) / 100.0f + 0.05f;
-		world = scale(world, vec3(scaleBy));
+	Model planet("models/planet/planet.obj");
+	Model rock("models/rock/rock.obj");
 
-		float rotationAngle = (rand() % 360);
-		world = rotate(world, rotationAngle, vec3(0.4f, 0.6f, 0.8f));
+	initJobSystem(g_Jobs);
+	initBarrierTracker(g_Barriers);
+	initGpuProfiler(g_GpuProfiler, gpuProfileCsv);
 
-		modelMatrices[i] = world;
+	if (benchmarkScenarios)
+	{
+		finishShaderBuilds(shaderBuilds);
+		resolveAsteroidScenePrograms(asteroidPrograms, shaderPipelines);
+		// Only the frame uniforms until a scenario needs more
+		initFrameRing(getAsteroidSceneFrameBytes(0));
+		BenchmarkContext benchmark;
+		benchmark.window = window;
+		benchmark.headless = headless;
+		benchmark.headlessTarget = &headlessTarget;
+		benchmark.framebuffer = mainFramebuffer;
+		benchmark.warmupFrames = headlessWarmupFrames;
+		benchmark.frameCount = headlessFrames;
+		benchmark.seed = orbitSeed;
+		benchmark.planet = &planet;
+		benchmark.rock = &rock;
+		benchmark.asteroidPrograms = &asteroidPrograms;
+		benchmark.shaderBuilds = &shaderBuilds;
+		benchmark.shaderVariants = &shaderVariants;
+		runBenchmarkSuite(benchmark, benchmarkScenarios, benchmarkJsonPath);
+
+		destroyModel(rock);
+		destroyModel(planet);
+		destroyShaderPipelineCache(shaderPipelines);
+		destroyShaderVariantCache(shaderVariants);
+		destroyGpuProfiler(g_GpuProfiler);
+		destroyRingBuffer(g_FrameRing, g_GLState);
+		destroyFrameArena(g_FrameArena);
+		if (headless)
+		{
+			setGLFramebuffer(g_GLState, 0);
+			destroyHeadlessTarget(headlessTarget);
+		}
+		destroyCpuProfiler(g_CpuProfiler);
+		destroyJobSystem(g_Jobs);
+		if (headless)
+		{
+			destroyHeadlessContext(headlessContext);
+		}
+		else
+		{
+			glfwTerminate();
+		}
+		return 0;
 	}
 
-	u32 instanceBuffer;
-	glGenBuffers(1, &instanceBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
-	glBufferData(GL_ARRAY_BUFFER, asteroidCount * sizeof(mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-	for (u32 i = 0; i < rock.meshes.size(); i++)
+	initFrameRing(getAsteroidSceneFrameBytes(asteroidCount));
+	AsteroidScene scene;
+	// Benchmarks need the same field every run
+	initAsteroidScene(scene, asteroidPrograms, shaderBuilds, planet, rock, asteroidCount, headless ? 1234 : u32(glfwGetTime()), orbitSeed);
+	float ringReportTime = 0.0f;
+	float stateReportTime = 0.0f;
+	u32 stateReportFrames = 0;
+	u32 renderKeyOverflows = 0;
+	float hudReportTime = 0.0f;
+
+	if (sortBenchmark)
 	{
-		u32 vertexArray = rock.meshes[i].vertexArray;
-		glBindVertexArray(vertexArray);
-
-		const u64 vec4Size = sizeof(vec4);
-		const u64 mat4Size = 4 * vec4Size;
-		u64 strideMultiplier = 0;
-		for (u32 currentVertexAttributeIndex = 3; currentVertexAttributeIndex < 7; currentVertexAttributeIndex++, strideMultiplier++)
+		finishShaderBuilds(shaderBuilds);
+		setGLFramebuffer(g_GLState, mainFramebuffer);
+		runSortBenchmark(window, *getShaderPipeline(shaderPipelines, asteroidPrograms.asteroidVertex, asteroidPrograms.asteroidFragment[0]), rock, scene.instanceBuffer);
+		destroyAsteroidScene(scene);
+		destroyShaderPipelineCache(shaderPipelines);
+		destroyShaderVariantCache(shaderVariants);
+		destroyRingBuffer(g_FrameRing, g_GLState);
+		destroyJobSystem(g_Jobs);
+		if (headless)
 		{
-			glEnableVertexAttribArray(currentVertexAttributeIndex);
-			glVertexAttribPointer(currentVertexAttributeIndex, 4, GL_FLOAT, GL_FALSE, mat4Size, (void*)(strideMultiplier * vec4Size));
+			destroyHeadlessContext(headlessContext);
+		}
+		else
+		{
+			glfwTerminate();
 		}
+		return 0;
+	}
 
-		glVertexAttribDivisor(3, 1);
-		glVertexAttribDivisor(4, 1);
-		glVertexAttribDivisor(5, 1);
-		glVertexAttribDivisor(6, 1);
+	bool32 shaderBuildsPending = true;
+	u32 steadyStateFrame = ~0u;
 
-		glBindVertexArray(0);
-	}
+	// Headless frames are counted once the programs are built, the first ones are warm up
+	u32 headlessFrame = 0;
+	vector<float> headlessFrameMs;
+	headlessFrameMs.reserve(headlessFrames);
+	double headlessFrameStart = 0.0;
 
-	while (!glfwWindowShouldClose(window))
+	while (headless ? headlessFrameMs.size() < headlessFrames : !glfwWindowShouldClose(window))
 	{
-		float currentFrame = float(glfwGetTime());
+		CPU_PROFILER_FRAME();
+		CPU_ZONE("Frame");
+		beginFrameStats(g_FrameStats);
+		advanceGLInterceptFrame(g_GLIntercept);
+		advanceAllocTrackerFrame(g_AllocTracker);
+		resetFrameArena(g_FrameArena);
+		float currentFrame = float(getElapsedSeconds());
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
-		processInput(window);
+		CPU_NAMED_ZONE(inputZone, "Input");
+		if (headless)
+		{
+			// A fixed step, so the orbits end up in the same place however fast the frames run
+			deltaTime = 1.0f / 60.0f;
+			scriptHeadlessCamera(g_Camera, headlessFrame);
+		}
+		else
+		{
+			processInput(window);
+		}
+		CPU_END_ZONE(inputZone);
+
+		setGLFramebuffer(g_GLState, mainFramebuffer);
 
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		setGLClearColor(g_GLState, 0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Frames are drawn with the fallback programs until every program is built, the window
+		// keeps responding meanwhile
+		if (shaderBuildsPending)
+		{
+			CPU_ZONE("Shader builds");
+			markFrameStats(g_FrameStats, "Shader builds");
+			shaderBuildsPending = pollShaderBuilds(shaderBuilds) != 0;
+		}
+		const bool32 useFallback = shaderBuildsPending;
+		if (!useFallback && !asteroidPrograms.resolved)
+		{
+			resolveAsteroidScenePrograms(asteroidPrograms, shaderPipelines);
+			printProgramCacheStats(g_ProgramCache);
+			steadyStateFrame = g_AllocTracker.frameIndex + allocWarmupFrames;
+		}
+		if (g_AllocTracker.frameIndex == steadyStateFrame)
+		{
+			setAllocTrackerSteadyState(g_AllocTracker, true);
+		}
 		
 		// RENDER & UPDATE
 		
 		mat4 proj = perspective(radians(45.0f), ASPECT_RATIO, 0.1f, 1000.0f);
 		mat4 view = getViewMatrix();
-		mat4 worldPlanetMatrix(1.0f);
-		worldPlanetMatrix = translate(worldPlanetMatrix, vec3(0.0f, -3.0f, 0.0f));
-		worldPlanetMatrix = scale(worldPlanetMatrix, vec3(4.0f));
-	
-		planetShader.use();
-		planetShader.setMat4("proj", proj);
-		planetShader.setMat4("view", view);
-		planetShader.setMat4("world", worldPlanetMatrix);
 
-		planet.draw(planetShader);
+		beginGpuProfilerFrame(g_GpuProfiler);
+		collectFrameStatsGpu(g_FrameStats, g_GpuProfiler);
+		CPU_NAMED_ZONE(uniformZone, "Frame uniforms");
+		beginRingFrame(g_FrameRing);
+		bindFrameUniforms(view, proj, g_Camera.position, currentFrame);
+		CPU_END_ZONE(uniformZone);
+
+		AsteroidSceneFrame sceneFrame;
+		sceneFrame.view = view;
+		sceneFrame.proj = proj;
+		sceneFrame.eye = g_Camera.position;
+		sceneFrame.time = currentFrame;
+		sceneFrame.deltaTime = deltaTime;
+		sceneFrame.useFallback = useFallback;
+		sceneFrame.occlusionCulling = occlusionCulling;
+		sceneFrame.frontToBackSorting = frontToBackSorting;
+		sceneFrame.impostors = impostorsEnabled;
+		sceneFrame.orbitalAnimation = orbitalAnimation;
+		renderAsteroidScene(scene, sceneFrame);
+		endGpuProfilerFrame(g_GpuProfiler);
+
+		endRingFrame(g_FrameRing);
+		if (currentFrame - ringReportTime >= 1.0f)
+		{
+			u32 stallCount;
+			u64 peakFrameBytes;
+			double stallMs = takeRingStalls(g_FrameRing, &stallCount, &peakFrameBytes);
+			if (stallCount)
+			{
+				printf("Frame ring: %u stalls, %.3f ms waiting on the GPU, peak frame %.2f MB\n", stallCount, stallMs, peakFrameBytes / (1024.0 * 1024.0));
+			}
+			ringReportTime = currentFrame;
+		}
 
-		asteroidShader.use();
-		asteroidShader.setMat4("proj", proj);
-		asteroidShader.setMat4("view", view);
-		asteroidShader.setInt("texture_diffuse1", 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, rock.loadedTextures[0].id);
+		stateReportFrames++;
+		renderKeyOverflows += scene.renderQueue.keyOverflows;
+		if (currentFrame - stateReportTime >= 1.0f)
+		{
+			u32 filteredCalls;
+			u32 issuedCalls = takeGLStateStats(g_GLState, &filteredCalls);
+			printf("GL state: %.1f calls issued, %.1f filtered per frame\n", float(issuedCalls) / stateReportFrames, float(filteredCalls) / stateReportFrames);
+			if (renderKeyOverflows)
+			{
+				printf("Render queue: %.1f key fields clamped per frame, GL names past the key widths\n", float(renderKeyOverflows) / stateReportFrames);
+				renderKeyOverflows = 0;
+			}
+			takeGLInterceptReport(g_GLIntercept, 8);
+			takeAllocTrackerReport(g_AllocTracker);
+			stateReportTime = currentFrame;
+			stateReportFrames = 0;
+		}
 
-		const u32 rockMeshesSize = rock.meshes.size();
-		for (u32 i = 0; i < rockMeshesSize; i++)
+		if (currentFrame - hudReportTime >= 0.5f)
 		{
-			glBindVertexArray(rock.meshes[i].vertexArray);
-			glDrawElementsInstanced(GL_TRIANGLES, rock.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, asteroidCount);
-			glBindVertexArray(0);
+			char hud[320];
+			FrameHistogramStats frameStats = getFrameHistogramStats(g_FrameStats.histograms[FRAME_STATS_FRAME]);
+			int hudLength = snprintf(hud, sizeof(hud), "Frame p50 %.2f p99 %.2f ms, %u hitches | ", frameStats.p50Ms, frameStats.p99Ms, frameStats.hitchCount);
+			formatGpuProfilerHud(g_GpuProfiler, hud + hudLength, sizeof(hud) - hudLength);
+			if (!headless)
+			{
+				glfwSetWindowTitle(window, hud);
+			}
+			hudReportTime = currentFrame;
 		}
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		CPU_NAMED_ZONE(swapZone, "Swap");
+		beginFrameStatsSwap(g_FrameStats);
+		if (headless && useFallback)
+		{
+			// Not counted, the measured frames all draw the real programs
+			presentHeadlessFrame(headlessTarget);
+		}
+		else if (headless)
+		{
+			presentHeadlessFrame(headlessTarget);
+			double now = getElapsedSeconds();
+			if (headlessFrame == headlessWarmupFrames)
+			{
+				drainGpuProfiler(g_GpuProfiler);
+				resetGpuProfilerTotals(g_GpuProfiler);
+				collectFrameStatsGpu(g_FrameStats, g_GpuProfiler);
+				resetFrameStats(g_FrameStats);
+				now = getElapsedSeconds();
+			}
+			else if (headlessFrame > headlessWarmupFrames)
+			{
+				headlessFrameMs.push_back(float((now - headlessFrameStart) * 1000.0));
+			}
+			headlessFrameStart = now;
+			headlessFrame++;
+		}
+		else
+		{
+			glfwSwapBuffers(window);
+		}
+		endFrameStatsSwap(g_FrameStats);
+		CPU_END_ZONE(swapZone);
+		if (!headless)
+		{
+			CPU_ZONE("Events");
+			glfwPollEvents();
+		}
 	}
 
-	delete[] modelMatrices;
+	drainGpuProfiler(g_GpuProfiler);
+	beginFrameStats(g_FrameStats);
+	collectFrameStatsGpu(g_FrameStats, g_GpuProfiler);
+	printFrameStats(stdout, g_FrameStats);
+	printGLInterceptSummary(g_GLIntercept);
+	printAllocTrackerSummary(g_AllocTracker);
+	if (g_FrameArena.overflowAllocations)
+	{
+		printf("Frame arena: %llu allocations, %.2f MB went to the heap, peak frame %.2f MB\n", (unsigned long long)g_FrameArena.overflowAllocations, g_FrameArena.overflowBytes / (1024.0 * 1024.0), g_FrameArena.peakBytes / (1024.0 * 1024.0));
+	}
+	if (memoryReport)
+	{
+		printMemoryReport(g_MemoryTracker);
+	}
+	if (headless)
+	{
+		FILE* statsFile = statsJsonPath ? fopen(statsJsonPath, "w") : stdout;
+		if (!statsFile)
+		{
+			printf("Can't open \"%s\" for the frame stats, writing them here instead\n", statsJsonPath);
+			statsFile = stdout;
+		}
+		writeHeadlessReport(statsFile, computeFrameTimeStats(headlessFrameMs), g_FrameStats, headlessWarmupFrames, asteroidCount, g_GpuProfiler);
+		if (statsFile != stdout)
+		{
+			fclose(statsFile);
+		}
+		setGLFramebuffer(g_GLState, 0);
+		destroyHeadlessTarget(headlessTarget);
+	}
 
-	glfwTerminate();
+	destroyAsteroidScene(scene);
+	destroyModel(rock);
+	destroyModel(planet);
+	destroyShaderPipelineCache(shaderPipelines);
+	destroyShaderVariantCache(shaderVariants);
+	destroyGpuProfiler(g_GpuProfiler);
+	destroyCpuProfiler(g_CpuProfiler);
+	destroyRingBuffer(g_FrameRing, g_GLState);
+	destroyFrameArena(g_FrameArena);
+
+	destroyJobSystem(g_Jobs);
+	if (headless)
+	{
+		destroyHeadlessContext(headlessContext);
+	}
+	else
+	{
+		glfwTerminate();
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+#pragma once
+
+// Counts every heap allocation that goes through operator new, per thread and per frame, to keep
+// the frame loop allocation free once it has warmed up. Each thread owns a slot of counters it
+// bumps with a relaxed load and store, the main thread folds them into per frame deltas in
+// advanceAllocTrackerFrame(). Once the loop is declared in its steady state, a frame that
+// allocated is reported, optionally with the callstacks of its first allocations, or asserts.
+//
+// Only operator new is hooked. malloc() called directly, by C libraries or by the GL driver, isn't
+// seen. Building with ALLOC_TRACKER 0 removes the hook.
+
+#ifndef ALLOC_TRACKER
+#define ALLOC_TRACKER 1
+#endif
+
+// Threads past this share the last slot and may lose counts to each other
+#define ALLOC_TRACKER_MAX_THREADS 64
+#define ALLOC_TRACKER_MAX_STACKS 4
+#define ALLOC_TRACKER_STACK_DEPTH 24
+
+#if defined(_WIN32)
+extern "C" __declspec(dllimport) unsigned short __stdcall RtlCaptureStackBackTrace(unsigned long framesToSkip, unsigned long framesToCapture, void** backTrace, unsigned long* backTraceHash);
+#elif defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+struct AllocThreadCounters
+{
+	std::atomic<u64> allocations;
+	std::atomic<u64> bytes;
+	// Totals at the last frame boundary, main thread only
+	u64 frameAllocations;
+	u64 frameBytes;
+};
+
+struct AllocStack
+{
+	void* frames[ALLOC_TRACKER_STACK_DEPTH];
+	u32 depth;
+	u32 thread;
+	u64 size;
+};
+
+struct AllocTracker
+{
+	AllocThreadCounters threads[ALLOC_TRACKER_MAX_THREADS];
+	std::atomic<u32> threadCount;
+	std::atomic<bool32> steadyState;
+
+	bool32 report;
+	bool32 captureStacks;
+	bool32 assertSteadyState;
+
+	// The first allocations of a steady state frame, printed at the next frame boundary
+	AllocStack stacks[ALLOC_TRACKER_MAX_STACKS];
+	std::atomic<u32> stackCount;
+
+	u32 frameIndex;
+	u64 lastFrameAllocations;
+	u64 lastFrameBytes;
+	// Since the last takeAllocTrackerReport()
+	u64 periodAllocations;
+	u64 periodBytes;
+	u32 periodFrames;
+	// Steady state frames that allocated anyway
+	u32 allocatingFrames;
+};
+
+// Whether the current thread is already inside the tracker, so allocations the tracker itself
+// causes, e.g. backtrace() loading its unwinder, aren't counted
+static thread_local bool32 t_AllocTrackerBusy = false;
+static thread_local u32 t_AllocTrackerThread = ~0u;
+
+static inline u32 captureAllocStack(void** frames, u32 maxDepth)
+{
+#if defined(_WIN32)
+	return RtlCaptureStackBackTrace(2, maxDepth, frames, nullptr);
+#elif defined(__linux__) || defined(__APPLE__)
+	return u32(backtrace(frames, int(maxDepth)));
+#else
+	return 0;
+#endif
+}
+
+static inline void printAllocStack(const AllocStack& stack)
+{
+	printf("  %llu bytes on thread %u\n", (unsigned long long)stack.size, stack.thread);
+#if defined(__linux__) || defined(__APPLE__)
+	fflush(stdout);
+	backtrace_symbols_fd((void* const*)stack.frames, int(stack.depth), STDOUT_FILENO);
+#else
+	for (u32 i = 0; i < stack.depth; i++)
+	{
+		printf("    %p\n", stack.frames[i]);
+	}
+#endif
+}
+
+// Called before any thread but the main one exists
+static inline void initAllocTracker(AllocTracker& tracker, bool32 report, bool32 captureStacks, bool32 assertSteadyState)
+{
+	tracker.report = report || captureStacks || assertSteadyState;
+	tracker.captureStacks = captureStacks;
+	tracker.assertSteadyState = assertSteadyState;
+	tracker.steadyState.store(false, std::memory_order_relaxed);
+	tracker.stackCount.store(0, std::memory_order_relaxed);
+	tracker.frameIndex = 0;
+	tracker.lastFrameAllocations = 0;
+	tracker.lastFrameBytes = 0;
+	tracker.periodAllocations = 0;
+	tracker.periodBytes = 0;
+	tracker.periodFrames = 0;
+	tracker.allocatingFrames = 0;
+
+	if (captureStacks)
+	{
+		// The first backtrace() loads the unwinder, which allocates
+		void* frames[1];
+		t_AllocTrackerBusy = true;
+		captureAllocStack(frames, 1);
+		t_AllocTrackerBusy = false;
+	}
+}
+
+// From operator new, on any thread. Allocations before initAllocTracker() are counted too, the
+// tracker is a zero initialized global.
+static inline void recordAllocation(AllocTracker& tracker, u64 size)
+{
+	if (t_AllocTrackerBusy)
+	{
+		return;
+	}
+
+	if (t_AllocTrackerThread == ~0u)
+	{
+		t_AllocTrackerThread = min(tracker.threadCount.fetch_add(1, std::memory_order_relaxed), u32(ALLOC_TRACKER_MAX_THREADS - 1));
+	}
+	AllocThreadCounters& counters = tracker.threads[t_AllocTrackerThread];
+	counters.allocations.store(counters.allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	counters.bytes.store(counters.bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+
+	if (tracker.captureStacks && tracker.steadyState.load(std::memory_order_relaxed))
+	{
+		u32 stackIndex = tracker.stackCount.fetch_add(1, std::memory_order_relaxed);
+		if (stackIndex < ALLOC_TRACKER_MAX_STACKS)
+		{
+			t_AllocTrackerBusy = true;
+			AllocStack& stack = tracker.stacks[stackIndex];
+			stack.depth = captureAllocStack(stack.frames, ALLOC_TRACKER_STACK_DEPTH);
+			stack.thread = t_AllocTrackerThread;
+			stack.size = size;
+			t_AllocTrackerBusy = false;
+		}
+	}
+}
+
+// Frames before this are warming up: caches fill, vectors grow to their working size
+static inline void setAllocTrackerSteadyState(AllocTracker& tracker, bool32 steadyState)
+{
+	tracker.stackCount.store(0, std::memory_order_relaxed);
+	tracker.steadyState.store(steadyState, std::memory_order_relaxed);
+	if (steadyState && tracker.report)
+	{
+		printf("Allocation tracker: steady state from frame %u\n", tracker.frameIndex);
+	}
+}
+
+// Closes the previous frame, at the start of each one on the main thread. The workers must be
+// idle, as they are between parallelFor() calls.
+static inline void advanceAllocTrackerFrame(AllocTracker& tracker)
+{
+	t_AllocTrackerBusy = true;
+	u64 frameAllocations = 0;
+	u64 frameBytes = 0;
+	u32 threadCount = min(tracker.threadCount.load(std::memory_order_relaxed), u32(ALLOC_TRACKER_MAX_THREADS));
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		AllocThreadCounters& counters = tracker.threads[i];
+		u64 allocations = counters.allocations.load(std::memory_order_relaxed);
+		u64 bytes = counters.bytes.load(std::memory_order_relaxed);
+		frameAllocations += allocations - counters.frameAllocations;
+		frameBytes += bytes - counters.frameBytes;
+	}
+
+	bool32 steadyState = tracker.steadyState.load(std::memory_order_relaxed);
+	if (steadyState && frameAllocations)
+	{
+		tracker.allocatingFrames++;
+		if (tracker.report)
+		{
+			printf("Allocation tracker: steady state frame %u allocated %llu times, %llu bytes\n", tracker.frameIndex, (unsigned long long)frameAllocations, (unsigned long long)frameBytes);
+			for (u32 i = 0; i < threadCount; i++)
+			{
+				AllocThreadCounters& counters = tracker.threads[i];
+				u64 allocations = counters.allocations.load(std::memory_order_relaxed) - counters.frameAllocations;
+				if (allocations)
+				{
+					printf("  thread %u: %llu allocations, %llu bytes\n", i, (unsigned long long)allocations, (unsigned long long)(counters.bytes.load(std::memory_order_relaxed) - counters.frameBytes));
+				}
+			}
+			u32 stackCount = min(tracker.stackCount.load(std::memory_order_relaxed), u32(ALLOC_TRACKER_MAX_STACKS));
+			for (u32 i = 0; i < stackCount; i++)
+			{
+				printAllocStack(tracker.stacks[i]);
+			}
+		}
+		assert(!tracker.assertSteadyState && "Steady state frame allocated");
+	}
+	tracker.stackCount.store(0, std::memory_order_relaxed);
+
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		AllocThreadCounters& counters = tracker.threads[i];
+		counters.frameAllocations = counters.allocations.load(std::memory_order_relaxed);
+		counters.frameBytes = counters.bytes.load(std::memory_order_relaxed);
+	}
+	tracker.lastFrameAllocations = frameAllocations;
+	tracker.lastFrameBytes = frameBytes;
+	tracker.periodAllocations += frameAllocations;
+	tracker.periodBytes += frameBytes;
+	tracker.periodFrames++;
+	tracker.frameIndex++;
+	t_AllocTrackerBusy = false;
+}
+
+// Prints the per frame average since the last call, when reporting is on
+static inline void takeAllocTrackerReport(AllocTracker& tracker)
+{
+	if (tracker.report && tracker.periodFrames)
+	{
+		printf("Allocations: %.1f per frame, %.1f KB per frame\n", double(tracker.periodAllocations) / tracker.periodFrames, double(tracker.periodBytes) / tracker.periodFrames / 1024.0);
+	}
+	tracker.periodAllocations = 0;
+	tracker.periodBytes = 0;
+	tracker.periodFrames = 0;
+}
+
+static inline void printAllocTrackerSummary(const AllocTracker& tracker)
+{
+	if (tracker.report)
+	{
+		printf("Allocation tracker: %u steady state frames allocated\n", tracker.allocatingFrames);
+	}
+}
@@ -1,12 +1,36 @@
-#version 330 core
+#version 410 core
+
+#ifndef IMPOSTOR_FADE
+#define IMPOSTOR_FADE 1
+#endif
 
 out vec4 FragmentColor;
 
-in vec2 TexCoord;
+layout(location = 0) in vec2 TexCoord;
+#if IMPOSTOR_FADE
+layout(location = 1) in float Fade;
+#endif
 
 uniform sampler2D texture_diffuse1;
 
+#if IMPOSTOR_FADE
+const float bayer4x4[16] = float[16](
+	 0.0f / 16.0f,  8.0f / 16.0f,  2.0f / 16.0f, 10.0f / 16.0f,
+	12.0f / 16.0f,  4.0f / 16.0f, 14.0f / 16.0f,  6.0f / 16.0f,
+	 3.0f / 16.0f, 11.0f / 16.0f,  1.0f / 16.0f,  9.0f / 16.0f,
+	15.0f / 16.0f,  7.0f / 16.0f, 13.0f / 16.0f,  5.0f / 16.0f);
+#endif
+
 void main()
 {
+#if IMPOSTOR_FADE
+	// Cross-fade towards the impostor: Fade is 0 when the mesh is drawn alone
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	if (Fade > bayer4x4[pixel.y * 4 + pixel.x])
+	{
+		discard;
+	}
+#endif
+
 	FragmentColor = texture(texture_diffuse1, TexCoord);
 }
\ No newline at end of file
@@ -1,16 +1,20 @@
-#version 330 core
+#version 410 core
 
 layout(location = 0) in vec3 position;
 layout(location = 2) in vec2 texCoord;
 layout(location = 3) in mat4 instanceMatrix;
+layout(location = 7) in float instanceFade;
 
-out vec2 TexCoord;
+// Varyings are matched by location, so the fragment permutation without IMPOSTOR_FADE can
+// leave Fade unread
+layout(location = 0) out vec2 TexCoord;
+layout(location = 1) out float Fade;
 
-uniform mat4 proj;
-uniform mat4 view;
+#include "frame_uniforms.glsl"
 
 void main()
 {
-	gl_Position = proj * view * instanceMatrix * vec4(position, 1.0f);
+	gl_Position = viewProj * (instanceMatrix * vec4(position, 1.0f));
 	TexCoord = texCoord;
+	Fade = instanceFade;
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+#pragma once
+
+// Results of the --bench scenarios and the --compare mode that diffs two result files. Every
+// scenario draws a fixed workload from fixed seeds along a fixed camera path, so two runs of the
+// same build on the same machine should only differ by noise. The JSON written here is the only
+// format read back, so the reader only has to understand this layout.
+
+#define BENCHMARK_NAME_SIZE 64
+#define BENCHMARK_DEFAULT_THRESHOLD 5.0
+
+enum BenchmarkScenario
+{
+	BENCHMARK_ASTEROIDS_10K,
+	BENCHMARK_ASTEROIDS_100K,
+	BENCHMARK_ASTEROIDS_1M,
+	BENCHMARK_ASTEROIDS_10M,
+	BENCHMARK_NANOSUIT_GRID,
+	BENCHMARK_MANY_LIGHTS,
+	BENCHMARK_TEXTURE_HEAVY,
+	BENCHMARK_LOAD_ONLY,
+	BENCHMARK_SCENARIO_COUNT,
+};
+
+static const char* const g_BenchmarkScenarioNames[BENCHMARK_SCENARIO_COUNT] =
+{
+	"asteroids_10k",
+	"asteroids_100k",
+	"asteroids_1m",
+	"asteroids_10m",
+	"nanosuit_grid",
+	"many_lights",
+	"texture_heavy",
+	"load_only",
+};
+
+struct BenchmarkResult
+{
+	char name[BENCHMARK_NAME_SIZE];
+	// Wall clock from the start of one frame to the start of the next
+	FrameTimeStats frameMs;
+	// Recording and submitting a frame on the CPU
+	FrameTimeStats cpuMs;
+	// The whole frame on the GPU, from the timestamp profiler
+	FrameTimeStats gpuMs;
+	// Loading the scenario before its first frame
+	double loadMs;
+
+	// Per frame
+	double drawCalls;
+	double triangles;
+
+	// What the scenario allocated for its workload
+	u64 gpuBytes;
+	u64 cpuBytes;
+};
+
+// Returns BENCHMARK_SCENARIO_COUNT for an unknown name
+static inline u32 findBenchmarkScenario(const char* name)
+{
+	for (u32 i = 0; i < BENCHMARK_SCENARIO_COUNT; i++)
+	{
+		if (strcmp(g_BenchmarkScenarioNames[i], name) == 0)
+		{
+			return i;
+		}
+	}
+	return BENCHMARK_SCENARIO_COUNT;
+}
+
+static inline void initBenchmarkResult(BenchmarkResult& result, const char* name)
+{
+	memset(&result, 0, sizeof(result));
+	snprintf(result.name, sizeof(result.name), "%s", name);
+}
+
+static inline void writeFrameTimeStatsJson(FILE* file, const char* key, const FrameTimeStats& stats)
+{
+	fprintf(file, "\t\t\t\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", key, stats.meanMs, stats.p50Ms, stats.p99Ms, stats.maxMs);
+}
+
+static inline void writeBenchmarkResults(FILE* file, const char* renderer, const vector<BenchmarkResult>& results)
+{
+	fprintf(file, "{\n\t\"renderer\": \"%s\",\n\t\"scenarios\": [\n", renderer);
+	for (u32 i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		fprintf(file, "\t\t{\n\t\t\t\"name\": \"%s\",\n", result.name);
+		fprintf(file, "\t\t\t\"frames\": %u,\n", result.frameMs.frameCount);
+		writeFrameTimeStatsJson(file, "frameMs", result.frameMs);
+		writeFrameTimeStatsJson(file, "cpuMs", result.cpuMs);
+		writeFrameTimeStatsJson(file, "gpuMs", result.gpuMs);
+		fprintf(file, "\t\t\t\"loadMs\": %.4f,\n", result.loadMs);
+		fprintf(file, "\t\t\t\"drawCalls\": %.1f,\n\t\t\t\"triangles\": %.1f,\n", result.drawCalls, result.triangles);
+		fprintf(file, "\t\t\t\"gpuBytes\": %llu,\n\t\t\t\"cpuBytes\": %llu\n", (unsigned long long)result.gpuBytes, (unsigned long long)result.cpuBytes);
+		fprintf(file, "\t\t}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+}
+
+// The number after "key": within [begin, end), 0 when it isn't there
+static inline double findBenchmarkJsonNumber(const char* begin, const char* end, const char* key)
+{
+	char pattern[BENCHMARK_NAME_SIZE];
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	size_t patternLength = strlen(pattern);
+	for (const char* cursor = begin; cursor + patternLength <= end; cursor++)
+	{
+		if (memcmp(cursor, pattern, patternLength) == 0)
+		{
+			return strtod(cursor + patternLength, nullptr);
+		}
+	}
+	return 0.0;
+}
+
+static inline void readFrameTimeStatsJson(const char* begin, const char* end, const char* key, FrameTimeStats& stats)
+{
+	char pattern[BENCHMARK_NAME_SIZE];
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	const char* object = strstr(begin, pattern);
+	if (!object || object >= end)
+	{
+		return;
+	}
+	const char* objectEnd = strchr(object, '}');
+	objectEnd = objectEnd && objectEnd < end ? objectEnd : end;
+	stats.meanMs = findBenchmarkJsonNumber(object, objectEnd, "mean");
+	stats.p50Ms = findBenchmarkJsonNumber(object, objectEnd, "p50");
+	stats.p99Ms = findBenchmarkJsonNumber(object, objectEnd, "p99");
+	stats.maxMs = findBenchmarkJsonNumber(object, objectEnd, "max");
+}
+
+static inline bool32 readBenchmarkResults(const char* path, vector<BenchmarkResult>& results)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		printf("Can't open benchmark results \"%s\"\n", path);
+		return false;
+	}
+	string text;
+	char chunk[4096];
+	size_t rc;
+	while ((rc = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		text.append(chunk, rc);
+	}
+	fclose(file);
+
+	// Every scenario object starts with its name
+	const char namePattern[] = "\"name\": \"";
+	const char* cursor = strstr(text.c_str(), namePattern);
+	while (cursor)
+	{
+		const char* nameBegin = cursor + sizeof(namePattern) - 1;
+		const char* nameEnd = strchr(nameBegin, '"');
+		const char* next = strstr(nameBegin, namePattern);
+		const char* end = next ? next : text.c_str() + text.size();
+		if (!nameEnd || nameEnd >= end)
+		{
+			printf("Benchmark results \"%s\" have a scenario name with no end\n", path);
+			return false;
+		}
+
+		BenchmarkResult result;
+		initBenchmarkResult(result, "");
+		snprintf(result.name, sizeof(result.name), "%.*s", int(nameEnd - nameBegin), nameBegin);
+		result.frameMs.frameCount = u32(findBenchmarkJsonNumber(nameEnd, end, "frames"));
+		readFrameTimeStatsJson(nameEnd, end, "frameMs", result.frameMs);
+		readFrameTimeStatsJson(nameEnd, end, "cpuMs", result.cpuMs);
+		readFrameTimeStatsJson(nameEnd, end, "gpuMs", result.gpuMs);
+		result.loadMs = findBenchmarkJsonNumber(nameEnd, end, "loadMs");
+		result.drawCalls = findBenchmarkJsonNumber(nameEnd, end, "drawCalls");
+		result.triangles = findBenchmarkJsonNumber(nameEnd, end, "triangles");
+		result.gpuBytes = u64(findBenchmarkJsonNumber(nameEnd, end, "gpuBytes"));
+		result.cpuBytes = u64(findBenchmarkJsonNumber(nameEnd, end, "cpuBytes"));
+		results.push_back(result);
+		cursor = next;
+	}
+	return true;
+}
+
+// Returns true when the metric grew by more than thresholdPercent: got slower, drew more or took
+// more memory
+static inline bool32 compareBenchmarkMetric(const char* scenario, const char* metric, double baseline, double run, double thresholdPercent)
+{
+	if (baseline <= 0.0)
+	{
+		return false;
+	}
+
+	double deltaPercent = (run - baseline) / baseline * 100.0;
+	bool32 regressed = deltaPercent > thresholdPercent;
+	printf("%-16s %-14s %12.4f %12.4f %+9.2f%%%s\n", scenario, metric, baseline, run, deltaPercent, regressed ? "  REGRESSION" : "");
+	return regressed;
+}
+
+// Prints every metric of every scenario both runs have and returns how many regressed
+static inline u32 compareBenchmarkResults(const vector<BenchmarkResult>& baseline, const vector<BenchmarkResult>& run, double thresholdPercent)
+{
+	u32 regressions = 0;
+	printf("%-16s %-14s %12s %12s %10s\n", "scenario", "metric", "baseline", "run", "delta");
+	for (const BenchmarkResult& runResult : run)
+	{
+		const BenchmarkResult* baselineResult = nullptr;
+		for (const BenchmarkResult& candidate : baseline)
+		{
+			if (strcmp(candidate.name, runResult.name) == 0)
+			{
+				baselineResult = &candidate;
+			}
+		}
+		if (!baselineResult)
+		{
+			printf("%-16s not in the baseline\n", runResult.name);
+			continue;
+		}
+
+		regressions += compareBenchmarkMetric(runResult.name, "frame mean", baselineResult->frameMs.meanMs, runResult.frameMs.meanMs, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "frame p99", baselineResult->frameMs.p99Ms, runResult.frameMs.p99Ms, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "cpu mean", baselineResult->cpuMs.meanMs, runResult.cpuMs.meanMs, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "gpu mean", baselineResult->gpuMs.meanMs, runResult.gpuMs.meanMs, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "gpu p99", baselineResult->gpuMs.p99Ms, runResult.gpuMs.p99Ms, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "load", baselineResult->loadMs, runResult.loadMs, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "draw calls", baselineResult->drawCalls, runResult.drawCalls, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "triangles", baselineResult->triangles, runResult.triangles, thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "gpu MB", baselineResult->gpuBytes / (1024.0 * 1024.0), runResult.gpuBytes / (1024.0 * 1024.0), thresholdPercent);
+		regressions += compareBenchmarkMetric(runResult.name, "cpu MB", baselineResult->cpuBytes / (1024.0 * 1024.0), runResult.cpuBytes / (1024.0 * 1024.0), thresholdPercent);
+	}
+	printf("%u regressions beyond %.1f%%\n", regressions, thresholdPercent);
+	return regressions;
+}
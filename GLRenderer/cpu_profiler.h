@@ -0,0 +1,219 @@
+#pragma once
+#include <chrono>
+
+// Scoped CPU zones written to a Chrome trace (chrome://tracing, ui.perfetto.dev). A zone is one
+// complete event recorded when it closes, into a fixed buffer owned by the recording thread, so
+// recording takes no lock and no atomic read-modify-write: the owner bumps its count with a
+// release store and the trace writer reads it with an acquire load. A zone costs two clock reads
+// while a capture runs and one relaxed load otherwise. Building with CPU_PROFILER 0 compiles
+// every zone away.
+//
+// The capture covers a range of frames, counted by CPU_PROFILER_FRAME(). A range starting at
+// frame 0 also catches everything before the first frame, e.g. loading and shader compiles.
+// The trace is written when the range ends, or at shutdown if it never did.
+
+#ifndef CPU_PROFILER
+#define CPU_PROFILER 1
+#endif
+
+#define CPU_PROFILER_EVENTS_PER_THREAD (1 << 18)
+
+struct CpuZoneEvent
+{
+	const char* name;
+	u64 beginNs;
+	u64 endNs;
+};
+
+struct CpuZoneBuffer
+{
+	CpuZoneEvent events[CPU_PROFILER_EVENTS_PER_THREAD];
+	std::atomic<u32> count;
+	u32 droppedEvents;
+	u32 threadIndex;
+};
+
+struct CpuProfiler
+{
+	std::mutex mutex;
+	vector<CpuZoneBuffer*> buffers;
+	std::atomic<bool32> capturing;
+
+	const char* tracePath;
+	u64 originNs;
+	u32 frameIndex;
+	u32 firstFrame;
+	u32 lastFrame;
+};
+
+static inline u64 getCpuProfilerNs()
+{
+	return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// tracePath == nullptr leaves the profiler off for good
+static inline void initCpuProfiler(CpuProfiler& profiler, const char* tracePath, u32 firstFrame, u32 frameCount)
+{
+	profiler.tracePath = tracePath;
+	profiler.originNs = getCpuProfilerNs();
+	profiler.frameIndex = 0;
+	profiler.firstFrame = firstFrame;
+	profiler.lastFrame = firstFrame + frameCount;
+	profiler.capturing.store(tracePath && firstFrame == 0, std::memory_order_relaxed);
+}
+
+// Registered once per thread, on the first zone it records
+static inline CpuZoneBuffer* getCpuZoneBuffer(CpuProfiler& profiler)
+{
+	static thread_local CpuZoneBuffer* threadBuffer = nullptr;
+	if (!threadBuffer)
+	{
+		threadBuffer = new CpuZoneBuffer;
+		threadBuffer->count.store(0, std::memory_order_relaxed);
+		threadBuffer->droppedEvents = 0;
+
+		std::lock_guard<std::mutex> lock(profiler.mutex);
+		threadBuffer->threadIndex = u32(profiler.buffers.size());
+		profiler.buffers.push_back(threadBuffer);
+	}
+	return threadBuffer;
+}
+
+static inline void recordCpuZone(CpuProfiler& profiler, const char* name, u64 beginNs, u64 endNs)
+{
+	CpuZoneBuffer* buffer = getCpuZoneBuffer(profiler);
+	u32 index = buffer->count.load(std::memory_order_relaxed);
+	if (index == CPU_PROFILER_EVENTS_PER_THREAD)
+	{
+		buffer->droppedEvents++;
+		return;
+	}
+
+	CpuZoneEvent& event = buffer->events[index];
+	event.name = name;
+	event.beginNs = beginNs;
+	event.endNs = endNs;
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+struct CpuZone
+{
+	CpuProfiler& profiler;
+	const char* name;
+	u64 beginNs;
+
+	CpuZone(CpuProfiler& profiler_, const char* name_) : profiler(profiler_), name(name_), beginNs(0)
+	{
+		if (profiler.capturing.load(std::memory_order_relaxed))
+		{
+			beginNs = getCpuProfilerNs();
+		}
+	}
+
+	// Closes the zone early, the destructor then does nothing
+	void end()
+	{
+		if (beginNs)
+		{
+			recordCpuZone(profiler, name, beginNs, getCpuProfilerNs());
+			beginNs = 0;
+		}
+	}
+
+	~CpuZone()
+	{
+		end();
+	}
+};
+
+// Call while no other thread records, i.e. outside of any parallelFor
+static inline void writeCpuTrace(CpuProfiler& profiler)
+{
+	if (!profiler.tracePath)
+	{
+		return;
+	}
+
+	FILE* file = fopen(profiler.tracePath, "w");
+	if (!file)
+	{
+		printf("Can't open \"%s\" for the CPU trace\n", profiler.tracePath);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(profiler.mutex);
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool32 first = true;
+	u32 eventCount = 0;
+	u32 droppedEvents = 0;
+	for (CpuZoneBuffer* buffer : profiler.buffers)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}", first ? "" : ",\n", buffer->threadIndex, buffer->threadIndex ? "Worker" : "Main", buffer->threadIndex);
+		first = false;
+
+		u32 count = buffer->count.load(std::memory_order_acquire);
+		for (u32 i = 0; i < count; i++)
+		{
+			const CpuZoneEvent& event = buffer->events[i];
+			double beginUs = double(event.beginNs - profiler.originNs) / 1000.0;
+			double durationUs = double(event.endNs - event.beginNs) / 1000.0;
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", event.name, beginUs, durationUs, buffer->threadIndex);
+		}
+		eventCount += count;
+		droppedEvents += buffer->droppedEvents;
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	printf("CPU trace: %u zones from %u threads written to %s (%u dropped)\n", eventCount, u32(profiler.buffers.size()), profiler.tracePath, droppedEvents);
+
+	// A trace is written once
+	profiler.tracePath = nullptr;
+}
+
+// Call at the start of every frame, from the main thread
+static inline void advanceCpuProfilerFrame(CpuProfiler& profiler)
+{
+	if (!profiler.tracePath)
+	{
+		return;
+	}
+
+	if (profiler.frameIndex == profiler.firstFrame)
+	{
+		profiler.capturing.store(true, std::memory_order_relaxed);
+	}
+	if (profiler.frameIndex == profiler.lastFrame)
+	{
+		profiler.capturing.store(false, std::memory_order_relaxed);
+		writeCpuTrace(profiler);
+	}
+	profiler.frameIndex++;
+}
+
+static inline void destroyCpuProfiler(CpuProfiler& profiler)
+{
+	profiler.capturing.store(false, std::memory_order_relaxed);
+	writeCpuTrace(profiler);
+	for (CpuZoneBuffer* buffer : profiler.buffers)
+	{
+		delete buffer;
+	}
+	profiler.buffers.clear();
+}
+
+#define CPU_ZONE_CONCAT_(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT_(a, b)
+
+#if CPU_PROFILER
+// Covers the rest of the enclosing scope
+#define CPU_ZONE(name) CpuZone CPU_ZONE_CONCAT(cpuZone, __LINE__)(g_CpuProfiler, name)
+// For phases that don't line up with a scope, closed with CPU_END_ZONE
+#define CPU_NAMED_ZONE(zone, name) CpuZone zone(g_CpuProfiler, name)
+#define CPU_END_ZONE(zone) zone.end()
+#define CPU_PROFILER_FRAME() advanceCpuProfilerFrame(g_CpuProfiler)
+#else
+#define CPU_ZONE(name)
+#define CPU_NAMED_ZONE(zone, name)
+#define CPU_END_ZONE(zone)
+#define CPU_PROFILER_FRAME()
+#endif
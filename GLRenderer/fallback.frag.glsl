@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+// Drawn with while the real programs are still being built
+void main()
+{
+	FragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+#if INSTANCED
+layout(location = 3) in mat4 instanceMatrix;
+#else
+uniform mat4 world;
+#endif
+
+#include "frame_uniforms.glsl"
+
+void main()
+{
+#if INSTANCED
+	gl_Position = viewProj * (instanceMatrix * vec4(position, 1.0f));
+#else
+	gl_Position = viewProj * (world * vec4(position, 1.0f));
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+// Linear allocator for data that only lives for one frame. Everything is handed out from one
+// block allocated up front and released at once by resetFrameArena() at the start of the next
+// frame, so the frame loop never goes to the heap for it. Allocation is a bump of the offset, from
+// the main thread only; workers write into ranges the main thread allocated for them.
+//
+// A frame that needs more than the capacity gets the rest from the heap, counted and freed with
+// the frame, and the next reset grows the block so it fits from then on.
+
+#define FRAME_ARENA_ALIGNMENT 16
+
+// Header of an allocation the arena sent to the heap, the data follows it
+struct FrameArenaOverflow
+{
+	alignas(FRAME_ARENA_ALIGNMENT) FrameArenaOverflow* next;
+};
+
+struct FrameArena
+{
+	u8* base;
+	u64 capacity;
+	u64 usedBytes;
+	u64 peakBytes;
+
+	FrameArenaOverflow* overflow;
+	u64 frameOverflowBytes;
+	// Since init
+	u64 overflowAllocations;
+	u64 overflowBytes;
+};
+
+static inline void initFrameArena(FrameArena& arena, u64 capacity)
+{
+	arena.base = (u8*)malloc(capacity);
+	assert(arena.base);
+	arena.capacity = capacity;
+	arena.usedBytes = 0;
+	arena.peakBytes = 0;
+	arena.overflow = nullptr;
+	arena.frameOverflowBytes = 0;
+	arena.overflowAllocations = 0;
+	arena.overflowBytes = 0;
+}
+
+static inline void freeFrameArenaOverflow(FrameArena& arena)
+{
+	while (arena.overflow)
+	{
+		FrameArenaOverflow* next = arena.overflow->next;
+		free(arena.overflow);
+		arena.overflow = next;
+	}
+	arena.frameOverflowBytes = 0;
+}
+
+static inline void destroyFrameArena(FrameArena& arena)
+{
+	freeFrameArenaOverflow(arena);
+	free(arena.base);
+	arena.base = nullptr;
+	arena.capacity = 0;
+}
+
+// Grows the arena to at least capacity, between frames only since the contents are lost. An arena
+// that was never initialized is set up here.
+static inline void reserveFrameArena(FrameArena& arena, u64 capacity)
+{
+	if (arena.capacity < capacity)
+	{
+		u64 peakBytes = arena.peakBytes;
+		u64 overflowAllocations = arena.overflowAllocations;
+		u64 overflowBytes = arena.overflowBytes;
+		destroyFrameArena(arena);
+		initFrameArena(arena, capacity);
+		arena.peakBytes = peakBytes;
+		arena.overflowAllocations = overflowAllocations;
+		arena.overflowBytes = overflowBytes;
+	}
+}
+
+static inline void resetFrameArena(FrameArena& arena)
+{
+	if (arena.frameOverflowBytes)
+	{
+		u64 capacity = arena.usedBytes + arena.frameOverflowBytes;
+		printf("Frame arena: overflowed by %llu bytes, growing from %llu to %llu bytes\n", (unsigned long long)arena.frameOverflowBytes, (unsigned long long)arena.capacity, (unsigned long long)capacity);
+		reserveFrameArena(arena, capacity);
+	}
+	freeFrameArenaOverflow(arena);
+	arena.usedBytes = 0;
+}
+
+// Uninitialized and FRAME_ARENA_ALIGNMENT aligned
+template <typename T>
+static inline T* allocateFrameArena(FrameArena& arena, u64 count)
+{
+	static_assert(alignof(T) <= FRAME_ARENA_ALIGNMENT, "Type is aligned beyond the frame arena");
+	u64 offset = (arena.usedBytes + FRAME_ARENA_ALIGNMENT - 1) & ~u64(FRAME_ARENA_ALIGNMENT - 1);
+	u64 size = count * sizeof(T);
+	if (offset + size > arena.capacity)
+	{
+		// malloc() aligns to at least FRAME_ARENA_ALIGNMENT on the 64 bit targets
+		FrameArenaOverflow* overflow = (FrameArenaOverflow*)malloc(sizeof(FrameArenaOverflow) + size);
+		if (!overflow)
+		{
+			printf("Frame arena: out of memory for %llu bytes\n", (unsigned long long)size);
+			abort();
+		}
+		overflow->next = arena.overflow;
+		arena.overflow = overflow;
+		u64 alignedSize = (size + FRAME_ARENA_ALIGNMENT - 1) & ~u64(FRAME_ARENA_ALIGNMENT - 1);
+		arena.frameOverflowBytes += alignedSize;
+		arena.overflowAllocations++;
+		arena.overflowBytes += size;
+		arena.peakBytes = max(arena.peakBytes, arena.usedBytes + arena.frameOverflowBytes);
+		return (T*)(overflow + 1);
+	}
+	arena.usedBytes = offset + size;
+	arena.peakBytes = max(arena.peakBytes, arena.usedBytes);
+	return (T*)(arena.base + offset);
+}
@@ -0,0 +1,355 @@
+#pragma once
+#include <algorithm>
+#include "cpu_profiler.h"
+#include "gpu_profiler.h"
+
+// Summary of a run of frame times, for the benchmark reports. Percentiles are nearest rank over
+// a sorted copy of the samples.
+
+struct FrameTimeStats
+{
+	u32 frameCount;
+	double meanMs;
+	double p50Ms;
+	double p99Ms;
+	double maxMs;
+};
+
+static inline double getSortedPercentile(const vector<float>& sorted, double percentile)
+{
+	size_t rank = size_t(ceil(percentile / 100.0 * double(sorted.size())));
+	rank = rank ? rank - 1 : 0;
+	return sorted[rank < sorted.size() ? rank : sorted.size() - 1];
+}
+
+static inline FrameTimeStats computeFrameTimeStats(const vector<float>& frameMs)
+{
+	FrameTimeStats stats = {};
+	stats.frameCount = u32(frameMs.size());
+	if (frameMs.empty())
+	{
+		return stats;
+	}
+
+	vector<float> sorted = frameMs;
+	std::sort(sorted.begin(), sorted.end());
+	double totalMs = 0.0;
+	for (float ms : sorted)
+	{
+		totalMs += ms;
+	}
+	stats.meanMs = totalMs / sorted.size();
+	stats.p50Ms = getSortedPercentile(sorted, 50.0);
+	stats.p99Ms = getSortedPercentile(sorted, 99.0);
+	stats.maxMs = sorted.back();
+	return stats;
+}
+
+// Frame time histograms for the interactive loop, where frames aren't kept. Each histogram is
+// HDR style: values in microseconds, exact below FRAME_HISTOGRAM_SUB_BUCKETS and above that one
+// power of two per magnitude split into FRAME_HISTOGRAM_SUB_BUCKETS / 2 linear buckets, so every
+// value is within 1/64 (1.6%) of its bucket from 1 us up to 16 s. Everything is fixed size,
+// recording a frame allocates nothing.
+
+#define FRAME_HISTOGRAM_SUB_BUCKET_BITS 7
+#define FRAME_HISTOGRAM_SUB_BUCKETS (1u << FRAME_HISTOGRAM_SUB_BUCKET_BITS)
+#define FRAME_HISTOGRAM_MAX_US ((1u << 24) - 1)
+// The bucket of FRAME_HISTOGRAM_MAX_US, plus one
+#define FRAME_HISTOGRAM_BUCKETS ((24 - FRAME_HISTOGRAM_SUB_BUCKET_BITS) * (FRAME_HISTOGRAM_SUB_BUCKETS / 2) + FRAME_HISTOGRAM_SUB_BUCKETS)
+#define FRAME_STATS_WORST_FRAMES 8
+#define FRAME_STATS_MARKERS 4
+#define FRAME_STATS_DEFAULT_HITCH_MS 33.3
+
+enum FrameStatsSeries
+{
+	// Start of one frame to the start of the next, what deltaTime measures
+	FRAME_STATS_FRAME,
+	// Start of the frame to the swap
+	FRAME_STATS_CPU,
+	// The frame pass of the GPU profiler, arrives a few frames late
+	FRAME_STATS_GPU,
+	// Inside glfwSwapBuffers(), mostly waiting on vsync or on the GPU
+	FRAME_STATS_SWAP,
+	FRAME_STATS_SERIES_COUNT,
+};
+
+static const char* const g_FrameStatsSeriesNames[FRAME_STATS_SERIES_COUNT] =
+{
+	"frame",
+	"cpu",
+	"gpu",
+	"swap",
+};
+
+struct FrameHistogram
+{
+	u32 counts[FRAME_HISTOGRAM_BUCKETS];
+	u64 count;
+	u64 totalUs;
+	u32 maxUs;
+	u32 hitchCount;
+};
+
+struct FrameHistogramStats
+{
+	u64 count;
+	double meanMs;
+	double p50Ms;
+	double p90Ms;
+	double p99Ms;
+	double p999Ms;
+	double maxMs;
+	u32 hitchCount;
+};
+
+struct FrameStatsFrame
+{
+	u64 frameIndex;
+	u64 gpuFrameIndex;
+	// Start of the frame in the CPU trace's clock, in us, to find it in the trace
+	double traceUs;
+	float ms[FRAME_STATS_SERIES_COUNT];
+	// Set by markFrameStats(), string literals
+	const char* markers[FRAME_STATS_MARKERS];
+	u32 markerCount;
+};
+
+struct FrameStats
+{
+	FrameHistogram histograms[FRAME_STATS_SERIES_COUNT];
+	double hitchThresholdMs;
+
+	// Sorted slowest first by frame time
+	FrameStatsFrame worstFrames[FRAME_STATS_WORST_FRAMES];
+	u32 worstFrameCount;
+
+	FrameStatsFrame current;
+	u64 frameBeginNs;
+	u64 swapBeginNs;
+	u64 frameCount;
+	u64 traceOriginNs;
+	u64 seenGpuFrames;
+};
+
+static inline u32 getFrameHistogramBucket(u32 us)
+{
+	us = min(us, u32(FRAME_HISTOGRAM_MAX_US));
+	if (us < FRAME_HISTOGRAM_SUB_BUCKETS)
+	{
+		return us;
+	}
+
+	u32 highestBit = 31;
+	while (!(us & (1u << highestBit)))
+	{
+		highestBit--;
+	}
+	u32 magnitude = highestBit - FRAME_HISTOGRAM_SUB_BUCKET_BITS + 1;
+	return magnitude * (FRAME_HISTOGRAM_SUB_BUCKETS / 2) + (us >> magnitude);
+}
+
+// The middle of the values that land in the bucket
+static inline double getFrameHistogramBucketUs(u32 bucket)
+{
+	if (bucket < FRAME_HISTOGRAM_SUB_BUCKETS)
+	{
+		return double(bucket);
+	}
+
+	u32 magnitude = bucket / (FRAME_HISTOGRAM_SUB_BUCKETS / 2) - 1;
+	u32 subBucket = bucket - magnitude * (FRAME_HISTOGRAM_SUB_BUCKETS / 2);
+	return double(u64(subBucket) << magnitude) + double(1u << magnitude) * 0.5;
+}
+
+static inline void recordFrameHistogram(FrameHistogram& histogram, double ms, double hitchThresholdMs)
+{
+	u32 us = u32(min(max(ms, 0.0) * 1000.0 + 0.5, double(FRAME_HISTOGRAM_MAX_US)));
+	histogram.counts[getFrameHistogramBucket(us)]++;
+	histogram.count++;
+	histogram.totalUs += us;
+	histogram.maxUs = max(histogram.maxUs, us);
+	histogram.hitchCount += ms > hitchThresholdMs ? 1 : 0;
+}
+
+// Nearest rank, like getSortedPercentile(), to the histogram's precision
+static inline double getFrameHistogramPercentile(const FrameHistogram& histogram, double percentile)
+{
+	if (!histogram.count)
+	{
+		return 0.0;
+	}
+
+	u64 rank = u64(ceil(percentile / 100.0 * double(histogram.count)));
+	rank = max(rank, u64(1));
+	u64 seen = 0;
+	for (u32 bucket = 0; bucket < FRAME_HISTOGRAM_BUCKETS; bucket++)
+	{
+		seen += histogram.counts[bucket];
+		if (seen >= rank)
+		{
+			return min(getFrameHistogramBucketUs(bucket), double(histogram.maxUs)) / 1000.0;
+		}
+	}
+	return histogram.maxUs / 1000.0;
+}
+
+static inline FrameHistogramStats getFrameHistogramStats(const FrameHistogram& histogram)
+{
+	FrameHistogramStats stats = {};
+	stats.count = histogram.count;
+	stats.meanMs = histogram.count ? double(histogram.totalUs) / histogram.count / 1000.0 : 0.0;
+	stats.p50Ms = getFrameHistogramPercentile(histogram, 50.0);
+	stats.p90Ms = getFrameHistogramPercentile(histogram, 90.0);
+	stats.p99Ms = getFrameHistogramPercentile(histogram, 99.0);
+	stats.p999Ms = getFrameHistogramPercentile(histogram, 99.9);
+	stats.maxMs = histogram.maxUs / 1000.0;
+	stats.hitchCount = histogram.hitchCount;
+	return stats;
+}
+
+static inline void resetFrameStatsFrame(FrameStats& stats)
+{
+	memset(&stats.current, 0, sizeof(stats.current));
+	stats.current.frameIndex = stats.frameCount;
+	stats.current.gpuFrameIndex = GPU_PROFILER_NO_FRAME;
+	stats.current.traceUs = double(stats.frameBeginNs - stats.traceOriginNs) / 1000.0;
+}
+
+// traceOriginNs is the CPU profiler's origin, so worst frames can be looked up in its trace
+static inline void initFrameStats(FrameStats& stats, double hitchThresholdMs, u64 traceOriginNs)
+{
+	memset(stats.histograms, 0, sizeof(stats.histograms));
+	stats.hitchThresholdMs = hitchThresholdMs;
+	stats.worstFrameCount = 0;
+	stats.frameBeginNs = 0;
+	stats.swapBeginNs = 0;
+	stats.frameCount = 0;
+	stats.traceOriginNs = traceOriginNs;
+	stats.seenGpuFrames = 0;
+	resetFrameStatsFrame(stats);
+}
+
+// Starts over, e.g. once warm up frames are done. The frame in progress is kept.
+static inline void resetFrameStats(FrameStats& stats)
+{
+	memset(stats.histograms, 0, sizeof(stats.histograms));
+	stats.worstFrameCount = 0;
+}
+
+static inline void addFrameStatsWorstFrame(FrameStats& stats, const FrameStatsFrame& frame)
+{
+	float frameMs = frame.ms[FRAME_STATS_FRAME];
+	if (stats.worstFrameCount == FRAME_STATS_WORST_FRAMES && frameMs <= stats.worstFrames[FRAME_STATS_WORST_FRAMES - 1].ms[FRAME_STATS_FRAME])
+	{
+		return;
+	}
+
+	u32 slot = min(stats.worstFrameCount, u32(FRAME_STATS_WORST_FRAMES - 1));
+	while (slot > 0 && stats.worstFrames[slot - 1].ms[FRAME_STATS_FRAME] < frameMs)
+	{
+		stats.worstFrames[slot] = stats.worstFrames[slot - 1];
+		slot--;
+	}
+	stats.worstFrames[slot] = frame;
+	stats.worstFrameCount = min(stats.worstFrameCount + 1, u32(FRAME_STATS_WORST_FRAMES));
+}
+
+// Call at the start of every frame. Closes the previous frame, whose length is only known now.
+static inline void beginFrameStats(FrameStats& stats)
+{
+	u64 nowNs = getCpuProfilerNs();
+	if (stats.frameBeginNs)
+	{
+		FrameStatsFrame& frame = stats.current;
+		frame.ms[FRAME_STATS_FRAME] = float(double(nowNs - stats.frameBeginNs) / 1000000.0);
+		recordFrameHistogram(stats.histograms[FRAME_STATS_FRAME], frame.ms[FRAME_STATS_FRAME], stats.hitchThresholdMs);
+		recordFrameHistogram(stats.histograms[FRAME_STATS_CPU], frame.ms[FRAME_STATS_CPU], stats.hitchThresholdMs);
+		recordFrameHistogram(stats.histograms[FRAME_STATS_SWAP], frame.ms[FRAME_STATS_SWAP], stats.hitchThresholdMs);
+		addFrameStatsWorstFrame(stats, frame);
+		stats.frameCount++;
+	}
+
+	stats.frameBeginNs = nowNs;
+	resetFrameStatsFrame(stats);
+}
+
+// Tags the current frame, e.g. with what made it slow. name has to outlive the stats.
+static inline void markFrameStats(FrameStats& stats, const char* name)
+{
+	FrameStatsFrame& frame = stats.current;
+	if (frame.markerCount < FRAME_STATS_MARKERS)
+	{
+		frame.markers[frame.markerCount++] = name;
+	}
+}
+
+// Call right after beginGpuProfilerFrame(): takes the GPU times resolved since the last call and
+// ties the current frame to the GPU profiler's frame
+static inline void collectFrameStatsGpu(FrameStats& stats, const GpuProfiler& profiler)
+{
+	// Whatever fell out of the profiler's history in between is lost
+	u64 firstFrame = profiler.resolvedFrames > GPU_PROFILER_HISTORY ? profiler.resolvedFrames - GPU_PROFILER_HISTORY : 0;
+	for (u64 resolved = max(stats.seenGpuFrames, firstFrame); resolved < profiler.resolvedFrames; resolved++)
+	{
+		u32 slot = u32(resolved % GPU_PROFILER_HISTORY);
+		float gpuMs = profiler.resolvedFrameMs[slot];
+		recordFrameHistogram(stats.histograms[FRAME_STATS_GPU], gpuMs, stats.hitchThresholdMs);
+		for (u32 i = 0; i < stats.worstFrameCount; i++)
+		{
+			if (stats.worstFrames[i].gpuFrameIndex == profiler.resolvedFrameIndices[slot])
+			{
+				stats.worstFrames[i].ms[FRAME_STATS_GPU] = gpuMs;
+			}
+		}
+	}
+	stats.seenGpuFrames = profiler.resolvedFrames;
+	stats.current.gpuFrameIndex = getGpuProfilerFrameIndex(profiler);
+}
+
+static inline void beginFrameStatsSwap(FrameStats& stats)
+{
+	stats.swapBeginNs = getCpuProfilerNs();
+	stats.current.ms[FRAME_STATS_CPU] = float(double(stats.swapBeginNs - stats.frameBeginNs) / 1000000.0);
+}
+
+static inline void endFrameStatsSwap(FrameStats& stats)
+{
+	stats.current.ms[FRAME_STATS_SWAP] = float(double(getCpuProfilerNs() - stats.swapBeginNs) / 1000000.0);
+}
+
+static inline void printFrameStats(FILE* file, const FrameStats& stats)
+{
+	fprintf(file, "%-6s %8s %8s %8s %8s %8s %8s %8s %10s\n", "", "frames", "mean", "p50", "p90", "p99", "p99.9", "max", "hitches");
+	for (u32 series = 0; series < FRAME_STATS_SERIES_COUNT; series++)
+	{
+		FrameHistogramStats seriesStats = getFrameHistogramStats(stats.histograms[series]);
+		fprintf(file, "%-6s %8llu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %10u\n", g_FrameStatsSeriesNames[series], (unsigned long long)seriesStats.count,
+			seriesStats.meanMs, seriesStats.p50Ms, seriesStats.p90Ms, seriesStats.p99Ms, seriesStats.p999Ms, seriesStats.maxMs, seriesStats.hitchCount);
+	}
+	fprintf(file, "Hitches are frames over %.1f ms. Worst frames (times in ms, trace time in us):\n", stats.hitchThresholdMs);
+	for (u32 i = 0; i < stats.worstFrameCount; i++)
+	{
+		const FrameStatsFrame& frame = stats.worstFrames[i];
+		fprintf(file, "  frame %llu at %.0f: frame %.3f, cpu %.3f, gpu %.3f, swap %.3f", (unsigned long long)frame.frameIndex, frame.traceUs,
+			frame.ms[FRAME_STATS_FRAME], frame.ms[FRAME_STATS_CPU], frame.ms[FRAME_STATS_GPU], frame.ms[FRAME_STATS_SWAP]);
+		for (u32 marker = 0; marker < frame.markerCount; marker++)
+		{
+			fprintf(file, "%s%s", marker ? ", " : " [", frame.markers[marker]);
+		}
+		fprintf(file, "%s\n", frame.markerCount ? "]" : "");
+	}
+}
+
+// The histogram percentiles as a JSON object, for the headless report
+static inline void writeFrameStatsJson(FILE* file, const FrameStats& stats, const char* indent)
+{
+	fprintf(file, "{\n");
+	for (u32 series = 0; series < FRAME_STATS_SERIES_COUNT; series++)
+	{
+		FrameHistogramStats seriesStats = getFrameHistogramStats(stats.histograms[series]);
+		fprintf(file, "%s\t\"%s\": { \"frames\": %llu, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"p999\": %.4f, \"max\": %.4f, \"hitches\": %u },\n",
+			indent, g_FrameStatsSeriesNames[series], (unsigned long long)seriesStats.count, seriesStats.meanMs, seriesStats.p50Ms, seriesStats.p90Ms,
+			seriesStats.p99Ms, seriesStats.p999Ms, seriesStats.maxMs, seriesStats.hitchCount);
+	}
+	fprintf(file, "%s\t\"hitchThresholdMs\": %.2f\n%s}", indent, stats.hitchThresholdMs, indent);
+}
@@ -0,0 +1,9 @@
+// Matches struct FrameUniforms in frame_uniforms.h, bound at FRAME_UNIFORMS_BINDING
+layout(std140) uniform FrameUniforms
+{
+	mat4 view;
+	mat4 proj;
+	mat4 viewProj;
+	vec3 cameraPosition;
+	float time;
+};
\ No newline at end of file
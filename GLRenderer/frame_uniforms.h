@@ -0,0 +1,44 @@
+#pragma once
+
+// Per-frame constants shared by every program through one uniform buffer binding. Shaders declare
+//
+//	layout(std140) uniform FrameUniforms
+//	{
+//		mat4 view;
+//		mat4 proj;
+//		mat4 viewProj;
+//		vec3 cameraPosition;
+//		float time;
+//	};
+//
+// and the Shader constructor points the block at FRAME_UNIFORMS_BINDING, so nothing has to be
+// set per program.
+
+#define FRAME_UNIFORMS_BINDING 0
+
+struct FrameUniforms
+{
+	mat4 view;
+	mat4 proj;
+	mat4 viewProj;
+	vec3 cameraPosition;
+	float time;
+};
+
+// std140: mat4 is four vec4 columns aligned to 16 bytes, a vec3 is aligned to 16 bytes but only
+// takes 12, so a following float packs into its last 4 bytes. The block size rounds up to 16.
+static_assert(offsetof(FrameUniforms, view) == 0, "FrameUniforms::view breaks std140 layout");
+static_assert(offsetof(FrameUniforms, proj) == 64, "FrameUniforms::proj breaks std140 layout");
+static_assert(offsetof(FrameUniforms, viewProj) == 128, "FrameUniforms::viewProj breaks std140 layout");
+static_assert(offsetof(FrameUniforms, cameraPosition) == 192, "FrameUniforms::cameraPosition breaks std140 layout");
+static_assert(offsetof(FrameUniforms, time) == 204, "FrameUniforms::time breaks std140 layout");
+static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms size breaks std140 layout");
+
+static inline void initFrameUniforms(FrameUniforms& frameUniforms, const mat4& view, const mat4& proj, const vec3& cameraPosition, float time)
+{
+	frameUniforms.view = view;
+	frameUniforms.proj = proj;
+	frameUniforms.viewProj = proj * view;
+	frameUniforms.cameraPosition = cameraPosition;
+	frameUniforms.time = time;
+}
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "gl_intercept_entries.h"
+
+// Optional GL call counting. glad calls every entry point through a function pointer, so
+// installGLIntercept() swaps the pointer of every core entry point glad loaded, the list in
+// gl_intercept_entries.h, for a thunk that counts the call and forwards it. Nothing is swapped
+// unless it is installed, so a run without it calls the driver exactly as before. Calls only
+// count while intercepting, from the thread that owns the context.
+//
+// Per frame, between advanceGLInterceptFrame() calls, every entry point counts its calls and the
+// uploads total the bytes they hand the driver. Entry points flagged GL_INTERCEPT_QUERY read
+// state back; inside the frame loop they are reported as anti-patterns. Entry points flagged
+// GL_INTERCEPT_SYNC can block until the GPU catches up, the time spent in them is reported as
+// stalls.
+
+enum GLInterceptFlags
+{
+	GL_INTERCEPT_NONE = 0,
+	// Reads back from the driver, doesn't belong in the frame loop
+	GL_INTERCEPT_QUERY = 1,
+	// Can wait for the GPU
+	GL_INTERCEPT_SYNC = 2,
+};
+
+#define GL_INTERCEPT_ENUM(name) GL_INTERCEPT_##name,
+enum GLInterceptEntry
+{
+	GL_INTERCEPT_ENTRY_POINTS(GL_INTERCEPT_ENUM)
+	GL_INTERCEPT_ENTRY_COUNT,
+};
+#undef GL_INTERCEPT_ENUM
+
+#define GL_INTERCEPT_NAME(name) #name,
+static const char* const g_GLInterceptNames[GL_INTERCEPT_ENTRY_COUNT] =
+{
+	GL_INTERCEPT_ENTRY_POINTS(GL_INTERCEPT_NAME)
+};
+#undef GL_INTERCEPT_NAME
+
+static inline bool32 hasGLInterceptPrefix(const char* name, const char* prefix)
+{
+	return strncmp(name, prefix, strlen(prefix)) == 0;
+}
+
+// By name, so the generated list needs no annotations. The query objects' own reads are left
+// out on purpose: the GPU profiler polls GL_QUERY_RESULT_AVAILABLE, which doesn't wait.
+static inline u32 getGLInterceptEntryFlags(const char* name)
+{
+	if (strcmp(name, "glFinish") == 0 || strcmp(name, "glClientWaitSync") == 0)
+	{
+		return GL_INTERCEPT_SYNC;
+	}
+	if (hasGLInterceptPrefix(name, "glGetQueryObject") || hasGLInterceptPrefix(name, "glGetQueryBufferObject"))
+	{
+		return GL_INTERCEPT_NONE;
+	}
+	if (hasGLInterceptPrefix(name, "glGet") || hasGLInterceptPrefix(name, "glIs") || hasGLInterceptPrefix(name, "glCheck") ||
+		strcmp(name, "glReadPixels") == 0 || strcmp(name, "glReadnPixels") == 0)
+	{
+		return GL_INTERCEPT_QUERY;
+	}
+	return GL_INTERCEPT_NONE;
+}
+
+struct GLIntercept
+{
+	bool32 installed;
+	// Set by the first advanceGLInterceptFrame(), calls before that are loading
+	bool32 inFrameLoop;
+	u64 frameIndex;
+	// GLInterceptFlags of every entry point
+	u32 flags[GL_INTERCEPT_ENTRY_COUNT];
+
+	u32 frameCalls[GL_INTERCEPT_ENTRY_COUNT];
+	u64 frameUploadBytes;
+	u64 frameSyncNs;
+
+	// Since the last takeGLInterceptReport()
+	u64 reportCalls[GL_INTERCEPT_ENTRY_COUNT];
+	u64 reportUploadBytes;
+	u64 reportSyncNs;
+	u32 reportFrames;
+	u32 peakFrameCalls;
+
+	// Calls of GL_INTERCEPT_QUERY entry points inside the frame loop, over the whole run
+	u64 hotPathQueries[GL_INTERCEPT_ENTRY_COUNT];
+	// Time inside GL_INTERCEPT_SYNC entry points in the frame loop, over the whole run
+	u64 hotPathSyncNs;
+	u64 loadCalls[GL_INTERCEPT_ENTRY_COUNT];
+	u64 loadUploadBytes;
+};
+
+extern GLIntercept g_GLIntercept;
+
+static inline void countGLInterceptCall(GLIntercept& intercept, u32 entry, u64 uploadBytes)
+{
+	if (!intercept.inFrameLoop)
+	{
+		intercept.loadCalls[entry]++;
+		intercept.loadUploadBytes += uploadBytes;
+		return;
+	}
+
+	intercept.frameCalls[entry]++;
+	intercept.frameUploadBytes += uploadBytes;
+	if ((intercept.flags[entry] & GL_INTERCEPT_QUERY) && !intercept.hotPathQueries[entry]++)
+	{
+		printf("GL intercept: %s called inside the frame loop (frame %llu)\n", g_GLInterceptNames[entry], (unsigned long long)intercept.frameIndex);
+	}
+}
+
+// Bytes of one pixel as the client hands it over, unpack alignment aside
+static inline u64 getGLPixelBytes(GLenum format, GLenum type)
+{
+	switch (type)
+	{
+		case (GL_UNSIGNED_SHORT_5_6_5):
+		case (GL_UNSIGNED_SHORT_4_4_4_4):
+		case (GL_UNSIGNED_SHORT_5_5_5_1):
+		{
+			return 2;
+		} break;
+		case (GL_UNSIGNED_INT_8_8_8_8):
+		case (GL_UNSIGNED_INT_2_10_10_10_REV):
+		case (GL_UNSIGNED_INT_24_8):
+		case (GL_UNSIGNED_INT_10F_11F_11F_REV):
+		{
+			return 4;
+		} break;
+	}
+
+	u64 componentBytes = 1;
+	switch (type)
+	{
+		case (GL_SHORT):
+		case (GL_UNSIGNED_SHORT):
+		case (GL_HALF_FLOAT):
+		{
+			componentBytes = 2;
+		} break;
+		case (GL_INT):
+		case (GL_UNSIGNED_INT):
+		case (GL_FLOAT):
+		{
+			componentBytes = 4;
+		} break;
+	}
+
+	u64 componentCount = 1;
+	switch (format)
+	{
+		case (GL_RG):
+		case (GL_RG_INTEGER):
+		{
+			componentCount = 2;
+		} break;
+		case (GL_RGB):
+		case (GL_BGR):
+		case (GL_RGB_INTEGER):
+		{
+			componentCount = 3;
+		} break;
+		case (GL_RGBA):
+		case (GL_BGRA):
+		case (GL_RGBA_INTEGER):
+		{
+			componentCount = 4;
+		} break;
+	}
+	return componentBytes * componentCount;
+}
+
+// What an entry point uploads, by overload on its tag: the generic one uploads nothing
+template <u32 Entry>
+struct GLInterceptEntryTag {};
+
+template <u32 Entry, typename... Args>
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<Entry>, Args...)
+{
+	return 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glBufferData>, GLenum, GLsizeiptr size, const void* data, GLenum)
+{
+	return data ? u64(size) : 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glNamedBufferData>, GLuint, GLsizeiptr size, const void* data, GLenum)
+{
+	return data ? u64(size) : 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glBufferStorage>, GLenum, GLsizeiptr size, const void* data, GLbitfield)
+{
+	return data ? u64(size) : 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glBufferSubData>, GLenum, GLintptr, GLsizeiptr size, const void*)
+{
+	return u64(size);
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glNamedBufferSubData>, GLuint, GLintptr, GLsizeiptr size, const void*)
+{
+	return u64(size);
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glTexImage2D>, GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void* pixels)
+{
+	return pixels ? u64(width) * u64(height) * getGLPixelBytes(format, type) : 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glTexImage3D>, GLenum, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint, GLenum format, GLenum type, const void* pixels)
+{
+	return pixels ? u64(width) * u64(height) * u64(depth) * getGLPixelBytes(format, type) : 0;
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glTexSubImage2D>, GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*)
+{
+	return u64(width) * u64(height) * getGLPixelBytes(format, type);
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glTextureSubImage2D>, GLuint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*)
+{
+	return u64(width) * u64(height) * getGLPixelBytes(format, type);
+}
+
+static inline u64 getGLInterceptUploadBytes(GLInterceptEntryTag<GL_INTERCEPT_glTexSubImage3D>, GLenum, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void*)
+{
+	return u64(width) * u64(height) * u64(depth) * getGLPixelBytes(format, type);
+}
+
+// Times a GL_INTERCEPT_SYNC call until it goes out of scope, so the thunk can return whatever the
+// call returns, void included
+struct GLInterceptSyncTimer
+{
+	u64 beginNs;
+
+	~GLInterceptSyncTimer()
+	{
+		if (g_GLIntercept.inFrameLoop)
+		{
+			g_GLIntercept.frameSyncNs += getCpuProfilerNs() - beginNs;
+		}
+	}
+};
+
+// One per entry point: counts, then calls what glad had loaded
+template <u32 Entry, typename Function>
+struct GLInterceptThunk;
+
+template <u32 Entry, typename Return, typename... Args>
+struct GLInterceptThunk<Entry, Return (APIENTRYP)(Args...)>
+{
+	static Return (APIENTRYP original)(Args...);
+
+	static Return APIENTRY call(Args... args)
+	{
+		countGLInterceptCall(g_GLIntercept, Entry, getGLInterceptUploadBytes(GLInterceptEntryTag<Entry>(), args...));
+		if (!(g_GLIntercept.flags[Entry] & GL_INTERCEPT_SYNC))
+		{
+			return original(args...);
+		}
+		GLInterceptSyncTimer timer = { getCpuProfilerNs() };
+		return original(args...);
+	}
+};
+
+template <u32 Entry, typename Return, typename... Args>
+Return (APIENTRYP GLInterceptThunk<Entry, Return (APIENTRYP)(Args...)>::original)(Args...) = nullptr;
+
+// Call once, right after gladLoadGL. Entry points the driver doesn't have stay null. Every entry
+// point glad knows gets its thunk instantiated, which costs compile time, not run time.
+static inline void installGLIntercept(GLIntercept& intercept)
+{
+	assert(!intercept.installed);
+	memset(&intercept, 0, sizeof(intercept));
+	intercept.installed = true;
+
+#define GL_INTERCEPT_INSTALL(name) \
+	intercept.flags[GL_INTERCEPT_##name] = getGLInterceptEntryFlags(#name); \
+	if (glad_##name) \
+	{ \
+		GLInterceptThunk<GL_INTERCEPT_##name, decltype(glad_##name)>::original = glad_##name; \
+		glad_##name = &GLInterceptThunk<GL_INTERCEPT_##name, decltype(glad_##name)>::call; \
+	}
+	GL_INTERCEPT_ENTRY_POINTS(GL_INTERCEPT_INSTALL)
+#undef GL_INTERCEPT_INSTALL
+}
+
+// Call at the start of every frame: closes the previous one. Does nothing unless installed.
+static inline void advanceGLInterceptFrame(GLIntercept& intercept)
+{
+	if (!intercept.installed)
+	{
+		return;
+	}
+
+	if (intercept.inFrameLoop)
+	{
+		u32 frameCalls = 0;
+		for (u32 entry = 0; entry < GL_INTERCEPT_ENTRY_COUNT; entry++)
+		{
+			intercept.reportCalls[entry] += intercept.frameCalls[entry];
+			frameCalls += intercept.frameCalls[entry];
+		}
+		intercept.reportUploadBytes += intercept.frameUploadBytes;
+		intercept.reportSyncNs += intercept.frameSyncNs;
+		intercept.hotPathSyncNs += intercept.frameSyncNs;
+		intercept.reportFrames++;
+		intercept.peakFrameCalls = max(intercept.peakFrameCalls, frameCalls);
+		intercept.frameIndex++;
+	}
+	memset(intercept.frameCalls, 0, sizeof(intercept.frameCalls));
+	intercept.frameUploadBytes = 0;
+	intercept.frameSyncNs = 0;
+	intercept.inFrameLoop = true;
+}
+
+// Prints the per frame averages since the last report, busiest entry points first, and starts
+// the averages over
+static inline void takeGLInterceptReport(GLIntercept& intercept, u32 maxEntries)
+{
+	if (!intercept.installed || !intercept.reportFrames)
+	{
+		return;
+	}
+
+	u32 order[GL_INTERCEPT_ENTRY_COUNT];
+	u64 totalCalls = 0;
+	for (u32 entry = 0; entry < GL_INTERCEPT_ENTRY_COUNT; entry++)
+	{
+		order[entry] = entry;
+		totalCalls += intercept.reportCalls[entry];
+	}
+	std::sort(order, order + GL_INTERCEPT_ENTRY_COUNT, [&](u32 a, u32 b)
+	{
+		return intercept.reportCalls[a] > intercept.reportCalls[b];
+	});
+
+	float frames = float(intercept.reportFrames);
+	printf("GL calls: %.1f per frame (peak %u), %.2f KB uploaded per frame, %.3f ms per frame in sync calls\n", totalCalls / frames, intercept.peakFrameCalls, intercept.reportUploadBytes / frames / 1024.0f, intercept.reportSyncNs / frames / 1e6f);
+	for (u32 i = 0; i < maxEntries && i < GL_INTERCEPT_ENTRY_COUNT && intercept.reportCalls[order[i]]; i++)
+	{
+		printf("  %-36s %10.1f\n", g_GLInterceptNames[order[i]], intercept.reportCalls[order[i]] / frames);
+	}
+
+	memset(intercept.reportCalls, 0, sizeof(intercept.reportCalls));
+	intercept.reportUploadBytes = 0;
+	intercept.reportSyncNs = 0;
+	intercept.reportFrames = 0;
+	intercept.peakFrameCalls = 0;
+}
+
+// The loading totals and every query the frame loop made, for the end of a run
+static inline void printGLInterceptSummary(const GLIntercept& intercept)
+{
+	if (!intercept.installed)
+	{
+		return;
+	}
+
+	u64 loadCalls = 0;
+	for (u32 entry = 0; entry < GL_INTERCEPT_ENTRY_COUNT; entry++)
+	{
+		loadCalls += intercept.loadCalls[entry];
+	}
+	printf("GL intercept: %llu calls and %.2f MB uploaded before the first frame\n", (unsigned long long)loadCalls, intercept.loadUploadBytes / (1024.0 * 1024.0));
+	for (u32 entry = 0; entry < GL_INTERCEPT_ENTRY_COUNT; entry++)
+	{
+		if (intercept.hotPathQueries[entry])
+		{
+			printf("  %s called %llu times inside the frame loop over %llu frames\n", g_GLInterceptNames[entry], (unsigned long long)intercept.hotPathQueries[entry], (unsigned long long)intercept.frameIndex);
+		}
+	}
+	printf("  %.1f ms inside sync calls in the frame loop over %llu frames\n", intercept.hotPathSyncNs / 1e6, (unsigned long long)intercept.frameIndex);
+}
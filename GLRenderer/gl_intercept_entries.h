@@ -0,0 +1,1099 @@
+#pragma once
+
+// Every entry point of core GL 1.0 to 4.6 that glad loads, the list GL_INTERCEPT_ENTRY_POINTS in
+// gl_intercept.h iterates. Extension entry points are left out. Generated from glad, so after
+// regenerating glad run this from the repository root and paste its output below the #define:
+//   sed -n '/^static void load_GL_VERSION_/,/^}/s/.*load("\(gl[A-Za-z0-9_]*\)").*/\tX(\1) \\/p' external/glad/src/glad.c | sort -u
+#define GL_INTERCEPT_ENTRY_POINTS(X) \
+	X(glAccum) \
+	X(glActiveShaderProgram) \
+	X(glActiveTexture) \
+	X(glAlphaFunc) \
+	X(glAlphaFuncx) \
+	X(glAreTexturesResident) \
+	X(glArrayElement) \
+	X(glAttachShader) \
+	X(glBegin) \
+	X(glBeginConditionalRender) \
+	X(glBeginQuery) \
+	X(glBeginQueryIndexed) \
+	X(glBeginTransformFeedback) \
+	X(glBindAttribLocation) \
+	X(glBindBuffer) \
+	X(glBindBufferBase) \
+	X(glBindBufferRange) \
+	X(glBindBuffersBase) \
+	X(glBindBuffersRange) \
+	X(glBindFragDataLocation) \
+	X(glBindFragDataLocationIndexed) \
+	X(glBindFramebuffer) \
+	X(glBindImageTexture) \
+	X(glBindImageTextures) \
+	X(glBindProgramPipeline) \
+	X(glBindRenderbuffer) \
+	X(glBindSampler) \
+	X(glBindSamplers) \
+	X(glBindTexture) \
+	X(glBindTextureUnit) \
+	X(glBindTextures) \
+	X(glBindTransformFeedback) \
+	X(glBindVertexArray) \
+	X(glBindVertexBuffer) \
+	X(glBindVertexBuffers) \
+	X(glBitmap) \
+	X(glBlendColor) \
+	X(glBlendEquation) \
+	X(glBlendEquationSeparate) \
+	X(glBlendEquationSeparatei) \
+	X(glBlendEquationi) \
+	X(glBlendFunc) \
+	X(glBlendFuncSeparate) \
+	X(glBlendFuncSeparatei) \
+	X(glBlendFunci) \
+	X(glBlitFramebuffer) \
+	X(glBlitNamedFramebuffer) \
+	X(glBufferData) \
+	X(glBufferStorage) \
+	X(glBufferSubData) \
+	X(glCallList) \
+	X(glCallLists) \
+	X(glCheckFramebufferStatus) \
+	X(glCheckNamedFramebufferStatus) \
+	X(glClampColor) \
+	X(glClear) \
+	X(glClearAccum) \
+	X(glClearBufferData) \
+	X(glClearBufferSubData) \
+	X(glClearBufferfi) \
+	X(glClearBufferfv) \
+	X(glClearBufferiv) \
+	X(glClearBufferuiv) \
+	X(glClearColor) \
+	X(glClearColorx) \
+	X(glClearDepth) \
+	X(glClearDepthf) \
+	X(glClearDepthx) \
+	X(glClearIndex) \
+	X(glClearNamedBufferData) \
+	X(glClearNamedBufferSubData) \
+	X(glClearNamedFramebufferfi) \
+	X(glClearNamedFramebufferfv) \
+	X(glClearNamedFramebufferiv) \
+	X(glClearNamedFramebufferuiv) \
+	X(glClearStencil) \
+	X(glClearTexImage) \
+	X(glClearTexSubImage) \
+	X(glClientActiveTexture) \
+	X(glClientWaitSync) \
+	X(glClipControl) \
+	X(glClipPlane) \
+	X(glClipPlanef) \
+	X(glClipPlanex) \
+	X(glColor3b) \
+	X(glColor3bv) \
+	X(glColor3d) \
+	X(glColor3dv) \
+	X(glColor3f) \
+	X(glColor3fv) \
+	X(glColor3i) \
+	X(glColor3iv) \
+	X(glColor3s) \
+	X(glColor3sv) \
+	X(glColor3ub) \
+	X(glColor3ubv) \
+	X(glColor3ui) \
+	X(glColor3uiv) \
+	X(glColor3us) \
+	X(glColor3usv) \
+	X(glColor4b) \
+	X(glColor4bv) \
+	X(glColor4d) \
+	X(glColor4dv) \
+	X(glColor4f) \
+	X(glColor4fv) \
+	X(glColor4i) \
+	X(glColor4iv) \
+	X(glColor4s) \
+	X(glColor4sv) \
+	X(glColor4ub) \
+	X(glColor4ubv) \
+	X(glColor4ui) \
+	X(glColor4uiv) \
+	X(glColor4us) \
+	X(glColor4usv) \
+	X(glColor4x) \
+	X(glColorMask) \
+	X(glColorMaski) \
+	X(glColorMaterial) \
+	X(glColorP3ui) \
+	X(glColorP3uiv) \
+	X(glColorP4ui) \
+	X(glColorP4uiv) \
+	X(glColorPointer) \
+	X(glCompileShader) \
+	X(glCompressedTexImage1D) \
+	X(glCompressedTexImage2D) \
+	X(glCompressedTexImage3D) \
+	X(glCompressedTexSubImage1D) \
+	X(glCompressedTexSubImage2D) \
+	X(glCompressedTexSubImage3D) \
+	X(glCompressedTextureSubImage1D) \
+	X(glCompressedTextureSubImage2D) \
+	X(glCompressedTextureSubImage3D) \
+	X(glCopyBufferSubData) \
+	X(glCopyImageSubData) \
+	X(glCopyNamedBufferSubData) \
+	X(glCopyPixels) \
+	X(glCopyTexImage1D) \
+	X(glCopyTexImage2D) \
+	X(glCopyTexSubImage1D) \
+	X(glCopyTexSubImage2D) \
+	X(glCopyTexSubImage3D) \
+	X(glCopyTextureSubImage1D) \
+	X(glCopyTextureSubImage2D) \
+	X(glCopyTextureSubImage3D) \
+	X(glCreateBuffers) \
+	X(glCreateFramebuffers) \
+	X(glCreateProgram) \
+	X(glCreateProgramPipelines) \
+	X(glCreateQueries) \
+	X(glCreateRenderbuffers) \
+	X(glCreateSamplers) \
+	X(glCreateShader) \
+	X(glCreateShaderProgramv) \
+	X(glCreateTextures) \
+	X(glCreateTransformFeedbacks) \
+	X(glCreateVertexArrays) \
+	X(glCullFace) \
+	X(glDebugMessageCallback) \
+	X(glDebugMessageControl) \
+	X(glDebugMessageInsert) \
+	X(glDeleteBuffers) \
+	X(glDeleteFramebuffers) \
+	X(glDeleteLists) \
+	X(glDeleteProgram) \
+	X(glDeleteProgramPipelines) \
+	X(glDeleteQueries) \
+	X(glDeleteRenderbuffers) \
+	X(glDeleteSamplers) \
+	X(glDeleteShader) \
+	X(glDeleteSync) \
+	X(glDeleteTextures) \
+	X(glDeleteTransformFeedbacks) \
+	X(glDeleteVertexArrays) \
+	X(glDepthFunc) \
+	X(glDepthMask) \
+	X(glDepthRange) \
+	X(glDepthRangeArrayv) \
+	X(glDepthRangeIndexed) \
+	X(glDepthRangef) \
+	X(glDepthRangex) \
+	X(glDetachShader) \
+	X(glDisable) \
+	X(glDisableClientState) \
+	X(glDisableVertexArrayAttrib) \
+	X(glDisableVertexAttribArray) \
+	X(glDisablei) \
+	X(glDispatchCompute) \
+	X(glDispatchComputeIndirect) \
+	X(glDrawArrays) \
+	X(glDrawArraysIndirect) \
+	X(glDrawArraysInstanced) \
+	X(glDrawArraysInstancedBaseInstance) \
+	X(glDrawBuffer) \
+	X(glDrawBuffers) \
+	X(glDrawElements) \
+	X(glDrawElementsBaseVertex) \
+	X(glDrawElementsIndirect) \
+	X(glDrawElementsInstanced) \
+	X(glDrawElementsInstancedBaseInstance) \
+	X(glDrawElementsInstancedBaseVertex) \
+	X(glDrawElementsInstancedBaseVertexBaseInstance) \
+	X(glDrawPixels) \
+	X(glDrawRangeElements) \
+	X(glDrawRangeElementsBaseVertex) \
+	X(glDrawTransformFeedback) \
+	X(glDrawTransformFeedbackInstanced) \
+	X(glDrawTransformFeedbackStream) \
+	X(glDrawTransformFeedbackStreamInstanced) \
+	X(glEdgeFlag) \
+	X(glEdgeFlagPointer) \
+	X(glEdgeFlagv) \
+	X(glEnable) \
+	X(glEnableClientState) \
+	X(glEnableVertexArrayAttrib) \
+	X(glEnableVertexAttribArray) \
+	X(glEnablei) \
+	X(glEnd) \
+	X(glEndConditionalRender) \
+	X(glEndList) \
+	X(glEndQuery) \
+	X(glEndQueryIndexed) \
+	X(glEndTransformFeedback) \
+	X(glEvalCoord1d) \
+	X(glEvalCoord1dv) \
+	X(glEvalCoord1f) \
+	X(glEvalCoord1fv) \
+	X(glEvalCoord2d) \
+	X(glEvalCoord2dv) \
+	X(glEvalCoord2f) \
+	X(glEvalCoord2fv) \
+	X(glEvalMesh1) \
+	X(glEvalMesh2) \
+	X(glEvalPoint1) \
+	X(glEvalPoint2) \
+	X(glFeedbackBuffer) \
+	X(glFenceSync) \
+	X(glFinish) \
+	X(glFlush) \
+	X(glFlushMappedBufferRange) \
+	X(glFlushMappedNamedBufferRange) \
+	X(glFogCoordPointer) \
+	X(glFogCoordd) \
+	X(glFogCoorddv) \
+	X(glFogCoordf) \
+	X(glFogCoordfv) \
+	X(glFogf) \
+	X(glFogfv) \
+	X(glFogi) \
+	X(glFogiv) \
+	X(glFogx) \
+	X(glFogxv) \
+	X(glFramebufferParameteri) \
+	X(glFramebufferRenderbuffer) \
+	X(glFramebufferTexture) \
+	X(glFramebufferTexture1D) \
+	X(glFramebufferTexture2D) \
+	X(glFramebufferTexture3D) \
+	X(glFramebufferTextureLayer) \
+	X(glFrontFace) \
+	X(glFrustum) \
+	X(glFrustumf) \
+	X(glFrustumx) \
+	X(glGenBuffers) \
+	X(glGenFramebuffers) \
+	X(glGenLists) \
+	X(glGenProgramPipelines) \
+	X(glGenQueries) \
+	X(glGenRenderbuffers) \
+	X(glGenSamplers) \
+	X(glGenTextures) \
+	X(glGenTransformFeedbacks) \
+	X(glGenVertexArrays) \
+	X(glGenerateMipmap) \
+	X(glGenerateTextureMipmap) \
+	X(glGetActiveAtomicCounterBufferiv) \
+	X(glGetActiveAttrib) \
+	X(glGetActiveSubroutineName) \
+	X(glGetActiveSubroutineUniformName) \
+	X(glGetActiveSubroutineUniformiv) \
+	X(glGetActiveUniform) \
+	X(glGetActiveUniformBlockName) \
+	X(glGetActiveUniformBlockiv) \
+	X(glGetActiveUniformName) \
+	X(glGetActiveUniformsiv) \
+	X(glGetAttachedShaders) \
+	X(glGetAttribLocation) \
+	X(glGetBooleani_v) \
+	X(glGetBooleanv) \
+	X(glGetBufferParameteri64v) \
+	X(glGetBufferParameteriv) \
+	X(glGetBufferPointerv) \
+	X(glGetBufferSubData) \
+	X(glGetClipPlane) \
+	X(glGetClipPlanef) \
+	X(glGetClipPlanex) \
+	X(glGetCompressedTexImage) \
+	X(glGetCompressedTextureImage) \
+	X(glGetCompressedTextureSubImage) \
+	X(glGetDebugMessageLog) \
+	X(glGetDoublei_v) \
+	X(glGetDoublev) \
+	X(glGetError) \
+	X(glGetFixedv) \
+	X(glGetFloati_v) \
+	X(glGetFloatv) \
+	X(glGetFragDataIndex) \
+	X(glGetFragDataLocation) \
+	X(glGetFramebufferAttachmentParameteriv) \
+	X(glGetFramebufferParameteriv) \
+	X(glGetGraphicsResetStatus) \
+	X(glGetInteger64i_v) \
+	X(glGetInteger64v) \
+	X(glGetIntegeri_v) \
+	X(glGetIntegerv) \
+	X(glGetInternalformati64v) \
+	X(glGetInternalformativ) \
+	X(glGetLightfv) \
+	X(glGetLightiv) \
+	X(glGetLightxv) \
+	X(glGetMapdv) \
+	X(glGetMapfv) \
+	X(glGetMapiv) \
+	X(glGetMaterialfv) \
+	X(glGetMaterialiv) \
+	X(glGetMaterialxv) \
+	X(glGetMultisamplefv) \
+	X(glGetNamedBufferParameteri64v) \
+	X(glGetNamedBufferParameteriv) \
+	X(glGetNamedBufferPointerv) \
+	X(glGetNamedBufferSubData) \
+	X(glGetNamedFramebufferAttachmentParameteriv) \
+	X(glGetNamedFramebufferParameteriv) \
+	X(glGetNamedRenderbufferParameteriv) \
+	X(glGetObjectLabel) \
+	X(glGetObjectPtrLabel) \
+	X(glGetPixelMapfv) \
+	X(glGetPixelMapuiv) \
+	X(glGetPixelMapusv) \
+	X(glGetPointerv) \
+	X(glGetPolygonStipple) \
+	X(glGetProgramBinary) \
+	X(glGetProgramInfoLog) \
+	X(glGetProgramInterfaceiv) \
+	X(glGetProgramPipelineInfoLog) \
+	X(glGetProgramPipelineiv) \
+	X(glGetProgramResourceIndex) \
+	X(glGetProgramResourceLocation) \
+	X(glGetProgramResourceLocationIndex) \
+	X(glGetProgramResourceName) \
+	X(glGetProgramResourceiv) \
+	X(glGetProgramStageiv) \
+	X(glGetProgramiv) \
+	X(glGetQueryBufferObjecti64v) \
+	X(glGetQueryBufferObjectiv) \
+	X(glGetQueryBufferObjectui64v) \
+	X(glGetQueryBufferObjectuiv) \
+	X(glGetQueryIndexediv) \
+	X(glGetQueryObjecti64v) \
+	X(glGetQueryObjectiv) \
+	X(glGetQueryObjectui64v) \
+	X(glGetQueryObjectuiv) \
+	X(glGetQueryiv) \
+	X(glGetRenderbufferParameteriv) \
+	X(glGetSamplerParameterIiv) \
+	X(glGetSamplerParameterIuiv) \
+	X(glGetSamplerParameterfv) \
+	X(glGetSamplerParameteriv) \
+	X(glGetShaderInfoLog) \
+	X(glGetShaderPrecisionFormat) \
+	X(glGetShaderSource) \
+	X(glGetShaderiv) \
+	X(glGetString) \
+	X(glGetStringi) \
+	X(glGetSubroutineIndex) \
+	X(glGetSubroutineUniformLocation) \
+	X(glGetSynciv) \
+	X(glGetTexEnvfv) \
+	X(glGetTexEnviv) \
+	X(glGetTexEnvxv) \
+	X(glGetTexGendv) \
+	X(glGetTexGenfv) \
+	X(glGetTexGeniv) \
+	X(glGetTexImage) \
+	X(glGetTexLevelParameterfv) \
+	X(glGetTexLevelParameteriv) \
+	X(glGetTexParameterIiv) \
+	X(glGetTexParameterIuiv) \
+	X(glGetTexParameterfv) \
+	X(glGetTexParameteriv) \
+	X(glGetTexParameterxv) \
+	X(glGetTextureImage) \
+	X(glGetTextureLevelParameterfv) \
+	X(glGetTextureLevelParameteriv) \
+	X(glGetTextureParameterIiv) \
+	X(glGetTextureParameterIuiv) \
+	X(glGetTextureParameterfv) \
+	X(glGetTextureParameteriv) \
+	X(glGetTextureSubImage) \
+	X(glGetTransformFeedbackVarying) \
+	X(glGetTransformFeedbacki64_v) \
+	X(glGetTransformFeedbacki_v) \
+	X(glGetTransformFeedbackiv) \
+	X(glGetUniformBlockIndex) \
+	X(glGetUniformIndices) \
+	X(glGetUniformLocation) \
+	X(glGetUniformSubroutineuiv) \
+	X(glGetUniformdv) \
+	X(glGetUniformfv) \
+	X(glGetUniformiv) \
+	X(glGetUniformuiv) \
+	X(glGetVertexArrayIndexed64iv) \
+	X(glGetVertexArrayIndexediv) \
+	X(glGetVertexArrayiv) \
+	X(glGetVertexAttribIiv) \
+	X(glGetVertexAttribIuiv) \
+	X(glGetVertexAttribLdv) \
+	X(glGetVertexAttribPointerv) \
+	X(glGetVertexAttribdv) \
+	X(glGetVertexAttribfv) \
+	X(glGetVertexAttribiv) \
+	X(glGetnColorTable) \
+	X(glGetnCompressedTexImage) \
+	X(glGetnConvolutionFilter) \
+	X(glGetnHistogram) \
+	X(glGetnMapdv) \
+	X(glGetnMapfv) \
+	X(glGetnMapiv) \
+	X(glGetnMinmax) \
+	X(glGetnPixelMapfv) \
+	X(glGetnPixelMapuiv) \
+	X(glGetnPixelMapusv) \
+	X(glGetnPolygonStipple) \
+	X(glGetnSeparableFilter) \
+	X(glGetnTexImage) \
+	X(glGetnUniformdv) \
+	X(glGetnUniformfv) \
+	X(glGetnUniformiv) \
+	X(glGetnUniformuiv) \
+	X(glHint) \
+	X(glIndexMask) \
+	X(glIndexPointer) \
+	X(glIndexd) \
+	X(glIndexdv) \
+	X(glIndexf) \
+	X(glIndexfv) \
+	X(glIndexi) \
+	X(glIndexiv) \
+	X(glIndexs) \
+	X(glIndexsv) \
+	X(glIndexub) \
+	X(glIndexubv) \
+	X(glInitNames) \
+	X(glInterleavedArrays) \
+	X(glInvalidateBufferData) \
+	X(glInvalidateBufferSubData) \
+	X(glInvalidateFramebuffer) \
+	X(glInvalidateNamedFramebufferData) \
+	X(glInvalidateNamedFramebufferSubData) \
+	X(glInvalidateSubFramebuffer) \
+	X(glInvalidateTexImage) \
+	X(glInvalidateTexSubImage) \
+	X(glIsBuffer) \
+	X(glIsEnabled) \
+	X(glIsEnabledi) \
+	X(glIsFramebuffer) \
+	X(glIsList) \
+	X(glIsProgram) \
+	X(glIsProgramPipeline) \
+	X(glIsQuery) \
+	X(glIsRenderbuffer) \
+	X(glIsSampler) \
+	X(glIsShader) \
+	X(glIsSync) \
+	X(glIsTexture) \
+	X(glIsTransformFeedback) \
+	X(glIsVertexArray) \
+	X(glLightModelf) \
+	X(glLightModelfv) \
+	X(glLightModeli) \
+	X(glLightModeliv) \
+	X(glLightModelx) \
+	X(glLightModelxv) \
+	X(glLightf) \
+	X(glLightfv) \
+	X(glLighti) \
+	X(glLightiv) \
+	X(glLightx) \
+	X(glLightxv) \
+	X(glLineStipple) \
+	X(glLineWidth) \
+	X(glLineWidthx) \
+	X(glLinkProgram) \
+	X(glListBase) \
+	X(glLoadIdentity) \
+	X(glLoadMatrixd) \
+	X(glLoadMatrixf) \
+	X(glLoadMatrixx) \
+	X(glLoadName) \
+	X(glLoadTransposeMatrixd) \
+	X(glLoadTransposeMatrixf) \
+	X(glLogicOp) \
+	X(glMap1d) \
+	X(glMap1f) \
+	X(glMap2d) \
+	X(glMap2f) \
+	X(glMapBuffer) \
+	X(glMapBufferRange) \
+	X(glMapGrid1d) \
+	X(glMapGrid1f) \
+	X(glMapGrid2d) \
+	X(glMapGrid2f) \
+	X(glMapNamedBuffer) \
+	X(glMapNamedBufferRange) \
+	X(glMaterialf) \
+	X(glMaterialfv) \
+	X(glMateriali) \
+	X(glMaterialiv) \
+	X(glMaterialx) \
+	X(glMaterialxv) \
+	X(glMatrixMode) \
+	X(glMemoryBarrier) \
+	X(glMemoryBarrierByRegion) \
+	X(glMinSampleShading) \
+	X(glMultMatrixd) \
+	X(glMultMatrixf) \
+	X(glMultMatrixx) \
+	X(glMultTransposeMatrixd) \
+	X(glMultTransposeMatrixf) \
+	X(glMultiDrawArrays) \
+	X(glMultiDrawArraysIndirect) \
+	X(glMultiDrawArraysIndirectCount) \
+	X(glMultiDrawElements) \
+	X(glMultiDrawElementsBaseVertex) \
+	X(glMultiDrawElementsIndirect) \
+	X(glMultiDrawElementsIndirectCount) \
+	X(glMultiTexCoord1d) \
+	X(glMultiTexCoord1dv) \
+	X(glMultiTexCoord1f) \
+	X(glMultiTexCoord1fv) \
+	X(glMultiTexCoord1i) \
+	X(glMultiTexCoord1iv) \
+	X(glMultiTexCoord1s) \
+	X(glMultiTexCoord1sv) \
+	X(glMultiTexCoord2d) \
+	X(glMultiTexCoord2dv) \
+	X(glMultiTexCoord2f) \
+	X(glMultiTexCoord2fv) \
+	X(glMultiTexCoord2i) \
+	X(glMultiTexCoord2iv) \
+	X(glMultiTexCoord2s) \
+	X(glMultiTexCoord2sv) \
+	X(glMultiTexCoord3d) \
+	X(glMultiTexCoord3dv) \
+	X(glMultiTexCoord3f) \
+	X(glMultiTexCoord3fv) \
+	X(glMultiTexCoord3i) \
+	X(glMultiTexCoord3iv) \
+	X(glMultiTexCoord3s) \
+	X(glMultiTexCoord3sv) \
+	X(glMultiTexCoord4d) \
+	X(glMultiTexCoord4dv) \
+	X(glMultiTexCoord4f) \
+	X(glMultiTexCoord4fv) \
+	X(glMultiTexCoord4i) \
+	X(glMultiTexCoord4iv) \
+	X(glMultiTexCoord4s) \
+	X(glMultiTexCoord4sv) \
+	X(glMultiTexCoord4x) \
+	X(glMultiTexCoordP1ui) \
+	X(glMultiTexCoordP1uiv) \
+	X(glMultiTexCoordP2ui) \
+	X(glMultiTexCoordP2uiv) \
+	X(glMultiTexCoordP3ui) \
+	X(glMultiTexCoordP3uiv) \
+	X(glMultiTexCoordP4ui) \
+	X(glMultiTexCoordP4uiv) \
+	X(glNamedBufferData) \
+	X(glNamedBufferStorage) \
+	X(glNamedBufferSubData) \
+	X(glNamedFramebufferDrawBuffer) \
+	X(glNamedFramebufferDrawBuffers) \
+	X(glNamedFramebufferParameteri) \
+	X(glNamedFramebufferReadBuffer) \
+	X(glNamedFramebufferRenderbuffer) \
+	X(glNamedFramebufferTexture) \
+	X(glNamedFramebufferTextureLayer) \
+	X(glNamedRenderbufferStorage) \
+	X(glNamedRenderbufferStorageMultisample) \
+	X(glNewList) \
+	X(glNormal3b) \
+	X(glNormal3bv) \
+	X(glNormal3d) \
+	X(glNormal3dv) \
+	X(glNormal3f) \
+	X(glNormal3fv) \
+	X(glNormal3i) \
+	X(glNormal3iv) \
+	X(glNormal3s) \
+	X(glNormal3sv) \
+	X(glNormal3x) \
+	X(glNormalP3ui) \
+	X(glNormalP3uiv) \
+	X(glNormalPointer) \
+	X(glObjectLabel) \
+	X(glObjectPtrLabel) \
+	X(glOrtho) \
+	X(glOrthof) \
+	X(glOrthox) \
+	X(glPassThrough) \
+	X(glPatchParameterfv) \
+	X(glPatchParameteri) \
+	X(glPauseTransformFeedback) \
+	X(glPixelMapfv) \
+	X(glPixelMapuiv) \
+	X(glPixelMapusv) \
+	X(glPixelStoref) \
+	X(glPixelStorei) \
+	X(glPixelTransferf) \
+	X(glPixelTransferi) \
+	X(glPixelZoom) \
+	X(glPointParameterf) \
+	X(glPointParameterfv) \
+	X(glPointParameteri) \
+	X(glPointParameteriv) \
+	X(glPointParameterx) \
+	X(glPointParameterxv) \
+	X(glPointSize) \
+	X(glPointSizex) \
+	X(glPolygonMode) \
+	X(glPolygonOffset) \
+	X(glPolygonOffsetClamp) \
+	X(glPolygonOffsetx) \
+	X(glPolygonStipple) \
+	X(glPopAttrib) \
+	X(glPopClientAttrib) \
+	X(glPopDebugGroup) \
+	X(glPopMatrix) \
+	X(glPopName) \
+	X(glPrimitiveRestartIndex) \
+	X(glPrioritizeTextures) \
+	X(glProgramBinary) \
+	X(glProgramParameteri) \
+	X(glProgramUniform1d) \
+	X(glProgramUniform1dv) \
+	X(glProgramUniform1f) \
+	X(glProgramUniform1fv) \
+	X(glProgramUniform1i) \
+	X(glProgramUniform1iv) \
+	X(glProgramUniform1ui) \
+	X(glProgramUniform1uiv) \
+	X(glProgramUniform2d) \
+	X(glProgramUniform2dv) \
+	X(glProgramUniform2f) \
+	X(glProgramUniform2fv) \
+	X(glProgramUniform2i) \
+	X(glProgramUniform2iv) \
+	X(glProgramUniform2ui) \
+	X(glProgramUniform2uiv) \
+	X(glProgramUniform3d) \
+	X(glProgramUniform3dv) \
+	X(glProgramUniform3f) \
+	X(glProgramUniform3fv) \
+	X(glProgramUniform3i) \
+	X(glProgramUniform3iv) \
+	X(glProgramUniform3ui) \
+	X(glProgramUniform3uiv) \
+	X(glProgramUniform4d) \
+	X(glProgramUniform4dv) \
+	X(glProgramUniform4f) \
+	X(glProgramUniform4fv) \
+	X(glProgramUniform4i) \
+	X(glProgramUniform4iv) \
+	X(glProgramUniform4ui) \
+	X(glProgramUniform4uiv) \
+	X(glProgramUniformMatrix2dv) \
+	X(glProgramUniformMatrix2fv) \
+	X(glProgramUniformMatrix2x3dv) \
+	X(glProgramUniformMatrix2x3fv) \
+	X(glProgramUniformMatrix2x4dv) \
+	X(glProgramUniformMatrix2x4fv) \
+	X(glProgramUniformMatrix3dv) \
+	X(glProgramUniformMatrix3fv) \
+	X(glProgramUniformMatrix3x2dv) \
+	X(glProgramUniformMatrix3x2fv) \
+	X(glProgramUniformMatrix3x4dv) \
+	X(glProgramUniformMatrix3x4fv) \
+	X(glProgramUniformMatrix4dv) \
+	X(glProgramUniformMatrix4fv) \
+	X(glProgramUniformMatrix4x2dv) \
+	X(glProgramUniformMatrix4x2fv) \
+	X(glProgramUniformMatrix4x3dv) \
+	X(glProgramUniformMatrix4x3fv) \
+	X(glProvokingVertex) \
+	X(glPushAttrib) \
+	X(glPushClientAttrib) \
+	X(glPushDebugGroup) \
+	X(glPushMatrix) \
+	X(glPushName) \
+	X(glQueryCounter) \
+	X(glRasterPos2d) \
+	X(glRasterPos2dv) \
+	X(glRasterPos2f) \
+	X(glRasterPos2fv) \
+	X(glRasterPos2i) \
+	X(glRasterPos2iv) \
+	X(glRasterPos2s) \
+	X(glRasterPos2sv) \
+	X(glRasterPos3d) \
+	X(glRasterPos3dv) \
+	X(glRasterPos3f) \
+	X(glRasterPos3fv) \
+	X(glRasterPos3i) \
+	X(glRasterPos3iv) \
+	X(glRasterPos3s) \
+	X(glRasterPos3sv) \
+	X(glRasterPos4d) \
+	X(glRasterPos4dv) \
+	X(glRasterPos4f) \
+	X(glRasterPos4fv) \
+	X(glRasterPos4i) \
+	X(glRasterPos4iv) \
+	X(glRasterPos4s) \
+	X(glRasterPos4sv) \
+	X(glReadBuffer) \
+	X(glReadPixels) \
+	X(glReadnPixels) \
+	X(glRectd) \
+	X(glRectdv) \
+	X(glRectf) \
+	X(glRectfv) \
+	X(glRecti) \
+	X(glRectiv) \
+	X(glRects) \
+	X(glRectsv) \
+	X(glReleaseShaderCompiler) \
+	X(glRenderMode) \
+	X(glRenderbufferStorage) \
+	X(glRenderbufferStorageMultisample) \
+	X(glResumeTransformFeedback) \
+	X(glRotated) \
+	X(glRotatef) \
+	X(glRotatex) \
+	X(glSampleCoverage) \
+	X(glSampleCoveragex) \
+	X(glSampleMaski) \
+	X(glSamplerParameterIiv) \
+	X(glSamplerParameterIuiv) \
+	X(glSamplerParameterf) \
+	X(glSamplerParameterfv) \
+	X(glSamplerParameteri) \
+	X(glSamplerParameteriv) \
+	X(glScaled) \
+	X(glScalef) \
+	X(glScalex) \
+	X(glScissor) \
+	X(glScissorArrayv) \
+	X(glScissorIndexed) \
+	X(glScissorIndexedv) \
+	X(glSecondaryColor3b) \
+	X(glSecondaryColor3bv) \
+	X(glSecondaryColor3d) \
+	X(glSecondaryColor3dv) \
+	X(glSecondaryColor3f) \
+	X(glSecondaryColor3fv) \
+	X(glSecondaryColor3i) \
+	X(glSecondaryColor3iv) \
+	X(glSecondaryColor3s) \
+	X(glSecondaryColor3sv) \
+	X(glSecondaryColor3ub) \
+	X(glSecondaryColor3ubv) \
+	X(glSecondaryColor3ui) \
+	X(glSecondaryColor3uiv) \
+	X(glSecondaryColor3us) \
+	X(glSecondaryColor3usv) \
+	X(glSecondaryColorP3ui) \
+	X(glSecondaryColorP3uiv) \
+	X(glSecondaryColorPointer) \
+	X(glSelectBuffer) \
+	X(glShadeModel) \
+	X(glShaderBinary) \
+	X(glShaderSource) \
+	X(glShaderStorageBlockBinding) \
+	X(glSpecializeShader) \
+	X(glStencilFunc) \
+	X(glStencilFuncSeparate) \
+	X(glStencilMask) \
+	X(glStencilMaskSeparate) \
+	X(glStencilOp) \
+	X(glStencilOpSeparate) \
+	X(glTexBuffer) \
+	X(glTexBufferRange) \
+	X(glTexCoord1d) \
+	X(glTexCoord1dv) \
+	X(glTexCoord1f) \
+	X(glTexCoord1fv) \
+	X(glTexCoord1i) \
+	X(glTexCoord1iv) \
+	X(glTexCoord1s) \
+	X(glTexCoord1sv) \
+	X(glTexCoord2d) \
+	X(glTexCoord2dv) \
+	X(glTexCoord2f) \
+	X(glTexCoord2fv) \
+	X(glTexCoord2i) \
+	X(glTexCoord2iv) \
+	X(glTexCoord2s) \
+	X(glTexCoord2sv) \
+	X(glTexCoord3d) \
+	X(glTexCoord3dv) \
+	X(glTexCoord3f) \
+	X(glTexCoord3fv) \
+	X(glTexCoord3i) \
+	X(glTexCoord3iv) \
+	X(glTexCoord3s) \
+	X(glTexCoord3sv) \
+	X(glTexCoord4d) \
+	X(glTexCoord4dv) \
+	X(glTexCoord4f) \
+	X(glTexCoord4fv) \
+	X(glTexCoord4i) \
+	X(glTexCoord4iv) \
+	X(glTexCoord4s) \
+	X(glTexCoord4sv) \
+	X(glTexCoordP1ui) \
+	X(glTexCoordP1uiv) \
+	X(glTexCoordP2ui) \
+	X(glTexCoordP2uiv) \
+	X(glTexCoordP3ui) \
+	X(glTexCoordP3uiv) \
+	X(glTexCoordP4ui) \
+	X(glTexCoordP4uiv) \
+	X(glTexCoordPointer) \
+	X(glTexEnvf) \
+	X(glTexEnvfv) \
+	X(glTexEnvi) \
+	X(glTexEnviv) \
+	X(glTexEnvx) \
+	X(glTexEnvxv) \
+	X(glTexGend) \
+	X(glTexGendv) \
+	X(glTexGenf) \
+	X(glTexGenfv) \
+	X(glTexGeni) \
+	X(glTexGeniv) \
+	X(glTexImage1D) \
+	X(glTexImage2D) \
+	X(glTexImage2DMultisample) \
+	X(glTexImage3D) \
+	X(glTexImage3DMultisample) \
+	X(glTexParameterIiv) \
+	X(glTexParameterIuiv) \
+	X(glTexParameterf) \
+	X(glTexParameterfv) \
+	X(glTexParameteri) \
+	X(glTexParameteriv) \
+	X(glTexParameterx) \
+	X(glTexParameterxv) \
+	X(glTexStorage1D) \
+	X(glTexStorage2D) \
+	X(glTexStorage2DMultisample) \
+	X(glTexStorage3D) \
+	X(glTexStorage3DMultisample) \
+	X(glTexSubImage1D) \
+	X(glTexSubImage2D) \
+	X(glTexSubImage3D) \
+	X(glTextureBarrier) \
+	X(glTextureBuffer) \
+	X(glTextureBufferRange) \
+	X(glTextureParameterIiv) \
+	X(glTextureParameterIuiv) \
+	X(glTextureParameterf) \
+	X(glTextureParameterfv) \
+	X(glTextureParameteri) \
+	X(glTextureParameteriv) \
+	X(glTextureStorage1D) \
+	X(glTextureStorage2D) \
+	X(glTextureStorage2DMultisample) \
+	X(glTextureStorage3D) \
+	X(glTextureStorage3DMultisample) \
+	X(glTextureSubImage1D) \
+	X(glTextureSubImage2D) \
+	X(glTextureSubImage3D) \
+	X(glTextureView) \
+	X(glTransformFeedbackBufferBase) \
+	X(glTransformFeedbackBufferRange) \
+	X(glTransformFeedbackVaryings) \
+	X(glTranslated) \
+	X(glTranslatef) \
+	X(glTranslatex) \
+	X(glUniform1d) \
+	X(glUniform1dv) \
+	X(glUniform1f) \
+	X(glUniform1fv) \
+	X(glUniform1i) \
+	X(glUniform1iv) \
+	X(glUniform1ui) \
+	X(glUniform1uiv) \
+	X(glUniform2d) \
+	X(glUniform2dv) \
+	X(glUniform2f) \
+	X(glUniform2fv) \
+	X(glUniform2i) \
+	X(glUniform2iv) \
+	X(glUniform2ui) \
+	X(glUniform2uiv) \
+	X(glUniform3d) \
+	X(glUniform3dv) \
+	X(glUniform3f) \
+	X(glUniform3fv) \
+	X(glUniform3i) \
+	X(glUniform3iv) \
+	X(glUniform3ui) \
+	X(glUniform3uiv) \
+	X(glUniform4d) \
+	X(glUniform4dv) \
+	X(glUniform4f) \
+	X(glUniform4fv) \
+	X(glUniform4i) \
+	X(glUniform4iv) \
+	X(glUniform4ui) \
+	X(glUniform4uiv) \
+	X(glUniformBlockBinding) \
+	X(glUniformMatrix2dv) \
+	X(glUniformMatrix2fv) \
+	X(glUniformMatrix2x3dv) \
+	X(glUniformMatrix2x3fv) \
+	X(glUniformMatrix2x4dv) \
+	X(glUniformMatrix2x4fv) \
+	X(glUniformMatrix3dv) \
+	X(glUniformMatrix3fv) \
+	X(glUniformMatrix3x2dv) \
+	X(glUniformMatrix3x2fv) \
+	X(glUniformMatrix3x4dv) \
+	X(glUniformMatrix3x4fv) \
+	X(glUniformMatrix4dv) \
+	X(glUniformMatrix4fv) \
+	X(glUniformMatrix4x2dv) \
+	X(glUniformMatrix4x2fv) \
+	X(glUniformMatrix4x3dv) \
+	X(glUniformMatrix4x3fv) \
+	X(glUniformSubroutinesuiv) \
+	X(glUnmapBuffer) \
+	X(glUnmapNamedBuffer) \
+	X(glUseProgram) \
+	X(glUseProgramStages) \
+	X(glValidateProgram) \
+	X(glValidateProgramPipeline) \
+	X(glVertex2d) \
+	X(glVertex2dv) \
+	X(glVertex2f) \
+	X(glVertex2fv) \
+	X(glVertex2i) \
+	X(glVertex2iv) \
+	X(glVertex2s) \
+	X(glVertex2sv) \
+	X(glVertex3d) \
+	X(glVertex3dv) \
+	X(glVertex3f) \
+	X(glVertex3fv) \
+	X(glVertex3i) \
+	X(glVertex3iv) \
+	X(glVertex3s) \
+	X(glVertex3sv) \
+	X(glVertex4d) \
+	X(glVertex4dv) \
+	X(glVertex4f) \
+	X(glVertex4fv) \
+	X(glVertex4i) \
+	X(glVertex4iv) \
+	X(glVertex4s) \
+	X(glVertex4sv) \
+	X(glVertexArrayAttribBinding) \
+	X(glVertexArrayAttribFormat) \
+	X(glVertexArrayAttribIFormat) \
+	X(glVertexArrayAttribLFormat) \
+	X(glVertexArrayBindingDivisor) \
+	X(glVertexArrayElementBuffer) \
+	X(glVertexArrayVertexBuffer) \
+	X(glVertexArrayVertexBuffers) \
+	X(glVertexAttrib1d) \
+	X(glVertexAttrib1dv) \
+	X(glVertexAttrib1f) \
+	X(glVertexAttrib1fv) \
+	X(glVertexAttrib1s) \
+	X(glVertexAttrib1sv) \
+	X(glVertexAttrib2d) \
+	X(glVertexAttrib2dv) \
+	X(glVertexAttrib2f) \
+	X(glVertexAttrib2fv) \
+	X(glVertexAttrib2s) \
+	X(glVertexAttrib2sv) \
+	X(glVertexAttrib3d) \
+	X(glVertexAttrib3dv) \
+	X(glVertexAttrib3f) \
+	X(glVertexAttrib3fv) \
+	X(glVertexAttrib3s) \
+	X(glVertexAttrib3sv) \
+	X(glVertexAttrib4Nbv) \
+	X(glVertexAttrib4Niv) \
+	X(glVertexAttrib4Nsv) \
+	X(glVertexAttrib4Nub) \
+	X(glVertexAttrib4Nubv) \
+	X(glVertexAttrib4Nuiv) \
+	X(glVertexAttrib4Nusv) \
+	X(glVertexAttrib4bv) \
+	X(glVertexAttrib4d) \
+	X(glVertexAttrib4dv) \
+	X(glVertexAttrib4f) \
+	X(glVertexAttrib4fv) \
+	X(glVertexAttrib4iv) \
+	X(glVertexAttrib4s) \
+	X(glVertexAttrib4sv) \
+	X(glVertexAttrib4ubv) \
+	X(glVertexAttrib4uiv) \
+	X(glVertexAttrib4usv) \
+	X(glVertexAttribBinding) \
+	X(glVertexAttribDivisor) \
+	X(glVertexAttribFormat) \
+	X(glVertexAttribI1i) \
+	X(glVertexAttribI1iv) \
+	X(glVertexAttribI1ui) \
+	X(glVertexAttribI1uiv) \
+	X(glVertexAttribI2i) \
+	X(glVertexAttribI2iv) \
+	X(glVertexAttribI2ui) \
+	X(glVertexAttribI2uiv) \
+	X(glVertexAttribI3i) \
+	X(glVertexAttribI3iv) \
+	X(glVertexAttribI3ui) \
+	X(glVertexAttribI3uiv) \
+	X(glVertexAttribI4bv) \
+	X(glVertexAttribI4i) \
+	X(glVertexAttribI4iv) \
+	X(glVertexAttribI4sv) \
+	X(glVertexAttribI4ubv) \
+	X(glVertexAttribI4ui) \
+	X(glVertexAttribI4uiv) \
+	X(glVertexAttribI4usv) \
+	X(glVertexAttribIFormat) \
+	X(glVertexAttribIPointer) \
+	X(glVertexAttribL1d) \
+	X(glVertexAttribL1dv) \
+	X(glVertexAttribL2d) \
+	X(glVertexAttribL2dv) \
+	X(glVertexAttribL3d) \
+	X(glVertexAttribL3dv) \
+	X(glVertexAttribL4d) \
+	X(glVertexAttribL4dv) \
+	X(glVertexAttribLFormat) \
+	X(glVertexAttribLPointer) \
+	X(glVertexAttribP1ui) \
+	X(glVertexAttribP1uiv) \
+	X(glVertexAttribP2ui) \
+	X(glVertexAttribP2uiv) \
+	X(glVertexAttribP3ui) \
+	X(glVertexAttribP3uiv) \
+	X(glVertexAttribP4ui) \
+	X(glVertexAttribP4uiv) \
+	X(glVertexAttribPointer) \
+	X(glVertexBindingDivisor) \
+	X(glVertexP2ui) \
+	X(glVertexP2uiv) \
+	X(glVertexP3ui) \
+	X(glVertexP3uiv) \
+	X(glVertexP4ui) \
+	X(glVertexP4uiv) \
+	X(glVertexPointer) \
+	X(glViewport) \
+	X(glViewportArrayv) \
+	X(glViewportIndexedf) \
+	X(glViewportIndexedfv) \
+	X(glWaitSync) \
+	X(glWindowPos2d) \
+	X(glWindowPos2dv) \
+	X(glWindowPos2f) \
+	X(glWindowPos2fv) \
+	X(glWindowPos2i) \
+	X(glWindowPos2iv) \
+	X(glWindowPos2s) \
+	X(glWindowPos2sv) \
+	X(glWindowPos3d) \
+	X(glWindowPos3dv) \
+	X(glWindowPos3f) \
+	X(glWindowPos3fv) \
+	X(glWindowPos3i) \
+	X(glWindowPos3iv) \
+	X(glWindowPos3s) \
+	X(glWindowPos3sv) \
+
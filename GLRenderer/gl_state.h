@@ -0,0 +1,451 @@
+#pragma once
+
+// Shadow copy of the GL binding state. Every program, vertex array, texture, buffer and
+// renderbuffer bind in the renderer goes through here, as do the blend function and the clear
+// color, so a call that wouldn't change anything never reaches the driver. Deleting an object
+// goes through here too, GL unbinds it and the cache has to follow. That only holds as long as
+// nothing binds behind its back: code that calls glBind* directly has to call
+// invalidateGLState() afterwards.
+
+#define GL_STATE_TEXTURE_UNITS 16
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+
+enum GLStateTextureTarget
+{
+	GL_STATE_TEXTURE_2D,
+	GL_STATE_TEXTURE_2D_ARRAY,
+	GL_STATE_TEXTURE_CUBE_MAP,
+	GL_STATE_TEXTURE_TARGET_COUNT,
+};
+
+enum GLStateBufferTarget
+{
+	GL_STATE_ARRAY_BUFFER,
+	GL_STATE_DISPATCH_INDIRECT_BUFFER,
+	GL_STATE_BUFFER_TARGET_COUNT,
+};
+
+enum GLStateCapability
+{
+	GL_STATE_BLEND,
+	GL_STATE_DEPTH_TEST,
+	GL_STATE_CULL_FACE,
+	GL_STATE_CAPABILITY_COUNT,
+};
+
+struct GLStateCache
+{
+	u32 program;
+	u32 pipeline;
+	u32 vertexArray;
+	u32 framebuffer;
+	u32 renderbuffer;
+	u32 activeTexture;
+	u32 textures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGET_COUNT];
+	u32 buffers[GL_STATE_BUFFER_TARGET_COUNT];
+	u32 capabilities[GL_STATE_CAPABILITY_COUNT];
+	int viewport[4];
+	u32 blendFunc[2];
+	// NaN while unknown, it compares unequal to any color
+	float clearColor[4];
+
+	// Since the last takeGLStateStats()
+	u32 issuedCalls;
+	u32 filteredCalls;
+};
+
+// Forgets everything, the next bind of each kind always reaches the driver
+static inline void invalidateGLState(GLStateCache& state)
+{
+	state.program = GL_STATE_UNKNOWN;
+	state.pipeline = GL_STATE_UNKNOWN;
+	state.vertexArray = GL_STATE_UNKNOWN;
+	state.framebuffer = GL_STATE_UNKNOWN;
+	state.renderbuffer = GL_STATE_UNKNOWN;
+	state.activeTexture = GL_STATE_UNKNOWN;
+	for (u32 unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+	{
+		for (u32 target = 0; target < GL_STATE_TEXTURE_TARGET_COUNT; target++)
+		{
+			state.textures[unit][target] = GL_STATE_UNKNOWN;
+		}
+	}
+	for (u32 target = 0; target < GL_STATE_BUFFER_TARGET_COUNT; target++)
+	{
+		state.buffers[target] = GL_STATE_UNKNOWN;
+	}
+	for (u32 capability = 0; capability < GL_STATE_CAPABILITY_COUNT; capability++)
+	{
+		state.capabilities[capability] = GL_STATE_UNKNOWN;
+	}
+	state.viewport[0] = state.viewport[1] = state.viewport[2] = state.viewport[3] = -1;
+	state.blendFunc[0] = state.blendFunc[1] = GL_STATE_UNKNOWN;
+	state.clearColor[0] = state.clearColor[1] = state.clearColor[2] = state.clearColor[3] = NAN;
+}
+
+static inline void initGLState(GLStateCache& state)
+{
+	invalidateGLState(state);
+	state.issuedCalls = 0;
+	state.filteredCalls = 0;
+}
+
+// Returns true when the call has to be issued
+static inline bool32 updateGLState(GLStateCache& state, u32& cached, u32 value)
+{
+	if (cached == value)
+	{
+		state.filteredCalls++;
+		return false;
+	}
+	cached = value;
+	state.issuedCalls++;
+	return true;
+}
+
+static inline void setGLProgram(GLStateCache& state, u32 program)
+{
+	if (updateGLState(state, state.program, program))
+	{
+		glUseProgram(program);
+	}
+}
+
+static inline void setGLProgramPipeline(GLStateCache& state, u32 pipeline)
+{
+	if (updateGLState(state, state.pipeline, pipeline))
+	{
+		glBindProgramPipeline(pipeline);
+	}
+}
+
+static inline void setGLVertexArray(GLStateCache& state, u32 vertexArray)
+{
+	if (updateGLState(state, state.vertexArray, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+	}
+}
+
+static inline void setGLFramebuffer(GLStateCache& state, u32 framebuffer)
+{
+	if (updateGLState(state, state.framebuffer, framebuffer))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+}
+
+static inline void setGLRenderbuffer(GLStateCache& state, u32 renderbuffer)
+{
+	if (updateGLState(state, state.renderbuffer, renderbuffer))
+	{
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+	}
+}
+
+static inline void setGLActiveTexture(GLStateCache& state, u32 unit)
+{
+	if (updateGLState(state, state.activeTexture, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+}
+
+static inline u32 getGLStateTextureTarget(u32 target)
+{
+	switch (target)
+	{
+		case (GL_TEXTURE_2D):
+		{
+			return GL_STATE_TEXTURE_2D;
+		} break;
+		case (GL_TEXTURE_2D_ARRAY):
+		{
+			return GL_STATE_TEXTURE_2D_ARRAY;
+		} break;
+		case (GL_TEXTURE_CUBE_MAP):
+		{
+			return GL_STATE_TEXTURE_CUBE_MAP;
+		} break;
+	}
+	assert(!"Texture target not tracked by the GL state cache");
+	return 0;
+}
+
+// Only switches the active unit when the binding actually changes
+static inline void setGLTexture(GLStateCache& state, u32 unit, u32 target, u32 texture)
+{
+	assert(unit < GL_STATE_TEXTURE_UNITS);
+	u32& cached = state.textures[unit][getGLStateTextureTarget(target)];
+	if (cached == texture)
+	{
+		state.filteredCalls++;
+		return;
+	}
+
+	setGLActiveTexture(state, unit);
+	cached = texture;
+	state.issuedCalls++;
+	glBindTexture(target, texture);
+}
+
+// Units first, first + 1, ... get textures[i] in one glBindTextures, skipped when none of them
+// changes. GL works out each target from the texture itself, targets only keeps the cache. A 0
+// unbinds every target of its unit.
+static inline void setGLTextures(GLStateCache& state, u32 first, u32 count, const u32* targets, const u32* textures)
+{
+	assert(first + count <= GL_STATE_TEXTURE_UNITS);
+	if (!count)
+	{
+		return;
+	}
+
+	bool32 changed = false;
+	for (u32 i = 0; i < count; i++)
+	{
+		u32* unitTextures = state.textures[first + i];
+		if (textures[i])
+		{
+			u32& cached = unitTextures[getGLStateTextureTarget(targets[i])];
+			changed |= cached != textures[i];
+			cached = textures[i];
+		}
+		else
+		{
+			for (u32 target = 0; target < GL_STATE_TEXTURE_TARGET_COUNT; target++)
+			{
+				changed |= unitTextures[target] != 0;
+				unitTextures[target] = 0;
+			}
+		}
+	}
+
+	if (!changed)
+	{
+		state.filteredCalls++;
+		return;
+	}
+	state.issuedCalls++;
+	glBindTextures(first, count, textures);
+}
+
+// Binds to whichever unit is active, for creating and filling textures
+static inline void setGLTexture(GLStateCache& state, u32 target, u32 texture)
+{
+	if (state.activeTexture == GL_STATE_UNKNOWN)
+	{
+		setGLActiveTexture(state, 0);
+	}
+	setGLTexture(state, state.activeTexture, target, texture);
+}
+
+static inline u32 getGLStateBufferTarget(u32 target)
+{
+	switch (target)
+	{
+		case (GL_ARRAY_BUFFER):
+		{
+			return GL_STATE_ARRAY_BUFFER;
+		} break;
+		case (GL_DISPATCH_INDIRECT_BUFFER):
+		{
+			return GL_STATE_DISPATCH_INDIRECT_BUFFER;
+		} break;
+	}
+	return GL_STATE_BUFFER_TARGET_COUNT;
+}
+
+// GL_ELEMENT_ARRAY_BUFFER belongs to the bound vertex array, and targets with indexed bindings
+// also change on glBindBufferBase/Range, so those always go through
+static inline void setGLBuffer(GLStateCache& state, u32 target, u32 buffer)
+{
+	u32 index = getGLStateBufferTarget(target);
+	if (index == GL_STATE_BUFFER_TARGET_COUNT)
+	{
+		state.issuedCalls++;
+		glBindBuffer(target, buffer);
+	}
+	else if (updateGLState(state, state.buffers[index], buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+static inline u32 getGLStateCapability(u32 capability)
+{
+	switch (capability)
+	{
+		case (GL_BLEND):
+		{
+			return GL_STATE_BLEND;
+		} break;
+		case (GL_DEPTH_TEST):
+		{
+			return GL_STATE_DEPTH_TEST;
+		} break;
+		case (GL_CULL_FACE):
+		{
+			return GL_STATE_CULL_FACE;
+		} break;
+	}
+	assert(!"Capability not tracked by the GL state cache");
+	return 0;
+}
+
+static inline void setGLCapability(GLStateCache& state, u32 capability, bool32 enabled)
+{
+	if (updateGLState(state, state.capabilities[getGLStateCapability(capability)], enabled ? 1 : 0))
+	{
+		if (enabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+}
+
+static inline void setGLViewport(GLStateCache& state, int x, int y, int width, int height)
+{
+	if (state.viewport[0] == x && state.viewport[1] == y && state.viewport[2] == width && state.viewport[3] == height)
+	{
+		state.filteredCalls++;
+		return;
+	}
+	state.viewport[0] = x;
+	state.viewport[1] = y;
+	state.viewport[2] = width;
+	state.viewport[3] = height;
+	state.issuedCalls++;
+	glViewport(x, y, width, height);
+}
+
+static inline void setGLBlendFunc(GLStateCache& state, u32 source, u32 destination)
+{
+	if (state.blendFunc[0] == source && state.blendFunc[1] == destination)
+	{
+		state.filteredCalls++;
+		return;
+	}
+	state.blendFunc[0] = source;
+	state.blendFunc[1] = destination;
+	state.issuedCalls++;
+	glBlendFunc(source, destination);
+}
+
+static inline void setGLClearColor(GLStateCache& state, float r, float g, float b, float a)
+{
+	if (state.clearColor[0] == r && state.clearColor[1] == g && state.clearColor[2] == b && state.clearColor[3] == a)
+	{
+		state.filteredCalls++;
+		return;
+	}
+	state.clearColor[0] = r;
+	state.clearColor[1] = g;
+	state.clearColor[2] = b;
+	state.clearColor[3] = a;
+	state.issuedCalls++;
+	glClearColor(r, g, b, a);
+}
+
+// Deleting a bound object resets its bindings to 0 in GL, the cache has to follow
+static inline void forgetGLTexture(GLStateCache& state, u32 texture)
+{
+	for (u32 unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+	{
+		for (u32 target = 0; target < GL_STATE_TEXTURE_TARGET_COUNT; target++)
+		{
+			if (state.textures[unit][target] == texture)
+			{
+				state.textures[unit][target] = 0;
+			}
+		}
+	}
+}
+
+static inline void forgetGLBuffer(GLStateCache& state, u32 buffer)
+{
+	for (u32 target = 0; target < GL_STATE_BUFFER_TARGET_COUNT; target++)
+	{
+		if (state.buffers[target] == buffer)
+		{
+			state.buffers[target] = 0;
+		}
+	}
+}
+
+static inline void deleteGLTextures(GLStateCache& state, u32 count, const u32* textures)
+{
+	for (u32 i = 0; i < count; i++)
+	{
+		forgetGLTexture(state, textures[i]);
+	}
+	glDeleteTextures(count, textures);
+}
+
+static inline void deleteGLBuffer(GLStateCache& state, u32 buffer)
+{
+	forgetGLBuffer(state, buffer);
+	glDeleteBuffers(1, &buffer);
+}
+
+// A program in use is only flagged for deletion and stays bound, but its name can come back from
+// glCreateProgram once it's released, so the next use always reaches the driver
+static inline void deleteGLProgram(GLStateCache& state, u32 program)
+{
+	if (state.program == program)
+	{
+		state.program = GL_STATE_UNKNOWN;
+	}
+	glDeleteProgram(program);
+}
+
+static inline void deleteGLProgramPipeline(GLStateCache& state, u32 pipeline)
+{
+	if (state.pipeline == pipeline)
+	{
+		state.pipeline = 0;
+	}
+	glDeleteProgramPipelines(1, &pipeline);
+}
+
+static inline void deleteGLVertexArray(GLStateCache& state, u32 vertexArray)
+{
+	if (state.vertexArray == vertexArray)
+	{
+		state.vertexArray = 0;
+	}
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+static inline void deleteGLFramebuffer(GLStateCache& state, u32 framebuffer)
+{
+	if (state.framebuffer == framebuffer)
+	{
+		state.framebuffer = 0;
+	}
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+static inline void deleteGLRenderbuffer(GLStateCache& state, u32 renderbuffer)
+{
+	if (state.renderbuffer == renderbuffer)
+	{
+		state.renderbuffer = 0;
+	}
+	glDeleteRenderbuffers(1, &renderbuffer);
+}
+
+static inline u32 takeGLStateStats(GLStateCache& state, u32* filteredCalls = nullptr)
+{
+	u32 issuedCalls = state.issuedCalls;
+	if (filteredCalls)
+	{
+		*filteredCalls = state.filteredCalls;
+	}
+	state.issuedCalls = 0;
+	state.filteredCalls = 0;
+	return issuedCalls;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// Tracks which buffers and textures have been written by shaders (SSBO stores, image stores),
+// since those writes are incoherent: whoever reads them next needs a glMemoryBarrier with the bit
+// for the way it reads. Consumers declare what they are about to read with requireBarrier() and
+// flushBarriers() issues one glMemoryBarrier with only the bits some written resource still
+// needs. A bit that has already been issued since the last write isn't issued again, and
+// resources nobody wrote to never cost a barrier.
+
+enum ShaderAccess
+{
+	SHADER_READ = 1,
+	SHADER_WRITE = 2,
+	SHADER_READ_WRITE = SHADER_READ | SHADER_WRITE,
+};
+
+struct TrackedResource
+{
+	u64 key;
+	// Barrier bits issued since the resource was last written
+	u32 issuedBits;
+	bool32 written;
+};
+
+struct BarrierTracker
+{
+	vector<TrackedResource> resources;
+	// Written by the dispatch being set up, they become visible once it has been issued
+	vector<u64> pendingWrites;
+	u32 pendingBits;
+
+	// Since the last takeBarrierStats()
+	u32 issuedBarriers;
+	u32 skippedBarriers;
+};
+
+// Buffer and texture names live in separate namespaces
+static inline u64 getBufferBarrierKey(u32 buffer)
+{
+	return u64(buffer);
+}
+
+static inline u64 getTextureBarrierKey(u32 texture)
+{
+	return (u64(1) << 32) | texture;
+}
+
+static inline void initBarrierTracker(BarrierTracker& tracker)
+{
+	tracker.resources.clear();
+	tracker.pendingWrites.clear();
+	tracker.pendingBits = 0;
+	tracker.issuedBarriers = 0;
+	tracker.skippedBarriers = 0;
+}
+
+static inline TrackedResource* findTrackedResource(BarrierTracker& tracker, u64 key)
+{
+	// Only resources written by shaders end up here, a handful at most
+	for (TrackedResource& resource : tracker.resources)
+	{
+		if (resource.key == key)
+		{
+			return &resource;
+		}
+	}
+	return nullptr;
+}
+
+// The next command reads key the way barrierBits describes, e.g. GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+// for an instance buffer or GL_BUFFER_UPDATE_BARRIER_BIT before glBufferSubData
+static inline void requireBarrier(BarrierTracker& tracker, u64 key, u32 barrierBits)
+{
+	TrackedResource* resource = findTrackedResource(tracker, key);
+	if (!resource || !resource->written)
+	{
+		return;
+	}
+
+	u32 missingBits = barrierBits & ~resource->issuedBits;
+	if (missingBits)
+	{
+		tracker.pendingBits |= missingBits;
+	}
+	else
+	{
+		tracker.skippedBarriers++;
+	}
+}
+
+// The dispatch being set up writes key
+static inline void trackShaderWrite(BarrierTracker& tracker, u64 key)
+{
+	tracker.pendingWrites.push_back(key);
+}
+
+// Call right before the draw or dispatch that consumes the declared resources
+static inline void flushBarriers(BarrierTracker& tracker)
+{
+	if (!tracker.pendingBits)
+	{
+		return;
+	}
+
+	glMemoryBarrier(tracker.pendingBits);
+	tracker.issuedBarriers++;
+	// A barrier covers every write issued before it, not just the one that asked for it
+	for (TrackedResource& resource : tracker.resources)
+	{
+		if (resource.written)
+		{
+			resource.issuedBits |= tracker.pendingBits;
+		}
+	}
+	tracker.pendingBits = 0;
+}
+
+// Call right after the dispatch whose writes were declared with trackShaderWrite()
+static inline void commitShaderWrites(BarrierTracker& tracker)
+{
+	for (u64 key : tracker.pendingWrites)
+	{
+		TrackedResource* resource = findTrackedResource(tracker, key);
+		if (!resource)
+		{
+			TrackedResource newResource = { key, 0, false };
+			tracker.resources.push_back(newResource);
+			resource = &tracker.resources.back();
+		}
+		resource->written = true;
+		resource->issuedBits = 0;
+	}
+	tracker.pendingWrites.clear();
+}
+
+static inline u32 takeBarrierStats(BarrierTracker& tracker, u32* skippedBarriers = nullptr)
+{
+	u32 issuedBarriers = tracker.issuedBarriers;
+	if (skippedBarriers)
+	{
+		*skippedBarriers = tracker.skippedBarriers;
+	}
+	tracker.issuedBarriers = 0;
+	tracker.skippedBarriers = 0;
+	return issuedBarriers;
+}
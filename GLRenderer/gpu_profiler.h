@@ -0,0 +1,358 @@
+#pragma once
+
+// Named GPU passes timed with GL_TIMESTAMP queries. Unlike GL_TIME_ELAPSED, timestamps can nest
+// and interleave, so a pass can be entered any number of times per frame and its time is the
+// sum. Each frame owns one slot of a ring GPU_PROFILER_FRAMES deep; a slot is only read back
+// once all of its queries are available, so the CPU never waits on the GPU. When every slot is
+// still in flight the frame is simply not timed.
+//
+// Pass 0 is the whole frame, from beginGpuProfilerFrame() to endGpuProfilerFrame().
+
+#define GPU_PROFILER_FRAMES 4
+#define GPU_PROFILER_MAX_PASSES 16
+#define GPU_PROFILER_MAX_QUERIES 128
+#define GPU_PROFILER_HISTORY 120
+#define GPU_PROFILER_NO_PASS 0xFFFFFFFF
+#define GPU_PROFILER_FRAME_PASS 0
+#define GPU_PROFILER_NO_FRAME 0xFFFFFFFFFFFFFFFFull
+
+struct GpuProfilerSample
+{
+	u32 pass;
+	u32 beginQuery;
+	u32 endQuery;
+};
+
+struct GpuProfilerFrame
+{
+	u32 queries[GPU_PROFILER_MAX_QUERIES];
+	u32 queryCount;
+	GpuProfilerSample samples[GPU_PROFILER_MAX_QUERIES / 2];
+	u32 sampleCount;
+	u64 frameIndex;
+};
+
+struct GpuPass
+{
+	const char* name;
+	// The last GPU_PROFILER_HISTORY frames the pass ran in, in ms
+	float history[GPU_PROFILER_HISTORY];
+	u32 historyCount;
+	u32 historyNext;
+	u32 openSample;
+
+	// Every frame since initGpuProfiler(), for whole run reports
+	double totalMs;
+	u32 totalSamples;
+	// Each of those frames, only kept while GpuProfiler::recordRunSamples is set
+	vector<float> runSamples;
+};
+
+struct GpuPassStats
+{
+	float lastMs;
+	float averageMs;
+	float minMs;
+	float maxMs;
+	u32 sampleCount;
+
+	double runAverageMs;
+	u32 runSampleCount;
+};
+
+struct GpuProfiler
+{
+	GpuProfilerFrame frames[GPU_PROFILER_FRAMES];
+	u64 issuedFrames;
+	u64 resolvedFrames;
+	bool32 frameActive;
+	u32 skippedFrames;
+
+	// The frame pass of the last GPU_PROFILER_HISTORY resolved frames, slot resolvedFrames %
+	// GPU_PROFILER_HISTORY, for consumers that want each frame's time with its index
+	u64 resolvedFrameIndices[GPU_PROFILER_HISTORY];
+	float resolvedFrameMs[GPU_PROFILER_HISTORY];
+
+	GpuPass passes[GPU_PROFILER_MAX_PASSES];
+	u32 passCount;
+	bool32 recordRunSamples;
+
+	// One "frame,pass,ms" row per pass and resolved frame, nullptr when not requested
+	FILE* csv;
+};
+
+// Returns the existing pass when the name is already known
+static inline u32 addGpuPass(GpuProfiler& profiler, const char* name)
+{
+	for (u32 i = 0; i < profiler.passCount; i++)
+	{
+		if (strcmp(profiler.passes[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+
+	assert(profiler.passCount < GPU_PROFILER_MAX_PASSES && "Too many GPU profiler passes");
+	GpuPass& pass = profiler.passes[profiler.passCount];
+	pass.name = name;
+	pass.historyCount = 0;
+	pass.historyNext = 0;
+	pass.openSample = GPU_PROFILER_NO_PASS;
+	pass.totalMs = 0.0;
+	pass.totalSamples = 0;
+	pass.runSamples.clear();
+	return profiler.passCount++;
+}
+
+static inline void initGpuProfiler(GpuProfiler& profiler, const char* csvPath = nullptr)
+{
+	for (u32 i = 0; i < GPU_PROFILER_FRAMES; i++)
+	{
+		GpuProfilerFrame& frame = profiler.frames[i];
+		glGenQueries(GPU_PROFILER_MAX_QUERIES, frame.queries);
+		frame.queryCount = 0;
+		frame.sampleCount = 0;
+		frame.frameIndex = 0;
+	}
+	profiler.issuedFrames = 0;
+	profiler.resolvedFrames = 0;
+	profiler.frameActive = false;
+	profiler.skippedFrames = 0;
+	profiler.passCount = 0;
+	profiler.recordRunSamples = false;
+	addGpuPass(profiler, "frame");
+
+	profiler.csv = nullptr;
+	if (csvPath)
+	{
+		profiler.csv = fopen(csvPath, "w");
+		if (!profiler.csv)
+		{
+			printf("Can't open \"%s\" for the GPU profile, it won't be written\n", csvPath);
+			return;
+		}
+		fprintf(profiler.csv, "frame,pass,ms\n");
+	}
+}
+
+static inline void destroyGpuProfiler(GpuProfiler& profiler)
+{
+	for (u32 i = 0; i < GPU_PROFILER_FRAMES; i++)
+	{
+		glDeleteQueries(GPU_PROFILER_MAX_QUERIES, profiler.frames[i].queries);
+	}
+	if (profiler.csv)
+	{
+		fclose(profiler.csv);
+		profiler.csv = nullptr;
+	}
+}
+
+static inline void addGpuPassSample(GpuPass& pass, float ms)
+{
+	pass.history[pass.historyNext] = ms;
+	pass.historyNext = (pass.historyNext + 1) % GPU_PROFILER_HISTORY;
+	pass.historyCount = min(pass.historyCount + 1, u32(GPU_PROFILER_HISTORY));
+	pass.totalMs += ms;
+	pass.totalSamples++;
+}
+
+// Reads back every frame whose queries have all landed, oldest first
+static inline void resolveGpuProfiler(GpuProfiler& profiler)
+{
+	while (profiler.resolvedFrames != profiler.issuedFrames)
+	{
+		GpuProfilerFrame& frame = profiler.frames[profiler.resolvedFrames % GPU_PROFILER_FRAMES];
+		bool32 available = true;
+		for (u32 i = 0; i < frame.queryCount && available; i++)
+		{
+			int queryAvailable = 0;
+			glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &queryAvailable);
+			available = queryAvailable != 0;
+		}
+		if (!available)
+		{
+			break;
+		}
+
+		u64 timestamps[GPU_PROFILER_MAX_QUERIES];
+		for (u32 i = 0; i < frame.queryCount; i++)
+		{
+			glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+		}
+
+		double passMs[GPU_PROFILER_MAX_PASSES] = {};
+		bool32 passRan[GPU_PROFILER_MAX_PASSES] = {};
+		for (u32 i = 0; i < frame.sampleCount; i++)
+		{
+			const GpuProfilerSample& sample = frame.samples[i];
+			assert(sample.endQuery != GPU_PROFILER_NO_PASS && "GPU pass was never ended");
+			passMs[sample.pass] += (timestamps[sample.endQuery] - timestamps[sample.beginQuery]) / 1000000.0;
+			passRan[sample.pass] = true;
+		}
+
+		for (u32 pass = 0; pass < profiler.passCount; pass++)
+		{
+			if (!passRan[pass])
+			{
+				continue;
+			}
+			addGpuPassSample(profiler.passes[pass], float(passMs[pass]));
+			if (profiler.recordRunSamples)
+			{
+				profiler.passes[pass].runSamples.push_back(float(passMs[pass]));
+			}
+			if (profiler.csv)
+			{
+				fprintf(profiler.csv, "%llu,%s,%.4f\n", (unsigned long long)frame.frameIndex, profiler.passes[pass].name, passMs[pass]);
+			}
+		}
+		u32 resolvedSlot = u32(profiler.resolvedFrames % GPU_PROFILER_HISTORY);
+		profiler.resolvedFrameIndices[resolvedSlot] = frame.frameIndex;
+		profiler.resolvedFrameMs[resolvedSlot] = float(passMs[GPU_PROFILER_FRAME_PASS]);
+		profiler.resolvedFrames++;
+	}
+}
+
+// Waits for everything in flight, for the end of a run
+static inline void drainGpuProfiler(GpuProfiler& profiler)
+{
+	glFinish();
+	resolveGpuProfiler(profiler);
+	assert(profiler.resolvedFrames == profiler.issuedFrames);
+}
+
+// Starts the whole run totals over, e.g. once warm up frames are done
+static inline void resetGpuProfilerTotals(GpuProfiler& profiler)
+{
+	for (u32 i = 0; i < profiler.passCount; i++)
+	{
+		profiler.passes[i].totalMs = 0.0;
+		profiler.passes[i].totalSamples = 0;
+		profiler.passes[i].runSamples.clear();
+	}
+}
+
+static inline void writeGpuTimestamp(GpuProfilerFrame& frame, u32& query)
+{
+	assert(frame.queryCount < GPU_PROFILER_MAX_QUERIES && "Too many GPU profiler queries in a frame");
+	query = frame.queryCount++;
+	glQueryCounter(frame.queries[query], GL_TIMESTAMP);
+}
+
+static inline void beginGpuPass(GpuProfiler& profiler, u32 passIndex)
+{
+	if (!profiler.frameActive || passIndex == GPU_PROFILER_NO_PASS)
+	{
+		return;
+	}
+
+	GpuProfilerFrame& frame = profiler.frames[profiler.issuedFrames % GPU_PROFILER_FRAMES];
+	GpuPass& pass = profiler.passes[passIndex];
+	assert(pass.openSample == GPU_PROFILER_NO_PASS && "GPU pass is already open");
+	assert(frame.sampleCount < GPU_PROFILER_MAX_QUERIES / 2);
+
+	GpuProfilerSample& sample = frame.samples[frame.sampleCount];
+	sample.pass = passIndex;
+	sample.endQuery = GPU_PROFILER_NO_PASS;
+	writeGpuTimestamp(frame, sample.beginQuery);
+	pass.openSample = frame.sampleCount++;
+}
+
+static inline void endGpuPass(GpuProfiler& profiler, u32 passIndex)
+{
+	if (!profiler.frameActive || passIndex == GPU_PROFILER_NO_PASS)
+	{
+		return;
+	}
+
+	GpuProfilerFrame& frame = profiler.frames[profiler.issuedFrames % GPU_PROFILER_FRAMES];
+	GpuPass& pass = profiler.passes[passIndex];
+	assert(pass.openSample != GPU_PROFILER_NO_PASS && "GPU pass was never begun");
+	writeGpuTimestamp(frame, frame.samples[pass.openSample].endQuery);
+	pass.openSample = GPU_PROFILER_NO_PASS;
+}
+
+static inline void beginGpuProfilerFrame(GpuProfiler& profiler)
+{
+	resolveGpuProfiler(profiler);
+	profiler.frameActive = (profiler.issuedFrames - profiler.resolvedFrames) < GPU_PROFILER_FRAMES;
+	if (!profiler.frameActive)
+	{
+		profiler.skippedFrames++;
+		return;
+	}
+
+	GpuProfilerFrame& frame = profiler.frames[profiler.issuedFrames % GPU_PROFILER_FRAMES];
+	frame.queryCount = 0;
+	frame.sampleCount = 0;
+	frame.frameIndex = profiler.issuedFrames + profiler.skippedFrames;
+	beginGpuPass(profiler, GPU_PROFILER_FRAME_PASS);
+}
+
+static inline void endGpuProfilerFrame(GpuProfiler& profiler)
+{
+	if (!profiler.frameActive)
+	{
+		return;
+	}
+
+	endGpuPass(profiler, GPU_PROFILER_FRAME_PASS);
+	profiler.issuedFrames++;
+	profiler.frameActive = false;
+}
+
+// The index the current frame's times are reported under, GPU_PROFILER_NO_FRAME when it isn't
+// timed. Call between beginGpuProfilerFrame() and endGpuProfilerFrame().
+static inline u64 getGpuProfilerFrameIndex(const GpuProfiler& profiler)
+{
+	if (!profiler.frameActive)
+	{
+		return GPU_PROFILER_NO_FRAME;
+	}
+	return profiler.frames[profiler.issuedFrames % GPU_PROFILER_FRAMES].frameIndex;
+}
+
+// Over the frames in the pass history
+static inline GpuPassStats getGpuPassStats(const GpuProfiler& profiler, u32 passIndex)
+{
+	const GpuPass& pass = profiler.passes[passIndex];
+	GpuPassStats stats = {};
+	stats.sampleCount = pass.historyCount;
+	stats.runSampleCount = pass.totalSamples;
+	stats.runAverageMs = pass.totalSamples ? pass.totalMs / pass.totalSamples : 0.0;
+	if (!pass.historyCount)
+	{
+		return stats;
+	}
+
+	stats.lastMs = pass.history[(pass.historyNext + GPU_PROFILER_HISTORY - 1) % GPU_PROFILER_HISTORY];
+	stats.minMs = pass.history[0];
+	stats.maxMs = pass.history[0];
+	double totalMs = 0.0;
+	for (u32 i = 0; i < pass.historyCount; i++)
+	{
+		stats.minMs = min(stats.minMs, pass.history[i]);
+		stats.maxMs = max(stats.maxMs, pass.history[i]);
+		totalMs += pass.history[i];
+	}
+	stats.averageMs = float(totalMs / pass.historyCount);
+	return stats;
+}
+
+// One line with the average of every pass, e.g. for the window title
+static inline void formatGpuProfilerHud(const GpuProfiler& profiler, char* buffer, u32 bufferSize)
+{
+	u32 length = 0;
+	buffer[0] = '\0';
+	for (u32 pass = 0; pass < profiler.passCount && length < bufferSize; pass++)
+	{
+		GpuPassStats stats = getGpuPassStats(profiler, pass);
+		int written = snprintf(buffer + length, bufferSize - length, "%s%s %.2f ms", pass ? " | " : "GPU ", profiler.passes[pass].name, stats.averageMs);
+		if (written < 0)
+		{
+			break;
+		}
+		length += u32(written);
+	}
+}
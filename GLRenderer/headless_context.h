@@ -0,0 +1,280 @@
+#pragma once
+
+// The GL context of --headless runs, made without GLFW. GLFW 3.3 has no null platform: glfwInit()
+// and glfwCreateWindow() need an X11 or Wayland display even for its OSMesa and EGL contexts, and
+// CI machines and render nodes have none. OSMesa renders in software (llvmpipe) into a buffer in
+// client memory. EGL goes through Mesa's surfaceless platform and makes the context current with
+// no surface at all, on the render node Mesa picks. The frames go to a HeadlessTarget either way.
+//
+// Like GLFW, both libraries are loaded at run time, so the executable doesn't link against them.
+
+#if defined(_WIN32)
+extern "C" __declspec(dllimport) void* __stdcall LoadLibraryA(const char* fileName);
+extern "C" __declspec(dllimport) void* __stdcall GetProcAddress(void* module, const char* procName);
+extern "C" __declspec(dllimport) int __stdcall FreeLibrary(void* module);
+#else
+#include <dlfcn.h>
+#endif
+
+// From GL/osmesa.h
+#define OSMESA_RGBA 0x1908
+#define OSMESA_FORMAT 0x22
+#define OSMESA_DEPTH_BITS 0x30
+#define OSMESA_STENCIL_BITS 0x31
+#define OSMESA_PROFILE 0x33
+#define OSMESA_CORE_PROFILE 0x34
+#define OSMESA_CONTEXT_MAJOR_VERSION 0x36
+#define OSMESA_CONTEXT_MINOR_VERSION 0x37
+
+// From EGL/egl.h and EGL/eglext.h
+#define EGL_NONE 0x3038
+#define EGL_SURFACE_TYPE 0x3033
+#define EGL_PBUFFER_BIT 0x0001
+#define EGL_RENDERABLE_TYPE 0x3040
+#define EGL_OPENGL_BIT 0x0008
+#define EGL_OPENGL_API 0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x0001
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+
+// APIENTRY, from glad, is the calling convention of both libraries
+typedef void* (APIENTRY *OSMesaCreateContextAttribsProc)(const int* attributes, void* shareContext);
+typedef u8 (APIENTRY *OSMesaMakeCurrentProc)(void* context, void* buffer, u32 type, int width, int height);
+typedef void (APIENTRY *OSMesaDestroyContextProc)(void* context);
+
+typedef void* (APIENTRY *EGLGetProcAddressProc)(const char* name);
+typedef void* (APIENTRY *EGLGetPlatformDisplayProc)(u32 platform, void* nativeDisplay, const intptr_t* attributes);
+typedef u32 (APIENTRY *EGLInitializeProc)(void* display, i32* major, i32* minor);
+typedef u32 (APIENTRY *EGLBindAPIProc)(u32 api);
+typedef u32 (APIENTRY *EGLChooseConfigProc)(void* display, const i32* attributes, void** configs, i32 configSize, i32* configCount);
+typedef void* (APIENTRY *EGLCreateContextProc)(void* display, void* config, void* shareContext, const i32* attributes);
+typedef u32 (APIENTRY *EGLMakeCurrentProc)(void* display, void* draw, void* read, void* context);
+typedef u32 (APIENTRY *EGLDestroyContextProc)(void* display, void* context);
+typedef u32 (APIENTRY *EGLTerminateProc)(void* display);
+
+struct HeadlessContext
+{
+	bool32 egl;
+	void* library;
+	// What gladLoadGLLoader() gets the GL entry points from, OSMesaGetProcAddress() or
+	// eglGetProcAddress()
+	GLADloadproc getProcAddress;
+
+	void* osmesaContext;
+	// The default framebuffer OSMesa makes the context current on
+	u8* osmesaBuffer;
+	OSMesaDestroyContextProc osmesaDestroyContext;
+
+	void* eglDisplay;
+	void* eglContext;
+	EGLMakeCurrentProc eglMakeCurrent;
+	EGLDestroyContextProc eglDestroyContext;
+	EGLTerminateProc eglTerminate;
+};
+
+static inline void* openHeadlessLibrary(const char* const* names, u32 nameCount)
+{
+	for (u32 i = 0; i < nameCount; i++)
+	{
+#if defined(_WIN32)
+		void* library = LoadLibraryA(names[i]);
+#else
+		void* library = dlopen(names[i], RTLD_LAZY | RTLD_LOCAL);
+#endif
+		if (library)
+		{
+			return library;
+		}
+	}
+	return nullptr;
+}
+
+static inline void* getHeadlessLibrarySymbol(void* library, const char* name)
+{
+#if defined(_WIN32)
+	return GetProcAddress(library, name);
+#else
+	return dlsym(library, name);
+#endif
+}
+
+static inline void closeHeadlessLibrary(void* library)
+{
+#if defined(_WIN32)
+	FreeLibrary(library);
+#else
+	dlclose(library);
+#endif
+}
+
+static inline bool32 createOSMesaContext(HeadlessContext& context, int width, int height)
+{
+	// The names GLFW looks for
+#if defined(_WIN32)
+	const char* names[] = { "libOSMesa.dll", "OSMesa.dll" };
+#elif defined(__APPLE__)
+	const char* names[] = { "libOSMesa.8.dylib" };
+#else
+	const char* names[] = { "libOSMesa.so.8", "libOSMesa.so.6" };
+#endif
+	context.library = openHeadlessLibrary(names, u32(sizeof(names) / sizeof(names[0])));
+	if (!context.library)
+	{
+		printf("Headless: can't load OSMesa\n");
+		return false;
+	}
+
+	OSMesaCreateContextAttribsProc osmesaCreateContextAttribs = (OSMesaCreateContextAttribsProc)getHeadlessLibrarySymbol(context.library, "OSMesaCreateContextAttribs");
+	OSMesaMakeCurrentProc osmesaMakeCurrent = (OSMesaMakeCurrentProc)getHeadlessLibrarySymbol(context.library, "OSMesaMakeCurrent");
+	context.osmesaDestroyContext = (OSMesaDestroyContextProc)getHeadlessLibrarySymbol(context.library, "OSMesaDestroyContext");
+	context.getProcAddress = (GLADloadproc)getHeadlessLibrarySymbol(context.library, "OSMesaGetProcAddress");
+	if (!osmesaCreateContextAttribs || !osmesaMakeCurrent || !context.osmesaDestroyContext || !context.getProcAddress)
+	{
+		printf("Headless: OSMesa is missing entry points\n");
+		return false;
+	}
+
+	const int attributes[] =
+	{
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_STENCIL_BITS, 8,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4,
+		OSMESA_CONTEXT_MINOR_VERSION, 6,
+		0,
+	};
+	context.osmesaContext = osmesaCreateContextAttribs(attributes, nullptr);
+	if (!context.osmesaContext)
+	{
+		printf("Headless: OSMesa can't create a GL 4.6 core context, MESA_GL_VERSION_OVERRIDE=4.6 lifts an older llvmpipe from 4.5\n");
+		return false;
+	}
+
+	context.osmesaBuffer = (u8*)malloc(size_t(width) * height * 4);
+	if (!osmesaMakeCurrent(context.osmesaContext, context.osmesaBuffer, GL_UNSIGNED_BYTE, width, height))
+	{
+		printf("Headless: can't make the OSMesa context current\n");
+		return false;
+	}
+	return true;
+}
+
+static inline bool32 createEGLContext(HeadlessContext& context)
+{
+#if defined(_WIN32)
+	const char* names[] = { "libEGL.dll", "EGL.dll" };
+#elif defined(__APPLE__)
+	const char* names[] = { "libEGL.dylib" };
+#else
+	const char* names[] = { "libEGL.so.1", "libEGL.so" };
+#endif
+	context.library = openHeadlessLibrary(names, u32(sizeof(names) / sizeof(names[0])));
+	if (!context.library)
+	{
+		printf("Headless: can't load EGL\n");
+		return false;
+	}
+
+	EGLGetProcAddressProc eglGetProcAddress = (EGLGetProcAddressProc)getHeadlessLibrarySymbol(context.library, "eglGetProcAddress");
+	EGLInitializeProc eglInitialize = (EGLInitializeProc)getHeadlessLibrarySymbol(context.library, "eglInitialize");
+	EGLBindAPIProc eglBindAPI = (EGLBindAPIProc)getHeadlessLibrarySymbol(context.library, "eglBindAPI");
+	EGLChooseConfigProc eglChooseConfig = (EGLChooseConfigProc)getHeadlessLibrarySymbol(context.library, "eglChooseConfig");
+	EGLCreateContextProc eglCreateContext = (EGLCreateContextProc)getHeadlessLibrarySymbol(context.library, "eglCreateContext");
+	context.eglMakeCurrent = (EGLMakeCurrentProc)getHeadlessLibrarySymbol(context.library, "eglMakeCurrent");
+	context.eglDestroyContext = (EGLDestroyContextProc)getHeadlessLibrarySymbol(context.library, "eglDestroyContext");
+	context.eglTerminate = (EGLTerminateProc)getHeadlessLibrarySymbol(context.library, "eglTerminate");
+	if (!eglGetProcAddress || !eglInitialize || !eglBindAPI || !eglChooseConfig || !eglCreateContext || !context.eglMakeCurrent || !context.eglDestroyContext || !context.eglTerminate)
+	{
+		printf("Headless: EGL is missing entry points\n");
+		return false;
+	}
+	context.getProcAddress = (GLADloadproc)eglGetProcAddress;
+
+	// EGL 1.5 has it in core, older libraries only through EGL_EXT_platform_base
+	EGLGetPlatformDisplayProc eglGetPlatformDisplay = (EGLGetPlatformDisplayProc)eglGetProcAddress("eglGetPlatformDisplay");
+	if (!eglGetPlatformDisplay)
+	{
+		eglGetPlatformDisplay = (EGLGetPlatformDisplayProc)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	}
+	context.eglDisplay = eglGetPlatformDisplay ? eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr) : nullptr;
+	i32 major, minor;
+	if (!context.eglDisplay || !eglInitialize(context.eglDisplay, &major, &minor))
+	{
+		printf("Headless: EGL has no surfaceless Mesa display\n");
+		context.eglDisplay = nullptr;
+		return false;
+	}
+
+	// The surfaceless platform only has pbuffer configs, though no surface is ever made
+	const i32 configAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE,
+	};
+	const i32 contextAttributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 6,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE,
+	};
+	void* config;
+	i32 configCount;
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(context.eglDisplay, configAttributes, &config, 1, &configCount) || !configCount)
+	{
+		printf("Headless: EGL has no desktop GL config\n");
+		return false;
+	}
+	context.eglContext = eglCreateContext(context.eglDisplay, config, nullptr, contextAttributes);
+	if (!context.eglContext)
+	{
+		printf("Headless: EGL can't create a GL 4.6 core context, MESA_GL_VERSION_OVERRIDE=4.6 lifts an older llvmpipe from 4.5\n");
+		return false;
+	}
+	if (!context.eglMakeCurrent(context.eglDisplay, nullptr, nullptr, context.eglContext))
+	{
+		printf("Headless: can't make the EGL context current without a surface\n");
+		return false;
+	}
+	return true;
+}
+
+static inline void destroyHeadlessContext(HeadlessContext& context)
+{
+	if (context.osmesaContext)
+	{
+		context.osmesaDestroyContext(context.osmesaContext);
+	}
+	free(context.osmesaBuffer);
+	if (context.eglDisplay)
+	{
+		context.eglMakeCurrent(context.eglDisplay, nullptr, nullptr, nullptr);
+		if (context.eglContext)
+		{
+			context.eglDestroyContext(context.eglDisplay, context.eglContext);
+		}
+		context.eglTerminate(context.eglDisplay);
+	}
+	if (context.library)
+	{
+		closeHeadlessLibrary(context.library);
+	}
+	context = {};
+}
+
+// Makes the context current on the calling thread. What's left of a failed attempt is cleaned up.
+static inline bool32 createHeadlessContext(HeadlessContext& context, bool32 egl, int width, int height)
+{
+	context = {};
+	context.egl = egl;
+	bool32 created = egl ? createEGLContext(context) : createOSMesaContext(context, width, height);
+	if (!created)
+	{
+		destroyHeadlessContext(context);
+	}
+	return created;
+}
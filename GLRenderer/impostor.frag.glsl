@@ -0,0 +1,31 @@
+#version 430 core
+
+out vec4 FragmentColor;
+
+in vec3 AtlasCoord;
+in float Fade;
+
+uniform sampler2DArray impostorAtlas;
+
+const float bayer4x4[16] = float[16](
+	 0.0f / 16.0f,  8.0f / 16.0f,  2.0f / 16.0f, 10.0f / 16.0f,
+	12.0f / 16.0f,  4.0f / 16.0f, 14.0f / 16.0f,  6.0f / 16.0f,
+	 3.0f / 16.0f, 11.0f / 16.0f,  1.0f / 16.0f,  9.0f / 16.0f,
+	15.0f / 16.0f,  7.0f / 16.0f, 13.0f / 16.0f,  5.0f / 16.0f);
+
+void main()
+{
+	// Keeps the pixels the mesh discards in asteroid.frag.glsl
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	if (Fade <= bayer4x4[pixel.y * 4 + pixel.x])
+	{
+		discard;
+	}
+
+	vec4 color = texture(impostorAtlas, AtlasCoord);
+	if (color.a < 0.5f)
+	{
+		discard;
+	}
+	FragmentColor = vec4(color.rgb, 1.0f);
+}
\ No newline at end of file
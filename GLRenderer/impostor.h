@@ -0,0 +1,182 @@
+#pragma once
+#include <glm/gtc/quaternion.hpp>
+#include "jobs.h"
+
+// Octahedral impostors for distant instances. Every mesh variant is rendered at load time from
+// IMPOSTOR_FRAMES x IMPOSTOR_FRAMES directions laid out on an octahedral map, one atlas layer per
+// variant. Far instances become a camera-facing quad that picks the frame whose direction is the
+// closest to the view direction in the instance's local space.
+// Instances whose projected radius sits inside the fade band are drawn both ways, with the mesh
+// and the impostor discarding complementary dither patterns.
+
+#define IMPOSTOR_FRAMES 8
+#define IMPOSTOR_FRAME_SIZE 64
+#define IMPOSTOR_ATLAS_SIZE (IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE)
+
+// Mirrors the std430 ImpostorInstances block in impostor.vert.glsl
+struct ImpostorInstance
+{
+	vec4 centerRadius;
+	vec4 orientation;
+	u32 variant;
+	u32 padding[3];
+};
+
+static_assert(sizeof(ImpostorInstance) == 48, "ImpostorInstance has to match its std430 layout");
+
+// Per-frame instanced attributes of the impostor quads
+struct ImpostorDraw
+{
+	u32 instance;
+	float fade;
+};
+
+struct ImpostorVariant
+{
+	vec3 center;
+	float radius;
+};
+
+struct ImpostorField
+{
+	vector<ImpostorVariant> variants;
+	vector<ImpostorInstance> instances;
+
+	// 0 draws only the mesh, 1 only the impostor, anything in between both
+	vector<float> fades;
+	vector<u8> meshVisibility;
+	vector<ImpostorDraw> draws;
+
+	float screenRadiusThreshold;
+	float fadeBand;
+};
+
+static inline vec2 signNotZero(const vec2& v)
+{
+	return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Full sphere octahedral mapping between unit directions and [0, 1]^2
+static inline vec2 octahedralEncode(vec3 direction)
+{
+	direction /= fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	vec2 encoded(direction.x, direction.y);
+	if (direction.z < 0.0f)
+	{
+		encoded = (vec2(1.0f) - abs(vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+	}
+	return encoded * 0.5f + 0.5f;
+}
+
+static inline vec3 octahedralDecode(vec2 encoded)
+{
+	encoded = encoded * 2.0f - 1.0f;
+	vec3 direction(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+	if (direction.z < 0.0f)
+	{
+		vec2 folded = (vec2(1.0f) - abs(vec2(direction.y, direction.x))) * signNotZero(vec2(direction.x, direction.y));
+		direction.x = folded.x;
+		direction.y = folded.y;
+	}
+	return normalize(direction);
+}
+
+static inline vec3 getImpostorFrameDirection(u32 frameX, u32 frameY)
+{
+	return octahedralDecode(vec2((frameX + 0.5f) / IMPOSTOR_FRAMES, (frameY + 0.5f) / IMPOSTOR_FRAMES));
+}
+
+// Same basis as impostorFrameBasis() in impostor.vert.glsl: the bake camera looks down -direction
+static inline void getImpostorFrameBasis(const vec3& direction, vec3& right, vec3& up)
+{
+	vec3 reference = fabsf(direction.y) > 0.999f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+	right = normalize(cross(reference, direction));
+	up = cross(direction, right);
+}
+
+static inline void addImpostorVariant(ImpostorField& field, const vec3& aabbMin, const vec3& aabbMax)
+{
+	ImpostorVariant variant;
+	variant.center = (aabbMin + aabbMax) * 0.5f;
+	variant.radius = length(aabbMax - aabbMin) * 0.5f;
+	field.variants.push_back(variant);
+}
+
+// Instance matrices are expected to be translation * uniform scale * rotation
+static inline void initImpostorInstances(ImpostorField& field, const mat4* worldMatrices, const u32* variants, u32 instanceCount)
+{
+	field.instances.resize(instanceCount);
+	field.fades.resize(instanceCount);
+	field.meshVisibility.resize(instanceCount);
+	field.draws.reserve(instanceCount);
+
+	for (u32 i = 0; i < instanceCount; i++)
+	{
+		const mat4& world = worldMatrices[i];
+		u32 variantIndex = variants ? variants[i] : 0;
+		const ImpostorVariant& variant = field.variants[variantIndex];
+
+		float scale = length(vec3(world[0]));
+		quat orientation = quat_cast(mat3(world) / scale);
+
+		ImpostorInstance& instance = field.instances[i];
+		instance.centerRadius = vec4(vec3(world * vec4(variant.center, 1.0f)), variant.radius * scale);
+		instance.orientation = vec4(orientation.x, orientation.y, orientation.z, orientation.w);
+		instance.variant = variantIndex;
+		instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+	}
+}
+
+// pixelsPerUnit is the projected size in pixels of one world unit at view distance 1,
+// (framebufferHeight / 2) / tan(fovY / 2) for a perspective projection.
+static inline void classifyImpostors(ImpostorField& field, JobSystem& jobs, const vec3& cameraPosition, float pixelsPerUnit, const u8* visibility)
+{
+	const u32 instanceCount = u32(field.instances.size());
+	const float fullImpostor = field.screenRadiusThreshold;
+	const float fullMesh = field.screenRadiusThreshold * (1.0f + field.fadeBand);
+
+	parallelFor(jobs, instanceCount, 8192, [&](u32 begin, u32 end)
+	{
+		for (u32 i = begin; i < end; i++)
+		{
+			if (visibility && !visibility[i])
+			{
+				field.fades[i] = 0.0f;
+				field.meshVisibility[i] = false;
+				continue;
+			}
+
+			const vec4& centerRadius = field.instances[i].centerRadius;
+			float distance = max(length(vec3(centerRadius) - cameraPosition), 1e-3f);
+			float screenRadius = centerRadius.w * pixelsPerUnit / distance;
+
+			float fade = clamp((fullMesh - screenRadius) / (fullMesh - fullImpostor), 0.0f, 1.0f);
+			field.fades[i] = fade;
+			field.meshVisibility[i] = fade < 1.0f;
+		}
+	});
+}
+
+// Walks the instances in draw order (order == nullptr means generation order) and collects the
+// impostor quads. The meshes read their fade straight from fades, next to their matrices.
+static inline void gatherImpostorDraws(ImpostorField& field, const u32* order, const u8* visibility)
+{
+	field.draws.clear();
+
+	const u32 instanceCount = u32(field.instances.size());
+	for (u32 i = 0; i < instanceCount; i++)
+	{
+		u32 instance = order ? order[i] : i;
+		if (visibility && !visibility[instance])
+		{
+			continue;
+		}
+
+		float fade = field.fades[instance];
+		if (fade > 0.0f)
+		{
+			ImpostorDraw draw = { instance, fade };
+			field.draws.push_back(draw);
+		}
+	}
+}
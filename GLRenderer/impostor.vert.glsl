@@ -0,0 +1,88 @@
+#version 430 core
+
+struct ImpostorInstance
+{
+	vec4 centerRadius;
+	vec4 orientation;
+	uvec4 variant;
+};
+
+layout(std430, binding = 1) readonly buffer ImpostorInstances
+{
+	ImpostorInstance instances[];
+};
+
+layout(location = 0) in uint instanceIndex;
+layout(location = 1) in float instanceFade;
+
+out vec3 AtlasCoord;
+out float Fade;
+
+#include "frame_uniforms.glsl"
+
+const float FRAMES = 8.0f;
+
+vec3 rotateByQuaternion(vec3 v, vec4 q)
+{
+	return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec2 signNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 octahedralEncode(vec3 direction)
+{
+	direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+	vec2 encoded = direction.z >= 0.0f ? direction.xy : (1.0f - abs(direction.yx)) * signNotZero(direction.xy);
+	return encoded * 0.5f + 0.5f;
+}
+
+vec3 octahedralDecode(vec2 encoded)
+{
+	encoded = encoded * 2.0f - 1.0f;
+	vec3 direction = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	if (direction.z < 0.0f)
+	{
+		direction.xy = (1.0f - abs(direction.yx)) * signNotZero(direction.xy);
+	}
+	return normalize(direction);
+}
+
+void impostorFrameBasis(vec3 direction, out vec3 right, out vec3 up)
+{
+	vec3 reference = abs(direction.y) > 0.999f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+	right = normalize(cross(reference, direction));
+	up = cross(direction, right);
+}
+
+void main()
+{
+	ImpostorInstance instance = instances[instanceIndex];
+	vec3 center = instance.centerRadius.xyz;
+	float radius = instance.centerRadius.w;
+	vec4 inverseOrientation = vec4(-instance.orientation.xyz, instance.orientation.w);
+
+	vec3 toCamera = normalize(cameraPosition - center);
+	vec3 billboardRight = normalize(cross(vec3(0.0f, 1.0f, 0.0f), toCamera));
+	vec3 billboardUp = cross(toCamera, billboardRight);
+
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0f - 1.0f;
+	vec3 offset = billboardRight * corner.x + billboardUp * corner.y;
+	gl_Position = viewProj * vec4(center + offset * radius, 1.0f);
+
+	// Pick the baked frame closest to the view direction in the instance's own space and project
+	// the quad corner on that frame's image plane
+	vec3 localToCamera = rotateByQuaternion(toCamera, inverseOrientation);
+	vec2 frame = min(floor(octahedralEncode(localToCamera) * FRAMES), FRAMES - 1.0f);
+	vec3 frameRight;
+	vec3 frameUp;
+	impostorFrameBasis(octahedralDecode((frame + 0.5f) / FRAMES), frameRight, frameUp);
+
+	vec3 localOffset = rotateByQuaternion(offset, inverseOrientation);
+	vec2 frameCoord = vec2(dot(localOffset, frameRight), dot(localOffset, frameUp)) * 0.5f + 0.5f;
+
+	AtlasCoord = vec3((frame + frameCoord) / FRAMES, float(instance.variant.x));
+	Fade = instanceFade;
+}
\ No newline at end of file
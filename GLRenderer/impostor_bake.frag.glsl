@@ -1,4 +1,5 @@
 #version 330 core
+
 out vec4 FragmentColor;
 
 in vec2 TexCoord;
@@ -7,5 +8,5 @@ uniform sampler2D texture_diffuse1;
 
 void main()
 {
-	FragmentColor = texture(texture_diffuse1, TexCoord);
+	FragmentColor = vec4(texture(texture_diffuse1, TexCoord).rgb, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 texCoord;
+
+out vec2 TexCoord;
+
+uniform mat4 proj;
+uniform mat4 view;
+
+void main()
+{
+	gl_Position = proj * view * vec4(position, 1.0f);
+	TexCoord = texCoord;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+#include "radix_sort.h"
+
+// Front-to-back ordering of instances so early-z rejects as much of a dense field as possible.
+// The sorter keeps the order of every instance from one frame to the next and only refreshes
+// the depth key of the instances that are visible this frame; culled instances keep their stale
+// key, which is harmless because the visible subsequence of a sorted order is still sorted.
+// Camera motion between frames is small, so the previous order is usually almost sorted and an
+// insertion sort fixes it in close to linear time. When too much has moved the sorter falls back
+// to a full parallel radix sort.
+
+#define DEPTH_KEY_BITS 24
+#define DEPTH_KEY_MAX ((1 << DEPTH_KEY_BITS) - 1)
+
+// Insertion sort gives up once it has moved this many elements per instance on average
+#define INCREMENTAL_SORT_MAX_MOVES_PER_ITEM 4
+
+enum class InstanceSortMode : u32
+{
+	ALREADY_SORTED,
+	INCREMENTAL,
+	RADIX,
+};
+
+struct InstanceSorter
+{
+	vector<u32> order;
+	vector<u32> depthKeys;
+	vector<u32> sortKeys;
+	RadixSortScratch<u32> radixScratch;
+
+	float nearPlane;
+	float logDepthRange;
+
+	InstanceSortMode lastMode;
+	u32 lastMoves;
+};
+
+static inline void initInstanceSorter(InstanceSorter& sorter, u32 instanceCount, float nearPlane, float farPlane)
+{
+	sorter.order.resize(instanceCount);
+	for (u32 i = 0; i < instanceCount; i++)
+	{
+		sorter.order[i] = i;
+	}
+	sorter.depthKeys.assign(instanceCount, 0);
+	sorter.sortKeys.resize(instanceCount);
+	sorter.nearPlane = nearPlane;
+	sorter.logDepthRange = logf(farPlane / nearPlane);
+	sorter.lastMode = InstanceSortMode::RADIX;
+	sorter.lastMoves = 0;
+}
+
+// Logarithmic quantization spends the key bits where perspective puts the detail: near the camera
+static inline u32 quantizeViewDepth(const InstanceSorter& sorter, float viewDepth)
+{
+	if (viewDepth <= sorter.nearPlane)
+	{
+		return 0;
+	}
+
+	float normalized = logf(viewDepth / sorter.nearPlane) / sorter.logDepthRange;
+	normalized = min(normalized, 1.0f);
+	return u32(normalized * DEPTH_KEY_MAX);
+}
+
+// Refreshes the keys of the visible instances (visibility == nullptr means all of them) from the
+// translation part of their world matrix.
+static inline void updateInstanceDepthKeys(InstanceSorter& sorter, JobSystem& jobs, const mat4& view, const mat4* worldMatrices, const u8* visibility)
+{
+	const vec4 depthRow = -vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+	const u32 instanceCount = u32(sorter.depthKeys.size());
+
+	parallelFor(jobs, instanceCount, 8192, [&](u32 begin, u32 end)
+	{
+		for (u32 i = begin; i < end; i++)
+		{
+			if (visibility && !visibility[i])
+			{
+				continue;
+			}
+
+			float viewDepth = dot(depthRow, worldMatrices[i][3]);
+			sorter.depthKeys[i] = quantizeViewDepth(sorter, viewDepth);
+		}
+	});
+}
+
+static inline bool32 insertionSortBounded(u32* keys, u32* values, u32 count, u32 maxMoves, u32& moves)
+{
+	moves = 0;
+	for (u32 i = 1; i < count; i++)
+	{
+		u32 key = keys[i];
+		u32 value = values[i];
+		u32 j = i;
+		while (j > 0 && keys[j - 1] > key)
+		{
+			keys[j] = keys[j - 1];
+			values[j] = values[j - 1];
+			j--;
+		}
+		keys[j] = key;
+		values[j] = value;
+
+		moves += i - j;
+		if (moves > maxMoves)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static inline void sortInstancesFrontToBack(InstanceSorter& sorter, JobSystem& jobs)
+{
+	const u32 count = u32(sorter.order.size());
+	u32* keys = sorter.sortKeys.data();
+	u32* order = sorter.order.data();
+
+	u32 descents = 0;
+	for (u32 i = 0; i < count; i++)
+	{
+		keys[i] = sorter.depthKeys[order[i]];
+		descents += (i > 0 && keys[i - 1] > keys[i]);
+	}
+
+	sorter.lastMoves = 0;
+	if (descents == 0)
+	{
+		sorter.lastMode = InstanceSortMode::ALREADY_SORTED;
+		return;
+	}
+
+	// An aborted insertion sort leaves a valid permutation behind, so the radix sort can start from it
+	if (descents <= count / 4)
+	{
+		u32 moves;
+		if (insertionSortBounded(keys, order, count, count * INCREMENTAL_SORT_MAX_MOVES_PER_ITEM, moves))
+		{
+			sorter.lastMode = InstanceSortMode::INCREMENTAL;
+			sorter.lastMoves = moves;
+			return;
+		}
+	}
+
+	radixSort(jobs, sorter.radixScratch, keys, order, count);
+	sorter.lastMode = InstanceSortMode::RADIX;
+}
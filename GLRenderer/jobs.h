@@ -0,0 +1,160 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <type_traits>
+
+// Fork-join worker pool. parallelFor() splits [0, count) into ranges of `grain` items;
+// the calling thread and the workers pull ranges off a shared counter until it runs out.
+// Only one parallelFor can be in flight at a time and it must be issued from the main thread.
+// It isn't reentrant: a job calling parallelFor() asserts, unless the nested call is small enough
+// to run inline.
+struct JobSystem
+{
+	vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	// The function parallelFor() was given and how to call it. It lives on the caller's stack for
+	// as long as the ranges run, so issuing a job allocates nothing, unlike a std::function would
+	// for any lambda with more than a couple of captures.
+	void* taskFunction;
+	void (*runTask)(void* function, u32 begin, u32 end);
+	std::atomic<u32> nextItem;
+	u32 itemCount;
+	u32 grain;
+	u32 busyWorkers;
+	u64 generation;
+	bool32 quit;
+};
+
+static inline void runJobRanges(JobSystem& jobs)
+{
+	for (;;)
+	{
+		u32 begin = jobs.nextItem.fetch_add(jobs.grain);
+		if (begin >= jobs.itemCount)
+		{
+			break;
+		}
+
+		u32 end = begin + jobs.grain;
+		if (end > jobs.itemCount)
+		{
+			end = jobs.itemCount;
+		}
+		jobs.runTask(jobs.taskFunction, begin, end);
+	}
+}
+
+static inline void workerLoop(JobSystem* jobs)
+{
+	u64 seenGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(jobs->mutex);
+			jobs->wakeCondition.wait(lock, [&] { return jobs->quit || jobs->generation != seenGeneration; });
+			if (jobs->quit)
+			{
+				return;
+			}
+			seenGeneration = jobs->generation;
+		}
+
+		runJobRanges(*jobs);
+
+		std::lock_guard<std::mutex> lock(jobs->mutex);
+		if (--jobs->busyWorkers == 0)
+		{
+			jobs->doneCondition.notify_one();
+		}
+	}
+}
+
+#define JOBS_AUTO_WORKER_COUNT 0xFFFFFFFF
+
+static inline void initJobSystem(JobSystem& jobs, u32 workerCount = JOBS_AUTO_WORKER_COUNT)
+{
+	if (workerCount == JOBS_AUTO_WORKER_COUNT)
+	{
+		u32 hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	jobs.taskFunction = nullptr;
+	jobs.runTask = nullptr;
+	jobs.nextItem = 0;
+	jobs.itemCount = 0;
+	jobs.grain = 1;
+	jobs.busyWorkers = 0;
+	jobs.generation = 0;
+	jobs.quit = false;
+
+	for (u32 i = 0; i < workerCount; i++)
+	{
+		jobs.workers.push_back(std::thread(workerLoop, &jobs));
+	}
+}
+
+static inline void destroyJobSystem(JobSystem& jobs)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobs.mutex);
+		jobs.quit = true;
+	}
+	jobs.wakeCondition.notify_all();
+
+	for (std::thread& worker : jobs.workers)
+	{
+		worker.join();
+	}
+	jobs.workers.clear();
+}
+
+static inline u32 getJobThreadCount(const JobSystem& jobs)
+{
+	return u32(jobs.workers.size()) + 1;
+}
+
+template <typename Function>
+static inline void parallelFor(JobSystem& jobs, u32 count, u32 grain, Function&& function)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Not worth waking anyone up for a single range
+	if (jobs.workers.empty() || count <= grain)
+	{
+		function(0u, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobs.mutex);
+		assert(!jobs.taskFunction && "parallelFor called from inside a job");
+		typedef typename std::remove_reference<Function>::type FunctionType;
+		jobs.taskFunction = (void*)&function;
+		jobs.runTask = [](void* taskFunction, u32 begin, u32 end)
+		{
+			(*(FunctionType*)taskFunction)(begin, end);
+		};
+		jobs.grain = grain ? grain : 1;
+		jobs.itemCount = count;
+		jobs.nextItem = 0;
+		jobs.busyWorkers = u32(jobs.workers.size());
+		jobs.generation++;
+	}
+	jobs.wakeCondition.notify_all();
+
+	runJobRanges(jobs);
+
+	std::unique_lock<std::mutex> lock(jobs.mutex);
+	jobs.doneCondition.wait(lock, [&] { return jobs.busyWorkers == 0; });
+	jobs.taskFunction = nullptr;
+	jobs.runTask = nullptr;
+}
@@ -0,0 +1,117 @@
+// Light types and the Phong terms shared by the phong_*.frag.glsl shaders. The material is
+// sampled once by the caller and passed in as a Surface.
+
+struct Material
+{
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+
+struct Surface
+{
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+};
+
+struct DirectionalLight
+{
+	vec3 direction;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight
+{
+	vec3 position;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+struct Spotlight
+{
+	vec3 direction;
+	vec3 position;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+	float cutOff;
+	float outerCutOff;
+};
+
+vec3 computeDirectionalLight(DirectionalLight light, Surface surface, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(-light.direction);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	// do this so lightColors can't be negative --> dot product with (angles > 90) produce negative results
+	float diff = max(dot(normal, lightDirection), 0.0f);
+	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), surface.shininess);
+
+	vec3 ambientLight = light.ambient * surface.diffuse;
+	vec3 diffuseLight = light.diffuse * diff * surface.diffuse;
+	vec3 specularLight = light.specular * spec * surface.specular;
+
+	return (ambientLight + diffuseLight + specularLight);
+}
+
+vec3 computePointLight(PointLight light, Surface surface, vec3 normal, vec3 fragmentPosition, vec3 viewDirection)
+{
+	float distance = length(light.position - fragmentPosition);
+	float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	float diff = max(dot(normal, lightDirection), 0.0f);
+
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), surface.shininess);
+
+	vec3 ambientLight = light.ambient * surface.diffuse;
+	vec3 diffuseLight = light.diffuse * diff * surface.diffuse;
+	vec3 specularLight = light.specular * spec * surface.specular;
+
+	ambientLight *= attenuation;
+	diffuseLight *= attenuation;
+	specularLight *= attenuation;
+
+	return (ambientLight + diffuseLight + specularLight);
+}
+
+// calculates the color when using a spot light.
+vec3 computeSpotlight(Spotlight light, Surface surface, vec3 normal, vec3 fragmentPosition, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	// diffuse shading
+	float diff = max(dot(normal, lightDirection), 0.0);
+	// specular shading
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), surface.shininess);
+	// attenuation
+	float distance = length(light.position - fragmentPosition);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// spotlight intensity
+	float theta = dot(lightDirection, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+	// combine results
+	vec3 ambient = light.ambient * surface.diffuse;
+	vec3 diffuse = light.diffuse * diff * surface.diffuse;
+	vec3 specular = light.specular * spec * surface.specular;
+	ambient *= attenuation * intensity;
+	diffuse *= attenuation * intensity;
+	specular *= attenuation * intensity;
+	return (ambient + diffuse + specular);
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+#pragma once
+
+// Accounting of what the renderer allocates, on the GPU and in the CPU copies it keeps. Every
+// allocation is tagged with the asset that owns it, e.g. a model's path, and a category. GPU sizes
+// are worked out from the format, the dimensions and the mip count rather than asked from the
+// driver, so they are what the allocation needs at least, before any padding the driver adds.
+//
+// An allocation is identified by the GL object it lives in. CPU copies have no GL object, they are
+// tracked as MEMORY_OBJECT_CPU under a name the owner picks, e.g. the name of the buffer they
+// mirror. Tracking an object again replaces its previous size, for buffers that are respecified.
+
+enum MemoryCategory
+{
+	MEMORY_VERTEX_BUFFER,
+	MEMORY_INDEX_BUFFER,
+	MEMORY_INSTANCE_BUFFER,
+	MEMORY_STORAGE_BUFFER,
+	MEMORY_STREAMING_BUFFER,
+	MEMORY_TEXTURE,
+	MEMORY_RENDER_TARGET,
+	// CPU side copies
+	MEMORY_CPU_GEOMETRY,
+	MEMORY_CPU_INSTANCES,
+	MEMORY_CATEGORY_COUNT,
+};
+
+static const char* const g_MemoryCategoryNames[MEMORY_CATEGORY_COUNT] =
+{
+	"vertex buffers",
+	"index buffers",
+	"instance buffers",
+	"storage buffers",
+	"streaming buffers",
+	"textures",
+	"render targets",
+	"cpu geometry",
+	"cpu instances",
+};
+
+#define MEMORY_FIRST_CPU_CATEGORY MEMORY_CPU_GEOMETRY
+#define MEMORY_ASSET_NAME_SIZE 64
+
+enum MemoryObject
+{
+	MEMORY_OBJECT_BUFFER,
+	MEMORY_OBJECT_TEXTURE,
+	MEMORY_OBJECT_RENDERBUFFER,
+	MEMORY_OBJECT_CPU,
+};
+
+struct MemoryAllocation
+{
+	u32 object;
+	u32 name;
+	u32 asset;
+	u32 category;
+	u64 bytes;
+};
+
+struct MemoryAsset
+{
+	char name[MEMORY_ASSET_NAME_SIZE];
+	u64 bytes[MEMORY_CATEGORY_COUNT];
+	u64 gpuPeakBytes;
+	u64 cpuPeakBytes;
+};
+
+struct MemoryTracker
+{
+	vector<MemoryAsset> assets;
+	vector<MemoryAllocation> allocations;
+
+	u64 categoryBytes[MEMORY_CATEGORY_COUNT];
+	u64 categoryPeakBytes[MEMORY_CATEGORY_COUNT];
+	u64 gpuBytes;
+	u64 gpuPeakBytes;
+	u64 cpuBytes;
+	u64 cpuPeakBytes;
+};
+
+static inline void initMemoryTracker(MemoryTracker& tracker)
+{
+	tracker.assets.clear();
+	tracker.allocations.clear();
+	memset(tracker.categoryBytes, 0, sizeof(tracker.categoryBytes));
+	memset(tracker.categoryPeakBytes, 0, sizeof(tracker.categoryPeakBytes));
+	tracker.gpuBytes = 0;
+	tracker.gpuPeakBytes = 0;
+	tracker.cpuBytes = 0;
+	tracker.cpuPeakBytes = 0;
+}
+
+// Returns the existing asset when the name is already known
+static inline u32 getMemoryAsset(MemoryTracker& tracker, const char* name)
+{
+	for (u32 i = 0; i < tracker.assets.size(); i++)
+	{
+		if (strcmp(tracker.assets[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+
+	MemoryAsset asset;
+	memset(&asset, 0, sizeof(asset));
+	snprintf(asset.name, sizeof(asset.name), "%s", name);
+	tracker.assets.push_back(asset);
+	return u32(tracker.assets.size() - 1);
+}
+
+static inline u64 getMemoryAssetBytes(const MemoryAsset& asset, bool32 cpu)
+{
+	u64 bytes = 0;
+	for (u32 category = cpu ? MEMORY_FIRST_CPU_CATEGORY : 0; category < (cpu ? MEMORY_CATEGORY_COUNT : MEMORY_FIRST_CPU_CATEGORY); category++)
+	{
+		bytes += asset.bytes[category];
+	}
+	return bytes;
+}
+
+static inline MemoryAllocation* findMemoryAllocation(MemoryTracker& tracker, u32 object, u32 name)
+{
+	for (MemoryAllocation& allocation : tracker.allocations)
+	{
+		if (allocation.object == object && allocation.name == name)
+		{
+			return &allocation;
+		}
+	}
+	return nullptr;
+}
+
+static inline void addMemoryBytes(MemoryTracker& tracker, u32 assetIndex, u32 category, u64 bytes, bool32 add)
+{
+	MemoryAsset& asset = tracker.assets[assetIndex];
+	bool32 cpu = category >= MEMORY_FIRST_CPU_CATEGORY;
+	u64& total = cpu ? tracker.cpuBytes : tracker.gpuBytes;
+	if (add)
+	{
+		asset.bytes[category] += bytes;
+		tracker.categoryBytes[category] += bytes;
+		total += bytes;
+	}
+	else
+	{
+		assert(asset.bytes[category] >= bytes);
+		asset.bytes[category] -= bytes;
+		tracker.categoryBytes[category] -= bytes;
+		total -= bytes;
+	}
+
+	tracker.categoryPeakBytes[category] = max(tracker.categoryPeakBytes[category], tracker.categoryBytes[category]);
+	tracker.gpuPeakBytes = max(tracker.gpuPeakBytes, tracker.gpuBytes);
+	tracker.cpuPeakBytes = max(tracker.cpuPeakBytes, tracker.cpuBytes);
+	u64& assetPeak = cpu ? asset.cpuPeakBytes : asset.gpuPeakBytes;
+	assetPeak = max(assetPeak, getMemoryAssetBytes(asset, cpu));
+}
+
+static inline void trackMemory(MemoryTracker& tracker, MemoryObject object, u32 name, u32 asset, MemoryCategory category, u64 bytes)
+{
+	assert(asset < tracker.assets.size());
+	MemoryAllocation* allocation = findMemoryAllocation(tracker, object, name);
+	if (allocation)
+	{
+		addMemoryBytes(tracker, allocation->asset, allocation->category, allocation->bytes, false);
+	}
+	else
+	{
+		tracker.allocations.push_back(MemoryAllocation());
+		allocation = &tracker.allocations.back();
+		allocation->object = object;
+		allocation->name = name;
+	}
+	allocation->asset = asset;
+	allocation->category = category;
+	allocation->bytes = bytes;
+	addMemoryBytes(tracker, asset, category, bytes, true);
+}
+
+// Call when the object is deleted, objects that were never tracked are ignored
+static inline void untrackMemory(MemoryTracker& tracker, MemoryObject object, u32 name)
+{
+	MemoryAllocation* allocation = findMemoryAllocation(tracker, object, name);
+	if (!allocation)
+	{
+		return;
+	}
+	addMemoryBytes(tracker, allocation->asset, allocation->category, allocation->bytes, false);
+	*allocation = tracker.allocations.back();
+	tracker.allocations.pop_back();
+}
+
+// 0 for objects that aren't tracked
+static inline u64 getTrackedMemory(MemoryTracker& tracker, MemoryObject object, u32 name)
+{
+	MemoryAllocation* allocation = findMemoryAllocation(tracker, object, name);
+	return allocation ? allocation->bytes : 0;
+}
+
+// Bytes per texel of the internal formats the renderer uses. Three channel formats are counted as
+// four, drivers pad them.
+static inline u64 getTexelBytes(u32 internalFormat)
+{
+	switch (internalFormat)
+	{
+		case (GL_RED):
+		case (GL_R8):
+		{
+			return 1;
+		} break;
+		case (GL_RG):
+		case (GL_RG8):
+		case (GL_R16F):
+		{
+			return 2;
+		} break;
+		case (GL_RGB):
+		case (GL_RGB8):
+		case (GL_RGBA):
+		case (GL_RGBA8):
+		case (GL_SRGB8):
+		case (GL_SRGB8_ALPHA8):
+		case (GL_R32F):
+		case (GL_RG16F):
+		case (GL_R11F_G11F_B10F):
+		case (GL_DEPTH_COMPONENT24):
+		case (GL_DEPTH_COMPONENT32F):
+		case (GL_DEPTH24_STENCIL8):
+		{
+			return 4;
+		} break;
+		case (GL_RGBA16F):
+		case (GL_RG32F):
+		case (GL_DEPTH32F_STENCIL8):
+		{
+			return 8;
+		} break;
+		case (GL_RGBA32F):
+		{
+			return 16;
+		} break;
+		default:
+		{
+			assert(!"Texel size of internal format unknown");
+		} break;
+	}
+	return 4;
+}
+
+// The full chain down to 1x1
+static inline u32 getMipCount(u32 width, u32 height)
+{
+	u32 mipCount = 1;
+	while ((width >> mipCount) || (height >> mipCount))
+	{
+		mipCount++;
+	}
+	return mipCount;
+}
+
+static inline u64 getTextureBytes(u32 internalFormat, u32 width, u32 height, u32 layers, u32 mipCount)
+{
+	u64 texels = 0;
+	for (u32 level = 0; level < mipCount; level++)
+	{
+		texels += u64(max(width >> level, 1u)) * u64(max(height >> level, 1u));
+	}
+	return texels * layers * getTexelBytes(internalFormat);
+}
+
+static inline void printMemoryBytes(const char* label, u64 bytes, u64 peakBytes)
+{
+	printf("  %-28s %10.2f MB  (peak %.2f MB)\n", label, bytes / (1024.0 * 1024.0), peakBytes / (1024.0 * 1024.0));
+}
+
+// Live totals by category and by asset, each with its peak
+static inline void printMemoryReport(const MemoryTracker& tracker)
+{
+	printf("Memory: GPU %.2f MB (peak %.2f MB), CPU %.2f MB (peak %.2f MB), %u allocations\n",
+		tracker.gpuBytes / (1024.0 * 1024.0), tracker.gpuPeakBytes / (1024.0 * 1024.0),
+		tracker.cpuBytes / (1024.0 * 1024.0), tracker.cpuPeakBytes / (1024.0 * 1024.0), u32(tracker.allocations.size()));
+	for (u32 category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+	{
+		if (tracker.categoryPeakBytes[category])
+		{
+			printMemoryBytes(g_MemoryCategoryNames[category], tracker.categoryBytes[category], tracker.categoryPeakBytes[category]);
+		}
+	}
+
+	printf("  %-28s %10s %10s %10s %10s\n", "asset", "GPU MB", "peak", "CPU MB", "peak");
+	for (const MemoryAsset& asset : tracker.assets)
+	{
+		printf("  %-28s %10.2f %10.2f %10.2f %10.2f\n", asset.name,
+			getMemoryAssetBytes(asset, false) / (1024.0 * 1024.0), asset.gpuPeakBytes / (1024.0 * 1024.0),
+			getMemoryAssetBytes(asset, true) / (1024.0 * 1024.0), asset.cpuPeakBytes / (1024.0 * 1024.0));
+		for (u32 category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+		{
+			if (asset.bytes[category])
+			{
+				printf("    %-26s %10.2f\n", g_MemoryCategoryNames[category], asset.bytes[category] / (1024.0 * 1024.0));
+			}
+		}
+	}
+}
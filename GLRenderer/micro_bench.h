@@ -0,0 +1,119 @@
+#pragma once
+#include "cpu_profiler.h"
+
+// CPU micro-benchmarks for the kernels the renderer runs on load and per frame, run by
+// --micro-bench with no window or GL context. A case runs its kernel once to warm caches, then
+// MICRO_BENCH_BATCHES batches of as many iterations as fill MICRO_BENCH_MIN_NS, and reports the
+// fastest batch: the minimum is the least disturbed by the rest of the machine. items and bytes
+// are what one iteration processes and turn the time into throughput.
+
+#define MICRO_BENCH_BATCHES 5
+#define MICRO_BENCH_MIN_NS 50000000ull
+
+struct MicroBench
+{
+	// Only cases whose name contains this run, nullptr for all
+	const char* filter;
+	u32 caseCount;
+};
+
+// Kernels fold something of their output in here, so the compiler can't drop the work
+static volatile u64 g_MicroBenchSink;
+
+static inline void initMicroBench(MicroBench& bench, const char* filter)
+{
+	bench.filter = filter;
+	bench.caseCount = 0;
+	printf("%-20s %-10s %14s %14s %12s\n", "kernel", "size", "ns/iter", "Mitems/s", "MB/s");
+}
+
+static inline bool32 isMicroBenchEnabled(const MicroBench& bench, const char* name)
+{
+	return !bench.filter || strstr(name, bench.filter);
+}
+
+template <typename Kernel>
+static inline void runMicroBench(MicroBench& bench, const char* name, const char* sizeLabel, u64 items, u64 bytes, Kernel&& kernel)
+{
+	if (!isMicroBenchEnabled(bench, name))
+	{
+		return;
+	}
+
+	kernel();
+
+	u64 iterations = 1;
+	double bestNsPerIteration = 0.0;
+	for (u32 batch = 0; batch < MICRO_BENCH_BATCHES; batch++)
+	{
+		u64 elapsedNs = 0;
+		// The first batch also finds how many iterations fill MICRO_BENCH_MIN_NS
+		for (;;)
+		{
+			u64 beginNs = getCpuProfilerNs();
+			for (u64 i = 0; i < iterations; i++)
+			{
+				kernel();
+			}
+			elapsedNs = getCpuProfilerNs() - beginNs;
+			if (batch || elapsedNs >= MICRO_BENCH_MIN_NS)
+			{
+				break;
+			}
+			iterations *= elapsedNs ? max(u64(2), u64(MICRO_BENCH_MIN_NS / elapsedNs) + 1) : 16;
+		}
+
+		double nsPerIteration = double(elapsedNs) / double(iterations);
+		bestNsPerIteration = batch ? min(bestNsPerIteration, nsPerIteration) : nsPerIteration;
+	}
+
+	double itemsPerSecond = double(items) / bestNsPerIteration * 1e9;
+	double bytesPerSecond = double(bytes) / bestNsPerIteration * 1e9;
+	printf("%-20s %-10s %14.1f %14.3f %12.1f\n", name, sizeLabel, bestNsPerIteration, itemsPerSecond / 1e6, bytesPerSecond / 1e6);
+	bench.caseCount++;
+}
+
+// The mip_generate kernel: box filters an RGBA8 image down to 1x1, appending every level below
+// the base to mips. Odd sizes clamp at the last row and column. The renderer's textures get
+// glGenerateMipmap(), this is only the CPU cost of the same work.
+static inline void generateMipChainRGBA8(const u8* pixels, u32 width, u32 height, vector<u8>& mips)
+{
+	mips.clear();
+	const u8* source = pixels;
+	size_t sourceOffset = 0;
+	while (width > 1 || height > 1)
+	{
+		u32 mipWidth = max(width / 2, 1u);
+		u32 mipHeight = max(height / 2, 1u);
+		size_t mipOffset = mips.size();
+		mips.resize(mipOffset + size_t(mipWidth) * mipHeight * 4);
+		// The resize may have moved the previous level
+		if (source != pixels)
+		{
+			source = mips.data() + sourceOffset;
+		}
+		u8* destination = mips.data() + mipOffset;
+
+		for (u32 y = 0; y < mipHeight; y++)
+		{
+			u32 y0 = min(y * 2, height - 1);
+			u32 y1 = min(y * 2 + 1, height - 1);
+			for (u32 x = 0; x < mipWidth; x++)
+			{
+				u32 x0 = min(x * 2, width - 1);
+				u32 x1 = min(x * 2 + 1, width - 1);
+				for (u32 channel = 0; channel < 4; channel++)
+				{
+					u32 sum = source[(y0 * width + x0) * 4 + channel] + source[(y0 * width + x1) * 4 + channel] +
+						source[(y1 * width + x0) * 4 + channel] + source[(y1 * width + x1) * 4 + channel];
+					destination[(y * mipWidth + x) * 4 + channel] = u8((sum + 2) / 4);
+				}
+			}
+		}
+
+		source = destination;
+		sourceOffset = mipOffset;
+		width = mipWidth;
+		height = mipHeight;
+	}
+}
@@ -0,0 +1,488 @@
+#pragma once
+#include <xmmintrin.h>
+#include <float.h>
+#include "jobs.h"
+
+// CPU occlusion culling in the style of Masked Software Occlusion Culling (Hasselgren et al.).
+// Occluders are rasterized into a low resolution buffer that never stores per-pixel depth:
+// every 8x4 pixel tile keeps a conservative depth for the whole tile (layer 0) plus a working
+// layer made of a 32-bit coverage mask and the farthest depth written into it (layer 1).
+// When the working layer covers the whole tile it is folded into layer 0.
+// Occludees are tested by comparing the nearest depth of their projected bounding box against
+// layer 0 of every tile the box touches. Depth is NDC z remapped to [0, 1], smaller is closer.
+
+#define OCCLUSION_BUFFER_WIDTH		256
+#define OCCLUSION_BUFFER_HEIGHT		144
+#define OCCLUSION_TILE_WIDTH		8
+#define OCCLUSION_TILE_HEIGHT		4
+#define OCCLUSION_TILES_X			(OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_WIDTH)
+#define OCCLUSION_TILES_Y			(OCCLUSION_BUFFER_HEIGHT / OCCLUSION_TILE_HEIGHT)
+#define OCCLUSION_TILE_COUNT		(OCCLUSION_TILES_X * OCCLUSION_TILES_Y)
+#define OCCLUSION_FULL_MASK			0xFFFFFFFF
+
+static_assert(OCCLUSION_TILE_WIDTH * OCCLUSION_TILE_HEIGHT == 32, "Tile coverage has to fit in a 32-bit mask");
+static_assert(OCCLUSION_TILES_X % 4 == 0, "Tile rows are tested four tiles at a time");
+
+enum class OcclusionResult : u32
+{
+	VISIBLE,
+	OCCLUDED,
+	VIEW_CULLED,
+};
+
+struct OcclusionMesh
+{
+	vector<vec3> positions;
+	vector<u32> indices;
+	vec3 aabbMin;
+	vec3 aabbMax;
+};
+
+// Screen space triangle. Edges are stored as E(x, y) = a * x + b * y + c, positive inside.
+struct OcclusionTriangle
+{
+	vec3 edgeA;
+	vec3 edgeB;
+	vec3 edgeC;
+	vec3 depthPlane;
+	float maxDepth;
+	i32 minX, maxX;
+	i32 minY, maxY;
+};
+
+struct OcclusionLayer
+{
+	float zMax1;
+	u32 mask1;
+};
+
+struct OcclusionBuffer
+{
+	mat4 viewProj;
+	float tileDepth[OCCLUSION_TILE_COUNT];
+	OcclusionLayer tileLayers[OCCLUSION_TILE_COUNT];
+	vector<OcclusionTriangle> triangles;
+	vector<u32> tileRowBins[OCCLUSION_TILES_Y];
+
+	u32 occluderCount;
+	u32 rejectedTriangleCount;
+};
+
+static inline void initOcclusionMesh(OcclusionMesh& mesh)
+{
+	mesh.positions.clear();
+	mesh.indices.clear();
+	mesh.aabbMin = vec3(FLT_MAX);
+	mesh.aabbMax = vec3(-FLT_MAX);
+}
+
+static inline void appendOcclusionGeometry(OcclusionMesh& mesh, const void* positions, size_t stride, u32 vertexCount, const u32* indices, u32 indexCount)
+{
+	u32 baseVertex = u32(mesh.positions.size());
+	for (u32 i = 0; i < vertexCount; i++)
+	{
+		vec3 position = *(const vec3*)((const u8*)positions + i * stride);
+		mesh.positions.push_back(position);
+		mesh.aabbMin = min(mesh.aabbMin, position);
+		mesh.aabbMax = max(mesh.aabbMax, position);
+	}
+
+	for (u32 i = 0; i < indexCount; i++)
+	{
+		mesh.indices.push_back(baseVertex + indices[i]);
+	}
+}
+
+// Room for maxTriangles occluder triangles, each binned into every tile row, so a frame with no
+// more than that never allocates
+static inline void reserveOcclusionBuffer(OcclusionBuffer& buffer, u32 maxTriangles)
+{
+	buffer.triangles.reserve(maxTriangles);
+	for (u32 i = 0; i < OCCLUSION_TILES_Y; i++)
+	{
+		buffer.tileRowBins[i].reserve(maxTriangles);
+	}
+}
+
+static inline void beginOcclusionFrame(OcclusionBuffer& buffer, const mat4& viewProj)
+{
+	buffer.viewProj = viewProj;
+	for (u32 i = 0; i < OCCLUSION_TILE_COUNT; i++)
+	{
+		buffer.tileDepth[i] = 1.0f;
+		buffer.tileLayers[i].zMax1 = 0.0f;
+		buffer.tileLayers[i].mask1 = 0;
+	}
+
+	buffer.triangles.clear();
+	for (u32 i = 0; i < OCCLUSION_TILES_Y; i++)
+	{
+		buffer.tileRowBins[i].clear();
+	}
+	buffer.occluderCount = 0;
+	buffer.rejectedTriangleCount = 0;
+}
+
+static inline vec3 clipToOcclusionScreen(const vec4& clip)
+{
+	float invW = 1.0f / clip.w;
+	return vec3(
+		(clip.x * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH,
+		(clip.y * invW * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT,
+		clip.z * invW * 0.5f + 0.5f);
+}
+
+static inline vec3 computeEdge(const vec3& from, const vec3& to)
+{
+	// E(p) = (p.x - from.x) * (to.y - from.y) - (p.y - from.y) * (to.x - from.x), negated so that
+	// counter-clockwise triangles are positive inside. It's always worked out from the lower end,
+	// so the two triangles sharing an edge get exact negatives of each other and a pixel center on
+	// the edge can't round to outside of both, which would leave a crack through their tiles.
+	bool32 reversed = to.y < from.y || (to.y == from.y && to.x < from.x);
+	const vec3& p0 = reversed ? to : from;
+	const vec3& p1 = reversed ? from : to;
+	float a = p0.y - p1.y;
+	float b = p1.x - p0.x;
+	float c = -(a * p0.x + b * p0.y);
+	return reversed ? vec3(-a, -b, -c) : vec3(a, b, c);
+}
+
+// Triangles touching the near plane or facing away from the screen with zero area are dropped:
+// rasterizing less occluder area than there is keeps the buffer conservative.
+static inline void addOccluder(OcclusionBuffer& buffer, const OcclusionMesh& mesh, const mat4& world)
+{
+	mat4 worldViewProj = buffer.viewProj * world;
+	buffer.occluderCount++;
+
+	const u32 indexCount = u32(mesh.indices.size());
+	for (u32 i = 0; i + 2 < indexCount; i += 3)
+	{
+		vec4 clip0 = worldViewProj * vec4(mesh.positions[mesh.indices[i + 0]], 1.0f);
+		vec4 clip1 = worldViewProj * vec4(mesh.positions[mesh.indices[i + 1]], 1.0f);
+		vec4 clip2 = worldViewProj * vec4(mesh.positions[mesh.indices[i + 2]], 1.0f);
+		if (clip0.z < -clip0.w || clip1.z < -clip1.w || clip2.z < -clip2.w)
+		{
+			buffer.rejectedTriangleCount++;
+			continue;
+		}
+
+		vec3 v0 = clipToOcclusionScreen(clip0);
+		vec3 v1 = clipToOcclusionScreen(clip1);
+		vec3 v2 = clipToOcclusionScreen(clip2);
+
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (fabsf(area) < 1e-6f)
+		{
+			buffer.rejectedTriangleCount++;
+			continue;
+		}
+		if (area < 0.0f)
+		{
+			vec3 swap = v1;
+			v1 = v2;
+			v2 = swap;
+			area = -area;
+		}
+
+		OcclusionTriangle triangle;
+		triangle.minX = max(i32(floorf(min(v0.x, min(v1.x, v2.x)))), 0);
+		triangle.maxX = min(i32(ceilf(max(v0.x, max(v1.x, v2.x)))), OCCLUSION_BUFFER_WIDTH - 1);
+		triangle.minY = max(i32(floorf(min(v0.y, min(v1.y, v2.y)))), 0);
+		triangle.maxY = min(i32(ceilf(max(v0.y, max(v1.y, v2.y)))), OCCLUSION_BUFFER_HEIGHT - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		{
+			continue;
+		}
+
+		triangle.edgeA = computeEdge(v0, v1);
+		triangle.edgeB = computeEdge(v1, v2);
+		triangle.edgeC = computeEdge(v2, v0);
+
+		// z = dx * x + dy * y + z0, solved from the three vertices
+		float invArea = 1.0f / area;
+		float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) * invArea;
+		float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) * invArea;
+		triangle.depthPlane = vec3(dzdx, dzdy, v0.z - dzdx * v0.x - dzdy * v0.y);
+		triangle.maxDepth = max(v0.z, max(v1.z, v2.z));
+
+		u32 triangleIndex = u32(buffer.triangles.size());
+		buffer.triangles.push_back(triangle);
+
+		u32 firstRow = u32(triangle.minY / OCCLUSION_TILE_HEIGHT);
+		u32 lastRow = u32(triangle.maxY / OCCLUSION_TILE_HEIGHT);
+		for (u32 row = firstRow; row <= lastRow; row++)
+		{
+			buffer.tileRowBins[row].push_back(triangleIndex);
+		}
+	}
+}
+
+static inline void updateOcclusionTile(float& zMax0, OcclusionLayer& layer, u32 coverage, float depth)
+{
+	if (coverage == 0 || depth >= zMax0)
+	{
+		return;
+	}
+
+	// Heuristic from the paper: when the new triangle is much closer than what the working layer
+	// holds, the working layer is unlikely to ever complete at a useful depth, so restart it
+	float distanceToLayer1 = layer.zMax1 - depth;
+	float distanceBetweenLayers = zMax0 - layer.zMax1;
+	if (layer.mask1 != 0 && distanceToLayer1 > distanceBetweenLayers)
+	{
+		layer.zMax1 = 0.0f;
+		layer.mask1 = 0;
+	}
+
+	layer.zMax1 = max(layer.zMax1, depth);
+	layer.mask1 |= coverage;
+
+	if (layer.mask1 == OCCLUSION_FULL_MASK)
+	{
+		zMax0 = min(zMax0, layer.zMax1);
+		layer.zMax1 = 0.0f;
+		layer.mask1 = 0;
+	}
+}
+
+static inline u32 computeTileCoverage(const OcclusionTriangle& triangle, float tileX, float tileY)
+{
+	// Pixel centers of one 4-pixel half row, relative to the tile origin
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 aA = _mm_set1_ps(triangle.edgeA.x);
+	__m128 aB = _mm_set1_ps(triangle.edgeB.x);
+	__m128 aC = _mm_set1_ps(triangle.edgeC.x);
+
+	u32 coverage = 0;
+	for (u32 half = 0; half < 2; half++)
+	{
+		__m128 x = _mm_add_ps(_mm_set1_ps(tileX + 4.0f * half), pixelOffsets);
+		__m128 rowStartA = _mm_mul_ps(aA, x);
+		__m128 rowStartB = _mm_mul_ps(aB, x);
+		__m128 rowStartC = _mm_mul_ps(aC, x);
+
+		for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++)
+		{
+			float y = tileY + row + 0.5f;
+			__m128 eA = _mm_add_ps(rowStartA, _mm_set1_ps(triangle.edgeA.y * y + triangle.edgeA.z));
+			__m128 eB = _mm_add_ps(rowStartB, _mm_set1_ps(triangle.edgeB.y * y + triangle.edgeB.z));
+			__m128 eC = _mm_add_ps(rowStartC, _mm_set1_ps(triangle.edgeC.y * y + triangle.edgeC.z));
+
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(eA, zero), _mm_cmpge_ps(eB, zero)), _mm_cmpge_ps(eC, zero));
+			u32 bits = u32(_mm_movemask_ps(inside));
+			coverage |= bits << (row * OCCLUSION_TILE_WIDTH + half * 4);
+		}
+	}
+
+	return coverage;
+}
+
+static inline void rasterizeOcclusionTileRow(OcclusionBuffer& buffer, u32 row)
+{
+	const vector<u32>& bin = buffer.tileRowBins[row];
+	const float tileY = float(row * OCCLUSION_TILE_HEIGHT);
+
+	for (u32 triangleIndex : bin)
+	{
+		const OcclusionTriangle& triangle = buffer.triangles[triangleIndex];
+		const u32 firstTile = u32(triangle.minX / OCCLUSION_TILE_WIDTH);
+		const u32 lastTile = u32(triangle.maxX / OCCLUSION_TILE_WIDTH);
+
+		for (u32 tileX = firstTile; tileX <= lastTile; tileX++)
+		{
+			const u32 tileIndex = row * OCCLUSION_TILES_X + tileX;
+			const float x0 = float(tileX * OCCLUSION_TILE_WIDTH);
+			u32 coverage = computeTileCoverage(triangle, x0, tileY);
+			if (coverage == 0)
+			{
+				continue;
+			}
+
+			// The depth plane is linear, so its maximum over the tile sits on a corner
+			const vec3& plane = triangle.depthPlane;
+			float x1 = x0 + OCCLUSION_TILE_WIDTH;
+			float y1 = tileY + OCCLUSION_TILE_HEIGHT;
+			float depth = max(max(plane.x * x0 + plane.y * tileY, plane.x * x1 + plane.y * tileY),
+				max(plane.x * x0 + plane.y * y1, plane.x * x1 + plane.y * y1)) + plane.z;
+			depth = min(depth, triangle.maxDepth);
+
+			updateOcclusionTile(buffer.tileDepth[tileIndex], buffer.tileLayers[tileIndex], coverage, depth);
+		}
+	}
+}
+
+// Tile rows never share state, so each job owns a range of rows and needs no synchronization.
+static inline void rasterizeOccluders(OcclusionBuffer& buffer, JobSystem& jobs)
+{
+	parallelFor(jobs, OCCLUSION_TILES_Y, 2, [&](u32 begin, u32 end)
+	{
+		for (u32 row = begin; row < end; row++)
+		{
+			rasterizeOcclusionTileRow(buffer, row);
+		}
+	});
+}
+
+// Only the view frustum part of testOcclusionAABB(): true when all eight corners are outside the
+// same clip plane
+static inline bool32 isAABBOutsideFrustum(const mat4& worldViewProj, const vec3& aabbMin, const vec3& aabbMax)
+{
+	u32 outsideMask = 0x3F;
+	for (u32 corner = 0; corner < 8 && outsideMask; corner++)
+	{
+		vec4 position((corner & 1) ? aabbMax.x : aabbMin.x, (corner & 2) ? aabbMax.y : aabbMin.y, (corner & 4) ? aabbMax.z : aabbMin.z, 1.0f);
+		vec4 clip = worldViewProj * position;
+
+		u32 cornerOutside = 0;
+		cornerOutside |= (clip.x < -clip.w) ? 0x01 : 0;
+		cornerOutside |= (clip.x > clip.w) ? 0x02 : 0;
+		cornerOutside |= (clip.y < -clip.w) ? 0x04 : 0;
+		cornerOutside |= (clip.y > clip.w) ? 0x08 : 0;
+		cornerOutside |= (clip.z < -clip.w) ? 0x10 : 0;
+		cornerOutside |= (clip.z > clip.w) ? 0x20 : 0;
+		outsideMask &= cornerOutside;
+	}
+	return outsideMask != 0;
+}
+
+// Tests a local space bounding box transformed by worldViewProj. Boxes crossing the near plane
+// are always visible. When screenArea is given it receives the size of the projected box in
+// occlusion buffer pixels, which callers can use to pick occluders for the next frame.
+static inline OcclusionResult testOcclusionAABB(const OcclusionBuffer& buffer, const mat4& worldViewProj,
+	const vec3& aabbMin, const vec3& aabbMax, float* screenArea = nullptr)
+{
+	vec3 screenMin(FLT_MAX);
+	vec3 screenMax(-FLT_MAX);
+	u32 outsideMask = 0x3F;
+	bool32 crossesNearPlane = false;
+
+	for (u32 corner = 0; corner < 8; corner++)
+	{
+		vec4 position((corner & 1) ? aabbMax.x : aabbMin.x, (corner & 2) ? aabbMax.y : aabbMin.y, (corner & 4) ? aabbMax.z : aabbMin.z, 1.0f);
+		vec4 clip = worldViewProj * position;
+
+		u32 cornerOutside = 0;
+		cornerOutside |= (clip.x < -clip.w) ? 0x01 : 0;
+		cornerOutside |= (clip.x > clip.w) ? 0x02 : 0;
+		cornerOutside |= (clip.y < -clip.w) ? 0x04 : 0;
+		cornerOutside |= (clip.y > clip.w) ? 0x08 : 0;
+		cornerOutside |= (clip.z < -clip.w) ? 0x10 : 0;
+		cornerOutside |= (clip.z > clip.w) ? 0x20 : 0;
+		outsideMask &= cornerOutside;
+
+		if (clip.z < -clip.w)
+		{
+			crossesNearPlane = true;
+			continue;
+		}
+
+		vec3 screen = clipToOcclusionScreen(clip);
+		screenMin = min(screenMin, screen);
+		screenMax = max(screenMax, screen);
+	}
+
+	if (outsideMask)
+	{
+		return OcclusionResult::VIEW_CULLED;
+	}
+
+	if (crossesNearPlane)
+	{
+		if (screenArea)
+		{
+			*screenArea = float(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT);
+		}
+		return OcclusionResult::VISIBLE;
+	}
+
+	i32 minX = max(i32(floorf(screenMin.x)), 0);
+	i32 maxX = min(i32(ceilf(screenMax.x)), OCCLUSION_BUFFER_WIDTH - 1);
+	i32 minY = max(i32(floorf(screenMin.y)), 0);
+	i32 maxY = min(i32(ceilf(screenMax.y)), OCCLUSION_BUFFER_HEIGHT - 1);
+	if (screenArea)
+	{
+		*screenArea = float(maxX - minX + 1) * float(maxY - minY + 1);
+	}
+
+	const u32 firstTileX = u32(minX / OCCLUSION_TILE_WIDTH);
+	const u32 lastTileX = u32(maxX / OCCLUSION_TILE_WIDTH);
+	const u32 firstTileY = u32(minY / OCCLUSION_TILE_HEIGHT);
+	const u32 lastTileY = u32(maxY / OCCLUSION_TILE_HEIGHT);
+
+	// Visible as soon as one tile holds something farther than the nearest point of the box
+	const __m128 nearestDepth = _mm_set1_ps(screenMin.z);
+	for (u32 tileY = firstTileY; tileY <= lastTileY; tileY++)
+	{
+		const float* rowDepth = &buffer.tileDepth[tileY * OCCLUSION_TILES_X];
+		u32 tileX = firstTileX;
+		for (; tileX + 3 <= lastTileX; tileX += 4)
+		{
+			__m128 depth = _mm_loadu_ps(rowDepth + tileX);
+			if (_mm_movemask_ps(_mm_cmpge_ps(depth, nearestDepth)))
+			{
+				return OcclusionResult::VISIBLE;
+			}
+		}
+		for (; tileX <= lastTileX; tileX++)
+		{
+			if (rowDepth[tileX] >= screenMin.z)
+			{
+				return OcclusionResult::VISIBLE;
+			}
+		}
+	}
+
+	return OcclusionResult::OCCLUDED;
+}
+
+// CPU only self-check of the rasterizer and the box test, run by --occlusion-test. A 10x10 quad
+// 10 units in front of the camera is the only occluder, boxes around it have a known answer.
+// Returns the number of boxes that got the wrong one.
+static inline u32 runOcclusionSelfTest(OcclusionBuffer& buffer, JobSystem& jobs)
+{
+	struct OcclusionCase
+	{
+		const char* name;
+		vec3 center;
+		float halfSize;
+		OcclusionResult expected;
+	};
+	static const OcclusionCase cases[] =
+	{
+		{ "behind the quad", vec3(0.0f, 0.0f, -20.0f), 1.0f, OcclusionResult::OCCLUDED },
+		{ "behind a corner", vec3(-3.0f, 3.0f, -30.0f), 1.0f, OcclusionResult::OCCLUDED },
+		{ "in front of the quad", vec3(0.0f, 0.0f, -5.0f), 1.0f, OcclusionResult::VISIBLE },
+		{ "beside the quad", vec3(13.0f, 0.0f, -20.0f), 1.0f, OcclusionResult::VISIBLE },
+		{ "across the edge", vec3(10.0f, 0.0f, -20.0f), 1.0f, OcclusionResult::VISIBLE },
+		{ "through the quad", vec3(0.0f, 0.0f, -10.0f), 1.0f, OcclusionResult::VISIBLE },
+		{ "across the near plane", vec3(0.0f, 0.0f, 0.0f), 1.0f, OcclusionResult::VISIBLE },
+		{ "behind the camera", vec3(0.0f, 0.0f, 20.0f), 1.0f, OcclusionResult::VIEW_CULLED },
+		{ "left of the frustum", vec3(-200.0f, 0.0f, -20.0f), 1.0f, OcclusionResult::VIEW_CULLED },
+	};
+	static const char* const resultNames[] = { "visible", "occluded", "view culled" };
+
+	const vec3 quadCorners[] = { vec3(-5.0f, -5.0f, -10.0f), vec3(5.0f, -5.0f, -10.0f), vec3(5.0f, 5.0f, -10.0f), vec3(-5.0f, 5.0f, -10.0f) };
+	const u32 quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+	OcclusionMesh quad;
+	initOcclusionMesh(quad);
+	appendOcclusionGeometry(quad, quadCorners, sizeof(vec3), 4, quadIndices, 6);
+
+	mat4 viewProj = perspective(radians(45.0f), float(OCCLUSION_BUFFER_WIDTH) / float(OCCLUSION_BUFFER_HEIGHT), 0.1f, 100.0f);
+	beginOcclusionFrame(buffer, viewProj);
+	addOccluder(buffer, quad, mat4(1.0f));
+	rasterizeOccluders(buffer, jobs);
+
+	u32 failures = 0;
+	for (const OcclusionCase& test : cases)
+	{
+		mat4 world = translate(mat4(1.0f), test.center);
+		OcclusionResult result = testOcclusionAABB(buffer, viewProj * world, vec3(-test.halfSize), vec3(test.halfSize));
+		bool32 passed = result == test.expected;
+		failures += passed ? 0 : 1;
+		printf("%-24s expected %-12s got %-12s %s\n", test.name, resultNames[u32(test.expected)], resultNames[u32(result)], passed ? "ok" : "FAILED");
+	}
+	printf("Occlusion self-test: %u of %u boxes wrong\n", failures, u32(sizeof(cases) / sizeof(cases[0])));
+	return failures;
+}
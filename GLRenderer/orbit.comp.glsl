@@ -0,0 +1,76 @@
+#version 430 core
+
+#ifndef WORKGROUP_SIZE
+#define WORKGROUP_SIZE 256
+#endif
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+struct OrbitalParameters
+{
+	float radius;
+	float phase;
+	float angularSpeed;
+	float height;
+	float inclination;
+	float ascendingNode;
+	float scale;
+	float spinSpeed;
+	vec4 spinAxisAngle;
+};
+
+layout(std430, binding = 2) readonly buffer Orbits
+{
+	OrbitalParameters orbits[];
+};
+
+layout(std430, binding = 3) writeonly buffer InstanceMatrices
+{
+	mat4 instanceMatrices[];
+};
+
+uniform float time;
+uniform uint instanceCount;
+
+mat3 rotationX(float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat3(1.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, -s, c);
+}
+
+mat3 rotationY(float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat3(c, 0.0f, -s, 0.0f, 1.0f, 0.0f, s, 0.0f, c);
+}
+
+mat3 axisAngleRotation(vec3 axis, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	float t = 1.0f - c;
+	return mat3(
+		t * axis.x * axis.x + c,          t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y,
+		t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,          t * axis.y * axis.z + s * axis.x,
+		t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c);
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= instanceCount)
+	{
+		return;
+	}
+
+	OrbitalParameters orbit = orbits[index];
+
+	float angle = orbit.phase + orbit.angularSpeed * time;
+	vec3 position = vec3(sin(angle) * orbit.radius, orbit.height, cos(angle) * orbit.radius);
+	position = rotationY(orbit.ascendingNode) * rotationX(orbit.inclination) * position;
+
+	mat3 rotation = axisAngleRotation(orbit.spinAxisAngle.xyz, orbit.spinAxisAngle.w + orbit.spinSpeed * time) * orbit.scale;
+	instanceMatrices[index] = mat4(vec4(rotation[0], 0.0f), vec4(rotation[1], 0.0f), vec4(rotation[2], 0.0f), vec4(position, 1.0f));
+}
\ No newline at end of file
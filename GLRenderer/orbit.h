@@ -0,0 +1,113 @@
+#pragma once
+
+// Orbital animation of the asteroid ring. Every instance gets a circular orbit around the planet
+// plus a spin, generated once from a seed and kept in a shader storage buffer. orbit.comp.glsl
+// evaluates the orbits at the current simulation time and writes the instance matrices straight
+// into the instance buffer the rocks are drawn from, so nothing goes back through the CPU.
+// The orbits are closed form, so the field only depends on the seed and the simulation time,
+// never on the frame rate.
+
+#define ORBIT_WORKGROUP_SIZE 256
+
+// Mirrors the std430 OrbitalParameters block in orbit.comp.glsl
+struct OrbitalParameters
+{
+	float radius;
+	float phase;
+	float angularSpeed;
+	float height;
+	float inclination;
+	float ascendingNode;
+	float scale;
+	float spinSpeed;
+	vec4 spinAxisAngle;
+};
+
+static_assert(sizeof(OrbitalParameters) == 48, "OrbitalParameters has to match its std430 layout");
+
+// PCG32, the same sequence on every platform unlike rand()
+struct OrbitRandom
+{
+	u64 state;
+	u64 increment;
+};
+
+static inline u32 nextOrbitRandom(OrbitRandom& random)
+{
+	u64 oldState = random.state;
+	random.state = oldState * 6364136223846793005ULL + random.increment;
+	u32 xorShifted = u32(((oldState >> 18u) ^ oldState) >> 27u);
+	u32 rotation = u32(oldState >> 59u);
+	return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
+
+static inline void initOrbitRandom(OrbitRandom& random, u64 seed)
+{
+	random.state = 0;
+	random.increment = (seed << 1u) | 1u;
+	nextOrbitRandom(random);
+	random.state += seed;
+	nextOrbitRandom(random);
+}
+
+static inline float randomOrbitFloat(OrbitRandom& random, float minimum, float maximum)
+{
+	float unit = (nextOrbitRandom(random) >> 8) * (1.0f / 16777216.0f);
+	return minimum + (maximum - minimum) * unit;
+}
+
+// Same ring as generateAsteroidField: radius 150 +- 25, thin in y, scales 0.05 - 0.25.
+// Angular speed follows Kepler's third law so the inner edge of the ring overtakes the outer one.
+static inline void generateOrbitalParameters(OrbitalParameters* orbits, u32 count, u64 seed)
+{
+	const float ringRadius = 150.0f;
+	const float ringWidth = 25.0f;
+	const float ringSpeed = 0.05f;
+
+	OrbitRandom random;
+	initOrbitRandom(random, seed);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		OrbitalParameters& orbit = orbits[i];
+		orbit.radius = ringRadius + randomOrbitFloat(random, -ringWidth, ringWidth);
+		orbit.phase = randomOrbitFloat(random, 0.0f, two_pi<float>());
+		orbit.angularSpeed = ringSpeed * powf(ringRadius / orbit.radius, 1.5f);
+		orbit.height = randomOrbitFloat(random, -ringWidth, ringWidth) * 0.4f;
+		orbit.inclination = radians(randomOrbitFloat(random, -2.0f, 2.0f));
+		orbit.ascendingNode = randomOrbitFloat(random, 0.0f, two_pi<float>());
+		orbit.scale = randomOrbitFloat(random, 0.05f, 0.25f);
+		orbit.spinSpeed = randomOrbitFloat(random, -1.0f, 1.0f);
+
+		vec3 axis(randomOrbitFloat(random, -1.0f, 1.0f), randomOrbitFloat(random, -1.0f, 1.0f), randomOrbitFloat(random, -1.0f, 1.0f));
+		axis = length(axis) > 1e-3f ? normalize(axis) : vec3(0.0f, 1.0f, 0.0f);
+		orbit.spinAxisAngle = vec4(axis, randomOrbitFloat(random, 0.0f, two_pi<float>()));
+	}
+}
+
+// The instance matrix orbit.comp.glsl writes for this orbit at the given time, term for term, so
+// the CPU can carry on from wherever the GPU animation left the field
+static inline mat4 evaluateOrbit(const OrbitalParameters& orbit, float time)
+{
+	float angle = orbit.phase + orbit.angularSpeed * time;
+	vec3 position = vec3(sinf(angle) * orbit.radius, orbit.height, cosf(angle) * orbit.radius);
+
+	float sinNode = sinf(orbit.ascendingNode);
+	float cosNode = cosf(orbit.ascendingNode);
+	float sinInclination = sinf(orbit.inclination);
+	float cosInclination = cosf(orbit.inclination);
+	mat3 rotationY(cosNode, 0.0f, -sinNode, 0.0f, 1.0f, 0.0f, sinNode, 0.0f, cosNode);
+	mat3 rotationX(1.0f, 0.0f, 0.0f, 0.0f, cosInclination, sinInclination, 0.0f, -sinInclination, cosInclination);
+	position = rotationY * rotationX * position;
+
+	vec3 axis = vec3(orbit.spinAxisAngle);
+	float spin = orbit.spinAxisAngle.w + orbit.spinSpeed * time;
+	float s = sinf(spin);
+	float c = cosf(spin);
+	float t = 1.0f - c;
+	mat3 rotation = mat3(
+		t * axis.x * axis.x + c,          t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y,
+		t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,          t * axis.y * axis.z + s * axis.x,
+		t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c) * orbit.scale;
+	return mat4(vec4(rotation[0], 0.0f), vec4(rotation[1], 0.0f), vec4(rotation[2], 0.0f), vec4(position, 1.0f));
+}
@@ -1,19 +1,6 @@
 #version 330 core
 
-struct Material
-{
-	sampler2D diffuse;
-	sampler2D specular;
-	float shininess;
-};
-
-struct Light
-{
-	vec3 direction;
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-};
+#include "lights.glsl"
 
 out vec4 fragmentColor;
 
@@ -23,23 +10,14 @@ in vec2 texCoords;
 
 uniform vec3 viewPosition;
 uniform Material material;
-uniform Light light;
+uniform DirectionalLight light;
 
 void main()
 {
-	vec3 ambientLight = light.ambient * vec3(texture(material.diffuse, texCoords));
-	
 	vec3 normalUnitVector = normalize(normal);
-	vec3 lightDirection = normalize(-light.direction);
-	// do this so lightColors can't be negative --> dot product with (angles > 90) produce negative results
-	float diff = max(dot(normalUnitVector, lightDirection), 0.0f);
-	vec3 diffuseLight = light.diffuse * diff * vec3(texture(material.diffuse, texCoords));
-
 	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
-	vec3 reflectionDirection = reflect(-lightDirection, normalUnitVector);
-	float spec = pow(max(dot(viewDirection, reflectionDirection), 0.0f), material.shininess);
-	vec3 specularLight = light.specular * spec * vec3(texture(material.specular, texCoords));
+	Surface surface = Surface(vec3(texture(material.diffuse, texCoords)), vec3(texture(material.specular, texCoords)), material.shininess);
 
-	vec3 result = ambientLight + diffuseLight + specularLight;
+	vec3 result = computeDirectionalLight(light, surface, normalUnitVector, viewDirection);
 	fragmentColor = vec4(result, 1.0f);
 }
\ No newline at end of file
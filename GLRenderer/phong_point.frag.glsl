@@ -1,24 +1,6 @@
 #version 330 core
 
-struct Material
-{
-	sampler2D diffuse;
-	sampler2D specular;
-	float shininess;
-};
-
-struct Light
-{
-	vec3 position;
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-
-	float constant;
-	float linear;
-	float quadratic;
-};
+#include "lights.glsl"
 
 out vec4 fragmentColor;
 
@@ -28,29 +10,29 @@ in vec2 texCoords;
 
 uniform vec3 viewPosition;
 uniform Material material;
-uniform Light light;
+uniform PointLight light;
 
+// Keeps the terms this shader had before lights.glsl: the specular isn't attenuated and the
+// ambient is attenuated twice. computePointLight() is what phong_all_lights uses.
 void main()
 {
-	vec3 ambientLight = light.ambient * vec3(texture(material.diffuse, texCoords));
-
 	vec3 normalUnitVector = normalize(normal);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	Surface surface = Surface(vec3(texture(material.diffuse, texCoords)), vec3(texture(material.specular, texCoords)), material.shininess);
+
 	vec3 lightDirection = normalize(light.position - fragmentPosition);
-	// do this so lightColors can't be negative --> dot product with (angles > 90) produce negative results
 	float diff = max(dot(normalUnitVector, lightDirection), 0.0f);
-	vec3 diffuseLight = light.diffuse * diff * vec3(texture(material.diffuse, texCoords));
+	vec3 reflectDirection = reflect(-lightDirection, normalUnitVector);
+	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), surface.shininess);
 
-	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
-	vec3 reflectionDirection = reflect(-lightDirection, normalUnitVector);
-	float spec = pow(max(dot(viewDirection, reflectionDirection), 0.0f), material.shininess);
-	vec3 specularLight = light.specular * spec * vec3(texture(material.specular, texCoords));
+	vec3 ambientLight = light.ambient * surface.diffuse;
+	vec3 diffuseLight = light.diffuse * diff * surface.diffuse;
+	vec3 specularLight = light.specular * spec * surface.specular;
 
 	float distance = length(light.position - fragmentPosition);
 	float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-
-	ambientLight *= attenuation;
+	ambientLight *= attenuation * attenuation;
 	diffuseLight *= attenuation;
-	ambientLight *= attenuation;
 
 	vec3 result = ambientLight + diffuseLight + specularLight;
 	fragmentColor = vec4(result, 1.0f);
@@ -1,29 +1,6 @@
 #version 330 core
 
-struct Material
-{
-	sampler2D diffuse;
-	sampler2D specular;
-	float shininess;
-};
-
-struct Light
-{
-	vec3 position;
-	vec3 direction;
-	
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-	float cutOff;
-	float outerCutOff;
-};
+#include "lights.glsl"
 
 out vec4 fragmentColor;
 
@@ -33,37 +10,35 @@ in vec2 texCoords;
 
 uniform vec3 viewPosition;
 uniform Material material;
-uniform Light light;
+uniform Spotlight light;
 
+// Keeps the terms this shader had before lights.glsl: the cone only dims the diffuse and the
+// specular, the specular isn't attenuated and the ambient is attenuated twice.
+// computeSpotlight() is what phong_all_lights uses.
 void main()
 {
-	vec3 ambientLight = light.ambient * vec3(texture(material.diffuse, texCoords));
-
 	vec3 normalUnitVector = normalize(normal);
-	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	Surface surface = Surface(vec3(texture(material.diffuse, texCoords)), vec3(texture(material.specular, texCoords)), material.shininess);
 
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
 	float theta = dot(lightDirection, normalize(-light.direction));
-	float epsilon = (light.cutOff - light.outerCutOff);
+	float epsilon = light.cutOff - light.outerCutOff;
 	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0f, 1.0f);
 
-	// do this so lightColors can't be negative --> dot product with (angles > 90) produce negative results
 	float diff = max(dot(normalUnitVector, lightDirection), 0.0f);
-	vec3 diffuseLight = light.diffuse * diff * vec3(texture(material.diffuse, texCoords));
-
-	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
-	vec3 reflectionDirection = reflect(-lightDirection, normalUnitVector);
-	float spec = pow(max(dot(viewDirection, reflectionDirection), 0.0f), material.shininess);
-	vec3 specularLight = light.specular * spec * vec3(texture(material.specular, texCoords));
+	vec3 reflectDirection = reflect(-lightDirection, normalUnitVector);
+	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), surface.shininess);
 
-	diffuseLight *= intensity;
-	specularLight *= intensity;
+	vec3 ambientLight = light.ambient * surface.diffuse;
+	vec3 diffuseLight = light.diffuse * diff * surface.diffuse * intensity;
+	vec3 specularLight = light.specular * spec * surface.specular * intensity;
 
 	float distance = length(light.position - fragmentPosition);
 	float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-	ambientLight *= attenuation;
+	ambientLight *= attenuation * attenuation;
 	diffuseLight *= attenuation;
-	ambientLight *= attenuation;
 
 	vec3 result = ambientLight + diffuseLight + specularLight;
-	fragmentColor = vec4(result, 1.0f);	
+	fragmentColor = vec4(result, 1.0f);
 }
\ No newline at end of file
@@ -1,15 +1,16 @@
-#version 330 core
+#version 410 core
 layout(location = 0) in vec3 position;
 layout(location = 2) in vec2 texCoord;
 
-out vec2 TexCoord;
+// Varyings are matched by location, the fragment stage is a separate program
+layout(location = 0) out vec2 TexCoord;
+
+#include "frame_uniforms.glsl"
 
-uniform mat4 proj;
-uniform mat4 view;
 uniform mat4 world;
 
 void main()
 {
 	TexCoord = texCoord;
-	gl_Position = proj * view * world * vec4(position, 1.0f);
+	gl_Position = viewProj * (world * vec4(position, 1.0f));
 }
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// On-disk cache of linked program binaries. A program is keyed by the hash of its stage sources,
+// the defines it was built with and the GL vendor, renderer and version strings, so a driver
+// update or an edited shader simply misses. Binaries the driver refuses to load are treated as
+// misses too and get rebuilt from source and written again.
+
+#define PROGRAM_CACHE_DIRECTORY "shader_cache"
+#define PROGRAM_CACHE_MAGIC 0x48435250 // "PRCH"
+#define PROGRAM_CACHE_VERSION 1
+
+struct ProgramBinaryHeader
+{
+	u32 magic;
+	u32 version;
+	u64 key;
+	u32 format;
+	u32 length;
+};
+
+struct ProgramCache
+{
+	bool32 enabled;
+	u64 driverHash;
+
+	u32 warmPrograms;
+	u32 coldPrograms;
+	u32 rejectedBinaries;
+	double warmMs;
+	double coldMs;
+};
+
+static inline u64 hashProgramBytes(u64 hash, const void* data, size_t size)
+{
+	const u8* bytes = (const u8*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+static inline u64 hashProgramString(u64 hash, const char* text)
+{
+	// The terminator goes into the hash too so "ab" + "c" and "a" + "bc" differ
+	return hashProgramBytes(hash, text, strlen(text) + 1);
+}
+
+static inline void initProgramCache(ProgramCache& cache)
+{
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	cache.enabled = formatCount > 0;
+
+	u64 hash = 14695981039346656037ULL;
+	hash = hashProgramString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = hashProgramString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = hashProgramString(hash, (const char*)glGetString(GL_VERSION));
+	cache.driverHash = hash;
+
+	cache.warmPrograms = 0;
+	cache.coldPrograms = 0;
+	cache.rejectedBinaries = 0;
+	cache.warmMs = 0.0;
+	cache.coldMs = 0.0;
+
+#ifdef _WIN32
+	_mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+	mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+}
+
+// sources[i] == nullptr for the stages the program doesn't have
+static inline u64 getProgramCacheKey(const ProgramCache& cache, const char* const* sources, u32 stageCount, const char* defines)
+{
+	u64 hash = cache.driverHash;
+	for (u32 i = 0; i < stageCount; i++)
+	{
+		hash = hashProgramBytes(hash, &i, sizeof(i));
+		hash = hashProgramString(hash, sources[i] ? sources[i] : "");
+	}
+	return hashProgramString(hash, defines ? defines : "");
+}
+
+static inline void getProgramCachePath(u64 key, char* path, size_t pathSize)
+{
+	snprintf(path, pathSize, PROGRAM_CACHE_DIRECTORY "/%016llx.bin", (unsigned long long)key);
+}
+
+// Returns true when program now holds a linked binary for key
+static inline bool32 loadProgramBinary(ProgramCache& cache, u32 program, u64 key)
+{
+	if (!cache.enabled)
+	{
+		return false;
+	}
+
+	char path[256];
+	getProgramCachePath(key, path, sizeof(path));
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	ProgramBinaryHeader header;
+	bool32 valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION && header.key == key;
+
+	vector<u8> binary;
+	if (valid)
+	{
+		binary.resize(header.length);
+		valid = fread(binary.data(), 1, header.length, file) == header.length;
+	}
+	fclose(file);
+	if (!valid)
+	{
+		return false;
+	}
+
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	int linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		cache.rejectedBinaries++;
+	}
+	return linked;
+}
+
+static inline void saveProgramBinary(const ProgramCache& cache, u32 program, u64 key)
+{
+	if (!cache.enabled)
+	{
+		return;
+	}
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	vector<u8> binary(length);
+	glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+	header.length = u32(length);
+
+	char path[256];
+	getProgramCachePath(key, path, sizeof(path));
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		return;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(binary.data(), 1, binary.size(), file);
+	fclose(file);
+}
+
+static inline void printProgramCacheStats(const ProgramCache& cache)
+{
+	printf("Shader programs: %u warm from cache in %.2f ms, %u cold from source in %.2f ms, %u cached binaries rejected\n",
+		cache.warmPrograms, cache.warmMs, cache.coldPrograms, cache.coldMs, cache.rejectedBinaries);
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "jobs.h"
+
+// Parallel LSD radix sort of (key, value) pairs, 8 bits per pass. Every pass builds one
+// 256-bucket histogram per block of input, turns them into per-block scatter offsets and
+// scatters the blocks concurrently, which keeps the sort stable. Passes where every key
+// shares the same digit are skipped, so short or quantized keys only pay for the bits in use.
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MIN_BLOCK_SIZE 4096
+
+template <typename Key>
+struct RadixSortScratch
+{
+	vector<Key> keys;
+	vector<u32> values;
+	vector<u32> histograms;
+	u32 passesRun;
+};
+
+// Sizes the scratch for sorts of up to maxCount items up front, so sorting never allocates
+template <typename Key>
+static inline void reserveRadixSortScratch(JobSystem& jobs, RadixSortScratch<Key>& scratch, u32 maxCount)
+{
+	if (scratch.keys.size() < maxCount)
+	{
+		scratch.keys.resize(maxCount);
+		scratch.values.resize(maxCount);
+	}
+	scratch.histograms.reserve(getJobThreadCount(jobs) * 2 * RADIX_BUCKETS);
+}
+
+template <typename Key>
+static inline void radixSort(JobSystem& jobs, RadixSortScratch<Key>& scratch, Key* keys, u32* values, u32 count)
+{
+	scratch.passesRun = 0;
+	if (count < 2)
+	{
+		return;
+	}
+
+	if (scratch.keys.size() < count)
+	{
+		scratch.keys.resize(count);
+		scratch.values.resize(count);
+	}
+
+	u32 blockCount = getJobThreadCount(jobs) * 2;
+	u32 blockSize = (count + blockCount - 1) / blockCount;
+	if (blockSize < RADIX_MIN_BLOCK_SIZE)
+	{
+		blockSize = RADIX_MIN_BLOCK_SIZE;
+	}
+	blockCount = (count + blockSize - 1) / blockSize;
+	scratch.histograms.resize(blockCount * RADIX_BUCKETS);
+
+	Key* sourceKeys = keys;
+	u32* sourceValues = values;
+	Key* destinationKeys = scratch.keys.data();
+	u32* destinationValues = scratch.values.data();
+
+	for (u32 shift = 0; shift < sizeof(Key) * 8; shift += RADIX_BITS)
+	{
+		u32* histograms = scratch.histograms.data();
+		parallelFor(jobs, blockCount, 1, [&](u32 firstBlock, u32 lastBlock)
+		{
+			for (u32 block = firstBlock; block < lastBlock; block++)
+			{
+				u32* histogram = histograms + block * RADIX_BUCKETS;
+				memset(histogram, 0, RADIX_BUCKETS * sizeof(u32));
+
+				u32 end = min((block + 1) * blockSize, count);
+				for (u32 i = block * blockSize; i < end; i++)
+				{
+					histogram[(sourceKeys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				}
+			}
+		});
+
+		bool32 singleDigit = false;
+		u32 offset = 0;
+		for (u32 digit = 0; digit < RADIX_BUCKETS; digit++)
+		{
+			u32 digitTotal = 0;
+			for (u32 block = 0; block < blockCount; block++)
+			{
+				u32& bucket = histograms[block * RADIX_BUCKETS + digit];
+				u32 bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+				digitTotal += bucketCount;
+			}
+
+			if (digitTotal == count)
+			{
+				singleDigit = true;
+				break;
+			}
+		}
+
+		if (singleDigit)
+		{
+			continue;
+		}
+
+		parallelFor(jobs, blockCount, 1, [&](u32 firstBlock, u32 lastBlock)
+		{
+			for (u32 block = firstBlock; block < lastBlock; block++)
+			{
+				u32* scatterOffsets = histograms + block * RADIX_BUCKETS;
+				u32 end = min((block + 1) * blockSize, count);
+				for (u32 i = block * blockSize; i < end; i++)
+				{
+					u32 destination = scatterOffsets[(sourceKeys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+					destinationKeys[destination] = sourceKeys[i];
+					destinationValues[destination] = sourceValues[i];
+				}
+			}
+		});
+
+		Key* swapKeys = sourceKeys;
+		sourceKeys = destinationKeys;
+		destinationKeys = swapKeys;
+		u32* swapValues = sourceValues;
+		sourceValues = destinationValues;
+		destinationValues = swapValues;
+		scratch.passesRun++;
+	}
+
+	if (sourceKeys != keys)
+	{
+		memcpy(keys, sourceKeys, count * sizeof(Key));
+		memcpy(values, sourceValues, count * sizeof(u32));
+	}
+}
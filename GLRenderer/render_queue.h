@@ -0,0 +1,322 @@
+#pragma once
+#include "radix_sort.h"
+#include "gpu_profiler.h"
+#include "frame_arena.h"
+
+// Draws are recorded as packets with a 64-bit sort key, sorted once per frame and only then
+// turned into GL calls, so the draw order comes from the keys rather than from the order the
+// code happens to record them in. From the most significant bit down:
+//
+//	opaque:		pass:3 | 0 | program:10 | material:14 | vertexArray:12 | depth:24
+//	transparent:	pass:3 | 1 | ~depth:24 | program:10 | material:14 | vertexArray:12
+//
+// Opaque packets are grouped by state, so consecutive packets share as much as possible and the
+// state cache filters the rest, with front to back as the last tie break. Transparent packets
+// have to blend in order, back to front, and are the only ones drawn with GL_BLEND enabled.
+//
+// The fields hold GL names, which drivers hand out from small counters. A name past its field is
+// clamped to the largest value and counted in keyOverflows: the packet still draws what it holds,
+// it only sorts together with the other clamped ones.
+
+#define RENDER_PACKET_TEXTURES 4
+#define RENDER_PACKET_VERTEX_BUFFERS 2
+
+#define RENDER_KEY_PASS_BITS 3
+#define RENDER_KEY_PROGRAM_BITS 10
+#define RENDER_KEY_MATERIAL_BITS 14
+#define RENDER_KEY_VERTEX_ARRAY_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24
+
+enum RenderPass
+{
+	RENDER_PASS_WORLD,
+	RENDER_PASS_COUNT,
+};
+
+struct RenderVertexBuffer
+{
+	u32 binding;
+	u32 buffer;
+	u64 offset;
+	u32 stride;
+};
+
+struct RenderPacket
+{
+	// Either a program or a pipeline
+	u32 program;
+	u32 pipeline;
+	u32 vertexArray;
+
+	// Texture i goes to unit i, samplers are expected to be set up accordingly. All of them are
+	// bound in one call, 0 leaves its unit empty.
+	u32 textureTargets[RENDER_PACKET_TEXTURES];
+	u32 textures[RENDER_PACKET_TEXTURES];
+	u32 textureCount;
+
+	// Per draw buffers on top of what the vertex array holds, e.g. the instance data
+	RenderVertexBuffer vertexBuffers[RENDER_PACKET_VERTEX_BUFFERS];
+	u32 vertexBufferCount;
+
+	// worldProgram is the program, or the pipeline stage, that owns worldLocation
+	u32 worldProgram;
+	int worldLocation;
+	mat4 world;
+
+	u32 primitive;
+	bool32 indexed;
+	u32 elementCount;
+	u32 instanceCount;
+
+	// GPU profiler pass the draw is timed under, GPU_PROFILER_NO_PASS for none
+	u32 gpuPass;
+};
+
+// What a recording thread fills in. Recording only touches the buffer itself, no GL calls, so
+// any number of threads can record at once, one buffer each, and the thread that owns the
+// context, the main one, merges and submits them. The packets aren't API agnostic: they hold GL
+// names and enums as they are, to be replayed by this renderer and nothing else.
+struct RenderCommandBuffer
+{
+	vector<RenderPacket> packets;
+	vector<u64> keys;
+	// Key fields clamped by makeRenderKey() since the last reset
+	u32 keyOverflows;
+};
+
+// The merged packets of a frame. They live in the frame arena, sized by beginRenderQueue() for
+// what the frame recorded, and are gone once the arena is reset.
+struct RenderQueue
+{
+	RenderPacket* packets;
+	u64* keys;
+	u32* order;
+	u32 packetCount;
+	u32 packetCapacity;
+	// Summed over the buffers appended this frame
+	u32 keyOverflows;
+	RadixSortScratch<u64> sortScratch;
+};
+
+static inline void initRenderPacket(RenderPacket& packet)
+{
+	memset(&packet, 0, sizeof(packet));
+	packet.worldLocation = -1;
+	packet.primitive = GL_TRIANGLES;
+	packet.instanceCount = 1;
+	packet.gpuPass = GPU_PROFILER_NO_PASS;
+}
+
+static inline void addRenderPacketTexture(RenderPacket& packet, u32 target, u32 texture)
+{
+	assert(packet.textureCount < RENDER_PACKET_TEXTURES);
+	packet.textureTargets[packet.textureCount] = target;
+	packet.textures[packet.textureCount] = texture;
+	packet.textureCount++;
+}
+
+static inline void addRenderPacketVertexBuffer(RenderPacket& packet, u32 binding, u32 buffer, u64 offset, u32 stride)
+{
+	assert(packet.vertexBufferCount < RENDER_PACKET_VERTEX_BUFFERS);
+	RenderVertexBuffer& vertexBuffer = packet.vertexBuffers[packet.vertexBufferCount++];
+	vertexBuffer.binding = binding;
+	vertexBuffer.buffer = buffer;
+	vertexBuffer.offset = offset;
+	vertexBuffer.stride = stride;
+}
+
+// Values that are computed to fit, the pass, the transparency bit and the depth
+static inline u64 packRenderKeyField(u64 key, u32 value, u32 bits)
+{
+	assert(value < (1u << bits) && "Value doesn't fit its render key field");
+	return (key << bits) | value;
+}
+
+static inline u32 clampRenderKeyName(RenderCommandBuffer& commands, u32 name, u32 limit)
+{
+	if (name >= limit)
+	{
+		commands.keyOverflows++;
+		return limit - 1;
+	}
+	return name;
+}
+
+// depth is the normalized view distance, 0 at the camera and 1 at the far plane. Clamped names
+// are counted in commands, the buffer the packet is recorded into.
+static inline u64 makeRenderKey(RenderCommandBuffer& commands, RenderPass pass, bool32 transparent, const RenderPacket& packet, u32 material, float depth)
+{
+	// Programs and pipelines are different objects that can share a name, the top bit tells them apart
+	const u32 pipelineBit = 1u << (RENDER_KEY_PROGRAM_BITS - 1);
+	u32 program = packet.pipeline ? (clampRenderKeyName(commands, packet.pipeline, pipelineBit) | pipelineBit) : clampRenderKeyName(commands, packet.program, pipelineBit);
+	material = clampRenderKeyName(commands, material, 1u << RENDER_KEY_MATERIAL_BITS);
+	u32 vertexArray = clampRenderKeyName(commands, packet.vertexArray, 1u << RENDER_KEY_VERTEX_ARRAY_BITS);
+	u32 quantizedDepth = u32(clamp(depth, 0.0f, 1.0f) * float((1u << RENDER_KEY_DEPTH_BITS) - 1));
+
+	u64 key = packRenderKeyField(0, pass, RENDER_KEY_PASS_BITS);
+	key = packRenderKeyField(key, transparent ? 1 : 0, 1);
+	if (transparent)
+	{
+		key = packRenderKeyField(key, ((1u << RENDER_KEY_DEPTH_BITS) - 1) - quantizedDepth, RENDER_KEY_DEPTH_BITS);
+	}
+	key = packRenderKeyField(key, program, RENDER_KEY_PROGRAM_BITS);
+	key = packRenderKeyField(key, material, RENDER_KEY_MATERIAL_BITS);
+	key = packRenderKeyField(key, vertexArray, RENDER_KEY_VERTEX_ARRAY_BITS);
+	if (!transparent)
+	{
+		key = packRenderKeyField(key, quantizedDepth, RENDER_KEY_DEPTH_BITS);
+	}
+	return key;
+}
+
+static inline bool32 isTransparentRenderKey(u64 key)
+{
+	return (key >> (63 - RENDER_KEY_PASS_BITS)) & 1;
+}
+
+// What beginRenderQueue() takes from the frame arena for packetCapacity packets
+static inline u64 getRenderQueueArenaBytes(u32 packetCapacity)
+{
+	return u64(packetCapacity) * (sizeof(RenderPacket) + sizeof(u64) + sizeof(u32)) + 3 * FRAME_ARENA_ALIGNMENT;
+}
+
+static inline void beginRenderQueue(RenderQueue& queue, FrameArena& arena, u32 packetCapacity)
+{
+	queue.packets = allocateFrameArena<RenderPacket>(arena, packetCapacity);
+	queue.keys = allocateFrameArena<u64>(arena, packetCapacity);
+	queue.order = allocateFrameArena<u32>(arena, packetCapacity);
+	queue.packetCount = 0;
+	queue.packetCapacity = packetCapacity;
+	queue.keyOverflows = 0;
+}
+
+static inline void pushRenderPacket(RenderQueue& queue, const RenderPacket& packet, u64 key)
+{
+	assert(queue.packetCount < queue.packetCapacity && "Render queue is full");
+	queue.order[queue.packetCount] = queue.packetCount;
+	queue.packets[queue.packetCount] = packet;
+	queue.keys[queue.packetCount] = key;
+	queue.packetCount++;
+}
+
+static inline void resetRenderCommandBuffer(RenderCommandBuffer& commands)
+{
+	commands.packets.clear();
+	commands.keys.clear();
+	commands.keyOverflows = 0;
+}
+
+static inline void recordRenderPacket(RenderCommandBuffer& commands, const RenderPacket& packet, u64 key)
+{
+	commands.packets.push_back(packet);
+	commands.keys.push_back(key);
+}
+
+// What beginRenderQueue() needs room for to take all of them
+static inline u32 countRenderCommandBufferPackets(const RenderCommandBuffer* buffers, u32 bufferCount)
+{
+	u32 packetCount = 0;
+	for (u32 i = 0; i < bufferCount; i++)
+	{
+		packetCount += u32(buffers[i].packets.size());
+	}
+	return packetCount;
+}
+
+// The sort is stable, so packets with equal keys keep the order of the buffers here and the
+// order they were recorded in within each buffer
+static inline void appendRenderCommandBuffers(RenderQueue& queue, const RenderCommandBuffer* buffers, u32 bufferCount)
+{
+	for (u32 i = 0; i < bufferCount; i++)
+	{
+		const RenderCommandBuffer& commands = buffers[i];
+		for (u32 j = 0; j < commands.packets.size(); j++)
+		{
+			pushRenderPacket(queue, commands.packets[j], commands.keys[j]);
+		}
+		queue.keyOverflows += commands.keyOverflows;
+	}
+}
+
+static inline void sortRenderQueue(RenderQueue& queue, JobSystem& jobs)
+{
+	radixSort(jobs, queue.sortScratch, queue.keys, queue.order, queue.packetCount);
+}
+
+// Triangles the queue's draws rasterize, over all of their instances
+static inline u64 countRenderQueueTriangles(const RenderQueue& queue)
+{
+	u64 triangles = 0;
+	for (u32 i = 0; i < queue.packetCount; i++)
+	{
+		const RenderPacket& packet = queue.packets[i];
+		u64 packetTriangles = 0;
+		if (packet.primitive == GL_TRIANGLES)
+		{
+			packetTriangles = packet.elementCount / 3;
+		}
+		else if ((packet.primitive == GL_TRIANGLE_STRIP || packet.primitive == GL_TRIANGLE_FAN) && packet.elementCount > 2)
+		{
+			packetTriangles = packet.elementCount - 2;
+		}
+		triangles += packetTriangles * packet.instanceCount;
+	}
+	return triangles;
+}
+
+// Consecutive packets of the same GPU pass are timed as one run, a pass the sort splits into
+// several runs adds them up
+static inline void submitRenderQueue(const RenderQueue& queue, GLStateCache& state, GpuProfiler* profiler = nullptr)
+{
+	u32 gpuPass = GPU_PROFILER_NO_PASS;
+	for (u32 i = 0; i < queue.packetCount; i++)
+	{
+		const RenderPacket& packet = queue.packets[queue.order[i]];
+		if (profiler && packet.gpuPass != gpuPass)
+		{
+			endGpuPass(*profiler, gpuPass);
+			gpuPass = packet.gpuPass;
+			beginGpuPass(*profiler, gpuPass);
+		}
+		setGLCapability(state, GL_BLEND, isTransparentRenderKey(queue.keys[i]));
+
+		if (packet.pipeline)
+		{
+			// A program bound with glUseProgram takes precedence over the bound pipeline
+			setGLProgram(state, 0);
+			setGLProgramPipeline(state, packet.pipeline);
+		}
+		else
+		{
+			setGLProgram(state, packet.program);
+		}
+
+		setGLTextures(state, 0, packet.textureCount, packet.textureTargets, packet.textures);
+
+		setGLVertexArray(state, packet.vertexArray);
+		for (u32 j = 0; j < packet.vertexBufferCount; j++)
+		{
+			const RenderVertexBuffer& vertexBuffer = packet.vertexBuffers[j];
+			glBindVertexBuffer(vertexBuffer.binding, vertexBuffer.buffer, GLintptr(vertexBuffer.offset), vertexBuffer.stride);
+		}
+
+		if (packet.worldLocation >= 0)
+		{
+			glProgramUniformMatrix4fv(packet.worldProgram, packet.worldLocation, 1, GL_FALSE, &packet.world[0][0]);
+		}
+
+		if (packet.indexed)
+		{
+			glDrawElementsInstanced(packet.primitive, packet.elementCount, GL_UNSIGNED_INT, 0, packet.instanceCount);
+		}
+		else
+		{
+			glDrawArraysInstanced(packet.primitive, 0, packet.elementCount, packet.instanceCount);
+		}
+	}
+
+	if (profiler)
+	{
+		endGpuPass(*profiler, gpuPass);
+	}
+}
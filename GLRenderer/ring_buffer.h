@@ -0,0 +1,220 @@
+#pragma once
+
+// Persistently mapped streaming buffer for per-frame data. The whole buffer stays mapped for the
+// lifetime of the program and allocations are carved out of it in ring order. At the end of every
+// frame a fence marks how far the GPU has to get before that frame's bytes can be reused; up to
+// RING_BUFFER_FRAMES frames are in flight at once. When an allocation would overwrite a frame the
+// GPU has not finished yet the CPU waits on that frame's fence, and the wait is recorded as a stall.
+
+#define RING_BUFFER_FRAMES 3
+
+struct RingFrame
+{
+	GLsync fence;
+	u64 byteCount;
+};
+
+struct RingAllocation
+{
+	u8* data;
+	u64 offset;
+	u64 size;
+};
+
+struct RingBuffer
+{
+	u32 buffer;
+	u8* data;
+	u64 capacity;
+	u32 defaultAlignment;
+
+	u64 head;
+	u64 usedBytes;
+	u64 frameBytes;
+
+	RingFrame frames[RING_BUFFER_FRAMES];
+	u32 oldestFrame;
+	u32 framesInFlight;
+
+	// Since the last takeRingStalls()
+	double stallMs;
+	u32 stallCount;
+	u64 peakFrameBytes;
+};
+
+static inline u64 alignRingOffset(u64 offset, u64 alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+static inline void initRingBuffer(RingBuffer& ring, u64 capacity)
+{
+	int uniformAlignment;
+	int storageAlignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	ring.defaultAlignment = u32(max(max(uniformAlignment, storageAlignment), 16));
+
+	const u32 flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	// Created and mapped by name, so nothing has to be bound
+	glCreateBuffers(1, &ring.buffer);
+	glNamedBufferStorage(ring.buffer, capacity, nullptr, flags);
+	ring.data = (u8*)glMapNamedBufferRange(ring.buffer, 0, capacity, flags);
+	assert(ring.data);
+	ring.capacity = capacity;
+
+	ring.head = 0;
+	ring.usedBytes = 0;
+	ring.frameBytes = 0;
+	ring.oldestFrame = 0;
+	ring.framesInFlight = 0;
+	ring.stallMs = 0.0;
+	ring.stallCount = 0;
+	ring.peakFrameBytes = 0;
+}
+
+static inline void destroyRingBuffer(RingBuffer& ring, GLStateCache& state)
+{
+	for (u32 i = 0; i < ring.framesInFlight; i++)
+	{
+		glDeleteSync(ring.frames[(ring.oldestFrame + i) % RING_BUFFER_FRAMES].fence);
+	}
+	glUnmapNamedBuffer(ring.buffer);
+	deleteGLBuffer(state, ring.buffer);
+}
+
+// Frees the oldest frame in flight. With wait == false it only does so if its fence has already
+// been signaled.
+static inline bool32 retireRingFrame(RingBuffer& ring, bool32 wait)
+{
+	assert(ring.framesInFlight);
+	RingFrame& frame = ring.frames[ring.oldestFrame];
+
+	u32 status = glClientWaitSync(frame.fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		if (!wait)
+		{
+			return false;
+		}
+
+		u64 startNs = getCpuProfilerNs();
+		do
+		{
+			status = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (status == GL_TIMEOUT_EXPIRED);
+		ring.stallMs += double(getCpuProfilerNs() - startNs) / 1e6;
+		ring.stallCount++;
+	}
+	assert(status != GL_WAIT_FAILED);
+
+	glDeleteSync(frame.fence);
+	ring.usedBytes -= frame.byteCount;
+	ring.oldestFrame = (ring.oldestFrame + 1) % RING_BUFFER_FRAMES;
+	ring.framesInFlight--;
+	return true;
+}
+
+static inline void beginRingFrame(RingBuffer& ring)
+{
+	while (ring.framesInFlight && retireRingFrame(ring, false))
+	{
+	}
+	if (ring.framesInFlight == RING_BUFFER_FRAMES)
+	{
+		retireRingFrame(ring, true);
+	}
+}
+
+// Call once all the commands reading this frame's allocations have been issued
+static inline void endRingFrame(RingBuffer& ring)
+{
+	assert(ring.framesInFlight < RING_BUFFER_FRAMES);
+	RingFrame& frame = ring.frames[(ring.oldestFrame + ring.framesInFlight) % RING_BUFFER_FRAMES];
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame.byteCount = ring.frameBytes;
+	ring.framesInFlight++;
+
+	ring.peakFrameBytes = max(ring.peakFrameBytes, ring.frameBytes);
+	ring.frameBytes = 0;
+}
+
+static inline RingAllocation allocateRing(RingBuffer& ring, u64 size, u32 alignment = 0)
+{
+	if (!alignment)
+	{
+		alignment = ring.defaultAlignment;
+	}
+	assert(size <= ring.capacity);
+
+	for (;;)
+	{
+		if (!ring.usedBytes)
+		{
+			ring.head = 0;
+		}
+
+		u64 offset = alignRingOffset(ring.head, alignment);
+		if (offset + size > ring.capacity)
+		{
+			offset = 0;
+		}
+		// Alignment padding, or the tail end of the buffer when wrapping, is charged to this frame
+		u64 consumed = (offset >= ring.head ? offset - ring.head : ring.capacity - ring.head) + size;
+
+		if (ring.usedBytes + consumed <= ring.capacity)
+		{
+			ring.head = offset + size;
+			ring.usedBytes += consumed;
+			ring.frameBytes += consumed;
+
+			RingAllocation allocation = { ring.data + offset, offset, size };
+			return allocation;
+		}
+
+		// A single frame asking for more than the whole ring can never be satisfied
+		assert(ring.framesInFlight && "Ring buffer is too small for one frame of data");
+		retireRingFrame(ring, true);
+	}
+}
+
+// Gives back the unused end of the most recent allocation, for data whose final size is only
+// known once it has been written
+static inline void trimRingAllocation(RingBuffer& ring, RingAllocation& allocation, u64 usedSize)
+{
+	assert(usedSize <= allocation.size && ring.head == allocation.offset + allocation.size);
+	u64 unused = allocation.size - usedSize;
+	ring.head -= unused;
+	ring.usedBytes -= unused;
+	ring.frameBytes -= unused;
+	allocation.size = usedSize;
+}
+
+static inline RingAllocation pushRing(RingBuffer& ring, const void* data, u64 size, u32 alignment = 0)
+{
+	RingAllocation allocation = allocateRing(ring, size, alignment);
+	memcpy(allocation.data, data, size);
+	return allocation;
+}
+
+static inline void bindRingAllocation(const RingBuffer& ring, u32 target, u32 index, const RingAllocation& allocation)
+{
+	glBindBufferRange(target, index, ring.buffer, allocation.offset, allocation.size);
+}
+
+static inline double takeRingStalls(RingBuffer& ring, u32* stallCount = nullptr, u64* peakFrameBytes = nullptr)
+{
+	double stallMs = ring.stallMs;
+	if (stallCount)
+	{
+		*stallCount = ring.stallCount;
+	}
+	if (peakFrameBytes)
+	{
+		*peakFrameBytes = ring.peakFrameBytes;
+	}
+	ring.stallMs = 0.0;
+	ring.stallCount = 0;
+	ring.peakFrameBytes = 0;
+	return stallMs;
+}
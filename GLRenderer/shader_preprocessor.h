@@ -0,0 +1,171 @@
+#pragma once
+
+// GLSL front end run on every stage before it's handed to the driver. It does two things:
+//
+//	#include "file.glsl"	is replaced by the file, looked up next to the file that includes it.
+//				Each file is pasted at most once per stage, so headers need no guards.
+//	ShaderDefines		are injected right after the #version line, which GLSL requires to
+//				come first, so one source file builds every permutation of a program.
+//
+// #line directives keep compile errors pointing at the right place: the source string number in
+// a driver log is the index of the file in ShaderSource::files, 0 being the stage itself.
+
+#define SHADER_DEFINES_SIZE 512
+#define SHADER_INCLUDE_DEPTH 8
+
+struct ShaderDefines
+{
+	char text[SHADER_DEFINES_SIZE];
+	u32 length;
+};
+
+struct ShaderSource
+{
+	string text;
+	vector<string> files;
+};
+
+static inline void initShaderDefines(ShaderDefines& defines)
+{
+	defines.text[0] = '\0';
+	defines.length = 0;
+}
+
+static inline void addShaderDefine(ShaderDefines& defines, const char* name, int value)
+{
+	int written = snprintf(defines.text + defines.length, SHADER_DEFINES_SIZE - defines.length, "#define %s %d\n", name, value);
+	assert(written > 0 && defines.length + written < SHADER_DEFINES_SIZE);
+	defines.length += u32(written);
+}
+
+static inline bool32 readShaderFile(const char* path, string& output)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	output.resize(length > 0 ? size_t(length) : 0);
+	size_t rc = output.empty() ? 0 : fread(&output[0], 1, output.size(), file);
+	output.resize(rc);
+	fclose(file);
+	return true;
+}
+
+static inline string getShaderDirectory(const string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == string::npos ? string() : path.substr(0, slash + 1);
+}
+
+// Returns the file name when line is an #include directive
+static inline bool32 parseShaderInclude(const char* line, const char* lineEnd, string& name)
+{
+	while (line < lineEnd && (*line == ' ' || *line == '\t'))
+	{
+		line++;
+	}
+	const char directive[] = "#include";
+	const size_t directiveLength = sizeof(directive) - 1;
+	if (size_t(lineEnd - line) <= directiveLength || strncmp(line, directive, directiveLength) != 0)
+	{
+		return false;
+	}
+
+	const char* open = (const char*)memchr(line + directiveLength, '"', lineEnd - line - directiveLength);
+	const char* close = open ? (const char*)memchr(open + 1, '"', lineEnd - open - 1) : nullptr;
+	assert(close && "#include expects a quoted file name");
+	name.assign(open + 1, close);
+	return true;
+}
+
+static inline void appendShaderFile(ShaderSource& source, u32 fileIndex, const string& text, const ShaderDefines* defines, u32 depth)
+{
+	assert(depth < SHADER_INCLUDE_DEPTH && "Shader includes nest too deep");
+	const string directory = getShaderDirectory(source.files[fileIndex]);
+	char lineDirective[64];
+
+	const char* cursor = text.c_str();
+	const char* end = cursor + text.size();
+	u32 lineNumber = 1;
+	for (; cursor < end; lineNumber++)
+	{
+		const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+		const char* next = lineEnd < end ? lineEnd + 1 : end;
+		if (lineEnd > cursor && lineEnd[-1] == '\r')
+		{
+			lineEnd--;
+		}
+
+		string includeName;
+		if (parseShaderInclude(cursor, lineEnd, includeName))
+		{
+			string includePath = directory + includeName;
+			bool32 alreadyIncluded = false;
+			for (const string& file : source.files)
+			{
+				alreadyIncluded |= file == includePath;
+			}
+
+			if (!alreadyIncluded)
+			{
+				string includeText;
+				bool32 found = readShaderFile(includePath.c_str(), includeText);
+				if (!found)
+				{
+					printf("%s(%u): can't open include \"%s\"\n", source.files[fileIndex].c_str(), lineNumber, includePath.c_str());
+				}
+				assert(found);
+
+				u32 includeIndex = u32(source.files.size());
+				source.files.push_back(includePath);
+				snprintf(lineDirective, sizeof(lineDirective), "#line 1 %u\n", includeIndex);
+				source.text += lineDirective;
+				appendShaderFile(source, includeIndex, includeText, defines, depth + 1);
+			}
+			snprintf(lineDirective, sizeof(lineDirective), "#line %u %u\n", lineNumber + 1, fileIndex);
+			source.text += lineDirective;
+		}
+		else
+		{
+			source.text.append(cursor, lineEnd);
+			source.text += '\n';
+
+			if (depth == 0 && lineNumber == 1)
+			{
+				assert(strncmp(cursor, "#version", 8) == 0 && "#version has to be the first line of a stage");
+				if (defines && defines->length)
+				{
+					source.text.append(defines->text, defines->length);
+					snprintf(lineDirective, sizeof(lineDirective), "#line 2 %u\n", fileIndex);
+					source.text += lineDirective;
+				}
+			}
+		}
+		cursor = next;
+	}
+}
+
+static inline void preprocessShader(ShaderSource& source, const char* path, const ShaderDefines* defines)
+{
+	source.text.clear();
+	source.files.clear();
+	source.files.push_back(path);
+
+	string text;
+	bool32 found = readShaderFile(path, text);
+	if (!found)
+	{
+		printf("Can't open shader \"%s\"\n", path);
+	}
+	assert(found);
+	appendShaderFile(source, 0, text, defines, 0);
+}